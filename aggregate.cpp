@@ -0,0 +1,194 @@
+/*
+
+Aggregation of records.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "aggregate.h"      // self
+
+#include <algorithm>        // std::sort
+
+#include "anyvalue/op_less.h"       // operator<
+
+#include "record.h"         // Record
+
+namespace anyvalue_db
+{
+
+Aggregator::Accumulator::Accumulator():
+        num_values( 0 ),
+        is_double( false ),
+        sum_int( 0 ),
+        sum_double( 0 )
+{
+}
+
+Aggregator::Aggregator( const std::vector<Aggregate> & aggregates, bool is_grouped ):
+        aggregates_( aggregates ),
+        is_grouped_( is_grouped )
+{
+    group_without_key_.count = 0;
+    group_without_key_.accumulators.resize( aggregates_.size() );
+}
+
+void Aggregator::add( const Record & record )
+{
+    add( & group_without_key_, record );
+}
+
+void Aggregator::add( const Value & group_key, const Record & record )
+{
+    auto it = map_key_to_group_.find( group_key );
+
+    if( it == map_key_to_group_.end() )
+    {
+        it = map_key_to_group_.emplace( group_key, Group() ).first;
+
+        it->second.count = 0;
+        it->second.accumulators.resize( aggregates_.size() );
+    }
+
+    add( & it->second, record );
+}
+
+void Aggregator::add( Group * group, const Record & record )
+{
+    ++group->count;
+
+    for( std::size_t i = 0; i < aggregates_.size(); ++i )
+    {
+        auto & a = aggregates_[ i ];
+
+        if( a.op == aggregate_e::COUNT )
+            continue;
+
+        Value v;
+
+        if( record.get_field( a.field_id, & v ) == false )
+            continue;
+
+        auto & acc = group->accumulators[ i ];
+
+        switch( a.op )
+        {
+        case aggregate_e::SUM:
+        case aggregate_e::AVG:
+            if( v.get_type() == anyvalue::type_e::INT )
+            {
+                acc.sum_int += v.get_int();
+            }
+            else if( v.get_type() == anyvalue::type_e::DOUBLE )
+            {
+                acc.sum_double += v.get_double();
+                acc.is_double   = true;
+            }
+            else
+            {
+                continue;
+            }
+            break;
+
+        case aggregate_e::MIN:
+            if( acc.num_values == 0 || v < acc.min )
+                acc.min = v;
+            break;
+
+        case aggregate_e::MAX:
+            if( acc.num_values == 0 || acc.max < v )
+                acc.max = v;
+            break;
+
+        default:
+            break;
+        }
+
+        ++acc.num_values;
+    }
+}
+
+std::vector<AggregateRow> Aggregator::get_result() const
+{
+    std::vector<AggregateRow> res;
+
+    res.reserve( map_key_to_group_.size() + 1 );
+
+    for( auto & e : map_key_to_group_ )
+        res.push_back( get_row( true, e.first, e.second ) );
+
+    std::sort( res.begin(), res.end(),
+            []( const AggregateRow & a, const AggregateRow & b )
+            {
+                return a.group_key < b.group_key;
+            } );
+
+    // without grouping, there is exactly one row even for no records
+
+    if( group_without_key_.count || is_grouped_ == false )
+        res.push_back( get_row( false, Value(), group_without_key_ ) );
+
+    return res;
+}
+
+AggregateRow Aggregator::get_row( bool has_group_key, const Value & group_key, const Group & group ) const
+{
+    AggregateRow res = { has_group_key, group_key, std::vector<Value>( aggregates_.size() ) };
+
+    for( std::size_t i = 0; i < aggregates_.size(); ++i )
+    {
+        auto & acc = group.accumulators[ i ];
+
+        auto & v = res.values[ i ];
+
+        if( aggregates_[ i ].op == aggregate_e::COUNT )
+        {
+            v = Value( static_cast<int64_t>( group.count ) );
+            continue;
+        }
+
+        if( acc.num_values == 0 )
+            continue;
+
+        switch( aggregates_[ i ].op )
+        {
+        case aggregate_e::SUM:
+            v = acc.is_double ? Value( acc.sum_double + acc.sum_int ) : Value( acc.sum_int );
+            break;
+
+        case aggregate_e::AVG:
+            v = Value( ( acc.sum_double + acc.sum_int ) / acc.num_values );
+            break;
+
+        case aggregate_e::MIN:
+            v = acc.min;
+            break;
+
+        case aggregate_e::MAX:
+            v = acc.max;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return res;
+}
+
+} // namespace anyvalue_db
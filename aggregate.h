@@ -0,0 +1,121 @@
+/*
+
+Aggregation of records.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__AGGREGATE_H
+#define ANYVALUE_DB__AGGREGATE_H
+
+#include <cstdint>          // uint64_t
+#include <vector>           // std::vector
+#include <unordered_map>    // std::unordered_map
+
+#include "types.h"          // field_id_t
+#include "value.h"          // Value
+#include "value_hash.h"     // ValueHash
+
+namespace anyvalue_db
+{
+
+class Record;
+
+enum class aggregate_e
+{
+    COUNT,      // records of the group, the field is ignored
+    SUM,        // INT, if all values are INT, otherwise DOUBLE; values of other types are ignored
+    MIN,
+    MAX,
+    AVG,        // DOUBLE
+};
+
+struct Aggregate
+{
+    aggregate_e     op;
+    field_id_t      field_id;
+};
+
+struct AggregateRow
+{
+    bool                has_group_key;  // false for records without the group field and if there is no grouping
+    Value               group_key;
+    std::vector<Value>  values;         // one per aggregate, UNDEF, if the group has no values of the field
+};
+
+/**
+ * @brief Aggregates records in one pass, groups are kept in a hash table.
+ */
+class Aggregator
+{
+public:
+
+    /**
+     * @param is_grouped    if false, there is exactly one row even for no records
+     */
+    Aggregator( const std::vector<Aggregate> & aggregates, bool is_grouped );
+
+    void add( const Record & record );
+    void add( const Value & group_key, const Record & record );
+
+    /**
+     * @brief groups are ordered by their keys, the group without a key comes last
+     */
+    std::vector<AggregateRow> get_result() const;
+
+private:
+
+    struct Accumulator
+    {
+        uint64_t    num_values;
+        bool        is_double;
+        int64_t     sum_int;
+        double      sum_double;
+        Value       min;
+        Value       max;
+
+        Accumulator();
+    };
+
+    struct Group
+    {
+        uint64_t                    count;
+        std::vector<Accumulator>    accumulators;
+    };
+
+    typedef std::unordered_map<Value,Group,ValueHash,ValueEqual>    MapValueToGroup;
+
+private:
+
+    void add( Group * group, const Record & record );
+
+    AggregateRow get_row( bool has_group_key, const Value & group_key, const Group & group ) const;
+
+private:
+
+    std::vector<Aggregate>  aggregates_;
+    bool                    is_grouped_;
+
+    MapValueToGroup         map_key_to_group_;
+    Group                   group_without_key_;
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__AGGREGATE_H
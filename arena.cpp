@@ -0,0 +1,141 @@
+/*
+
+Arena. Slab allocator for small objects.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "arena.h"          // self
+
+#include <new>              // operator new
+
+namespace anyvalue_db
+{
+
+Arena::Arena():
+        cur_( nullptr ),
+        end_( nullptr ),
+        free_lists_( MAX_BLOCK_SIZE / ALIGNMENT + 1, nullptr ),
+        reserved_size_( 0 ),
+        requested_size_( 0 )
+{
+}
+
+Arena::~Arena()
+{
+    for( auto & e : slabs_ )
+    {
+        ::operator delete( const_cast<char*>( e.first ) );
+    }
+}
+
+std::size_t Arena::get_size_class( std::size_t size )
+{
+    if( size == 0 )
+        return 1;
+
+    return ( size + ALIGNMENT - 1 ) / ALIGNMENT;
+}
+
+void Arena::add_slab()
+{
+    auto slab = static_cast<char*>( ::operator new( SLAB_SIZE ) );
+
+    slabs_.insert( std::make_pair( slab, slab + SLAB_SIZE ) );
+
+    reserved_size_ += SLAB_SIZE;
+
+    cur_    = slab;
+    end_    = slab + SLAB_SIZE;
+}
+
+void* Arena::allocate( std::size_t size )
+{
+    if( size > MAX_BLOCK_SIZE )
+        return ::operator new( size );
+
+    auto size_class = get_size_class( size );
+
+    requested_size_ += size;
+
+    auto & free_list = free_lists_[ size_class ];
+
+    if( free_list )
+    {
+        auto res    = free_list;
+        free_list   = res->next;
+
+        return res;
+    }
+
+    auto block_size = size_class * ALIGNMENT;
+
+    if( cur_ == nullptr || std::size_t( end_ - cur_ ) < block_size )
+        add_slab();     // the tail of the previous slab is wasted
+
+    auto res = cur_;
+
+    cur_ += block_size;
+
+    return res;
+}
+
+void Arena::deallocate( void * p, std::size_t size )
+{
+    if( size > MAX_BLOCK_SIZE )
+    {
+        ::operator delete( p );
+        return;
+    }
+
+    requested_size_ -= size;
+
+    auto & free_list = free_lists_[ get_size_class( size ) ];
+
+    auto block = static_cast<FreeBlock*>( p );
+
+    block->next = free_list;
+    free_list   = block;
+}
+
+uint64_t Arena::get_reserved_size() const
+{
+    return reserved_size_;
+}
+
+uint64_t Arena::get_requested_size() const
+{
+    return requested_size_;
+}
+
+bool Arena::owns( const void * p ) const
+{
+    auto c = static_cast<const char*>( p );
+
+    auto it = slabs_.upper_bound( c );
+
+    if( it == slabs_.begin() )
+        return false;
+
+    --it;
+
+    return c < it->second;
+}
+
+} // namespace anyvalue_db
@@ -0,0 +1,164 @@
+/*
+
+Arena. Slab allocator for small objects.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__ARENA_H
+#define ANYVALUE_DB__ARENA_H
+
+#include <atomic>           // std::atomic
+#include <cstddef>          // std::size_t
+#include <cstdint>          // uint64_t
+#include <map>              // std::map
+#include <vector>           // std::vector
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief Bump pointer allocator working on large slabs.
+ *
+ * Freed blocks go to a free list of their size class and are reused by the next allocation of that class.
+ * Memory is returned to the system only when the arena is destroyed.
+ * Blocks larger than MAX_BLOCK_SIZE are forwarded to operator new.
+ * Not thread-safe, the owner is responsible for locking.
+ */
+class Arena
+{
+public:
+
+    static const std::size_t SLAB_SIZE      = 256 * 1024;
+    static const std::size_t ALIGNMENT      = 16;
+    static const std::size_t MAX_BLOCK_SIZE = 512;
+
+public:
+
+    Arena();
+    ~Arena();
+
+    Arena( const Arena & )              = delete;
+    Arena & operator=( const Arena & )  = delete;
+
+    void* allocate( std::size_t size );
+    void deallocate( void * p, std::size_t size );
+
+    bool owns( const void * p ) const;
+
+    // can be called without lock
+
+    uint64_t get_reserved_size() const;
+    uint64_t get_requested_size() const;
+
+private:
+
+    struct FreeBlock
+    {
+        FreeBlock   * next;
+    };
+
+    typedef std::map<const char*,const char*>   MapBeginToEnd;
+
+private:
+
+    static std::size_t get_size_class( std::size_t size );
+
+    void add_slab();
+
+private:
+
+    char                    * cur_;
+    char                    * end_;
+
+    MapBeginToEnd           slabs_;
+
+    std::vector<FreeBlock*> free_lists_;
+
+    std::atomic<uint64_t>   reserved_size_;     // size of all slabs
+    std::atomic<uint64_t>   requested_size_;    // sum of sizes of live blocks as requested by callers
+};
+
+/**
+ * @brief STL allocator on top of Arena. Without arena it falls back to operator new.
+ */
+template<class T>
+class ArenaAllocator
+{
+    template<class U>
+    friend class ArenaAllocator;
+
+public:
+
+    typedef T value_type;
+
+public:
+
+    ArenaAllocator( Arena * arena = nullptr ):
+        arena_( arena )
+    {
+    }
+
+    template<class U>
+    ArenaAllocator( const ArenaAllocator<U> & other ):
+        arena_( other.arena_ )
+    {
+    }
+
+    T* allocate( std::size_t n )
+    {
+        if( arena_ )
+            return static_cast<T*>( arena_->allocate( n * sizeof( T ) ) );
+
+        return static_cast<T*>( ::operator new( n * sizeof( T ) ) );
+    }
+
+    void deallocate( T * p, std::size_t n )
+    {
+        if( arena_ )
+            arena_->deallocate( p, n * sizeof( T ) );
+        else
+            ::operator delete( p );
+    }
+
+    Arena* get_arena() const
+    {
+        return arena_;
+    }
+
+    template<class U>
+    bool operator==( const ArenaAllocator<U> & other ) const
+    {
+        return arena_ == other.arena_;
+    }
+
+    template<class U>
+    bool operator!=( const ArenaAllocator<U> & other ) const
+    {
+        return arena_ != other.arena_;
+    }
+
+private:
+
+    Arena   * arena_;
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__ARENA_H
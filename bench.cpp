@@ -0,0 +1,417 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>               // std::thread
+#include <chrono>               // std::chrono
+#include <random>               // std::mt19937
+#include <algorithm>            // std::min
+#include <cstdio>               // std::remove
+
+#include "db.h"                 // DB
+
+#include "utils/mutex_helper.h"         // MUTEX_SCOPE_LOCK
+
+// Microbenchmarks.
+//
+// usage: bench [rows[,rows...]] [threads[,threads...]]
+//
+// Results are written to stdout as CSV: name,rows,threads,ops,seconds,ops_per_sec
+// errors and progress go to stderr.
+
+const int ID            = 1;
+const int LOGIN         = 2;
+const int PASSWORD      = 3;
+const int LAST_NAME     = 4;
+const int FIRST_NAME    = 5;
+const int EMAIL         = 6;
+const int PHONE         = 7;
+const int REG_KEY       = 8;
+const int STATUS        = 10;
+
+const std::size_t MAX_LOOKUPS       = 1000000;
+const std::size_t MAX_UPDATES       = 100000;
+const std::size_t MAX_SCANNED       = 10000000;     // records visited by all iterations of a select
+
+typedef std::chrono::steady_clock   Clock;
+
+class Timer
+{
+public:
+    Timer():
+        start_( Clock::now() )
+    {
+    }
+
+    double get_seconds() const
+    {
+        return std::chrono::duration<double>( Clock::now() - start_ ).count();
+    }
+
+private:
+    Clock::time_point   start_;
+};
+
+void report( const std::string & name, std::size_t rows, std::size_t threads, std::size_t ops, double seconds )
+{
+    std::cout << name << "," << rows << "," << threads << "," << ops << "," << seconds << "," << ( seconds > 0 ? ops / seconds : 0 ) << std::endl;
+}
+
+std::vector<std::size_t> parse_list( const std::string & s )
+{
+    std::vector<std::size_t> res;
+
+    std::size_t pos = 0;
+
+    while( pos < s.size() )
+    {
+        auto end = s.find( ',', pos );
+
+        if( end == std::string::npos )
+            end = s.size();
+
+        res.push_back( std::stoull( s.substr( pos, end - pos ) ) );
+
+        pos = end + 1;
+    }
+
+    return res;
+}
+
+anyvalue_db::Record * create_record( std::size_t i )
+{
+    auto s = std::to_string( i );
+
+    auto res = new anyvalue_db::Record( {
+        { ID,           int( i ) },
+        { LOGIN,        "user" + s },
+        { PASSWORD,     std::string( "xxx" ) },
+        { LAST_NAME,    std::string( "Doe" ) },
+        { FIRST_NAME,   std::string( "John" ) },
+        { EMAIL,        "john.doe." + s + "@yoyodyne.com" },
+        { PHONE,        std::string( "+1234567890" ) },
+        { REG_KEY,      "key" + s },
+        { STATUS,       int( i % 3 ) } } );
+
+    return res;
+}
+
+std::vector<int> get_random_ids( std::size_t rows, std::size_t n, unsigned seed )
+{
+    std::mt19937 gen( seed );
+    std::uniform_int_distribution<std::size_t> dist( 0, rows - 1 );
+
+    std::vector<int> res( n );
+
+    for( auto & e : res )
+        e = int( dist( gen ) );
+
+    return res;
+}
+
+void bench_add_record( anyvalue_db::Table * table, std::size_t rows )
+{
+    table->init( std::vector<anyvalue_db::field_id_t>( { ID, LOGIN, REG_KEY } ));
+
+    std::vector<anyvalue_db::Record*> records( rows );
+
+    for( std::size_t i = 0; i < rows; ++i )
+        records[ i ] = create_record( i );
+
+    std::string error_msg;
+
+    Timer timer;
+
+    for( auto & e : records )
+    {
+        if( table->add_record( e, & error_msg ) == false )
+        {
+            std::cerr << "ERROR: add_record: " << error_msg << std::endl;
+            delete e;
+        }
+    }
+
+    report( "add_record", rows, 1, rows, timer.get_seconds() );
+}
+
+void bench_find( anyvalue_db::Table & table, std::size_t rows )
+{
+    auto ids = get_random_ids( rows, std::min( rows, MAX_LOOKUPS ), 1 );
+
+    std::size_t num_found = 0;
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    Timer timer;
+
+    for( auto id : ids )
+    {
+        if( table.find__unlocked( ID, id ) )
+            ++num_found;
+    }
+
+    report( "find", rows, 1, ids.size(), timer.get_seconds() );
+
+    if( num_found != ids.size() )
+        std::cerr << "ERROR: find: found " << num_found << " of " << ids.size() << std::endl;
+}
+
+void bench_select( anyvalue_db::Table & table, std::size_t rows, const std::string & name, bool is_or, const std::vector<anyvalue_db::Table::SelectCondition> & conditions )
+{
+    auto iterations = std::max<std::size_t>( 1, MAX_SCANNED / rows );
+
+    std::size_t num_selected = 0;
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    Timer timer;
+
+    for( std::size_t i = 0; i < iterations; ++i )
+    {
+        if( conditions.size() == 1 )
+            num_selected += table.select__unlocked( conditions.front() ).size();
+        else
+            num_selected += table.select__unlocked( is_or, conditions ).size();
+    }
+
+    report( name, rows, 1, iterations, timer.get_seconds() );
+
+    if( num_selected == 0 )
+        std::cerr << "ERROR: " << name << ": nothing selected" << std::endl;
+}
+
+void bench_selects( anyvalue_db::Table & table, std::size_t rows )
+{
+    anyvalue_db::Table::SelectCondition status     = { STATUS, anyvalue::comparison_type_e::EQ, 1 };
+    anyvalue_db::Table::SelectCondition last_name  = { LAST_NAME, anyvalue::comparison_type_e::EQ, std::string( "Doe" ) };
+    anyvalue_db::Table::SelectCondition email      = { EMAIL, anyvalue::comparison_type_e::EQ, std::string( "john.doe.1@yoyodyne.com" ) };
+
+    bench_select( table, rows, "select_single", false, { status } );
+    bench_select( table, rows, "select_and", false, { status, last_name } );
+    bench_select( table, rows, "select_or", true, { status, email } );
+}
+
+void bench_update( anyvalue_db::Table & table, std::size_t rows, const std::string & name, anyvalue_db::field_id_t field_id )
+{
+    auto ids = get_random_ids( rows, std::min( rows, MAX_UPDATES ), 2 );
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    // records are looked up in advance, so that only the update itself is measured
+
+    std::vector<anyvalue_db::Record*> records;
+
+    records.reserve( ids.size() );
+
+    for( auto id : ids )
+        records.push_back( table.find__unlocked( ID, id ) );
+
+    std::size_t num_failed = 0;
+
+    Timer timer;
+
+    for( std::size_t i = 0; i < records.size(); ++i )
+    {
+        // indexed values must stay unique, so the value is derived from the id
+
+        if( records[ i ]->update_field( field_id, name + "_" + std::to_string( ids[ i ] ) + "_" + std::to_string( i ) ) == false )
+            ++num_failed;
+    }
+
+    report( name, rows, 1, records.size(), timer.get_seconds() );
+
+    if( num_failed )
+        std::cerr << "ERROR: " << name << ": " << num_failed << " updates failed" << std::endl;
+}
+
+void bench_threads( anyvalue_db::Table & table, std::size_t rows, std::size_t num_readers, std::size_t num_writers )
+{
+    auto ops = std::min( rows, MAX_LOOKUPS );
+
+    auto num_threads = num_readers + num_writers;
+
+    std::vector<std::thread> threads;
+
+    Timer timer;
+
+    for( std::size_t t = 0; t < num_threads; ++t )
+    {
+        auto is_writer = t >= num_readers;
+
+        threads.push_back( std::thread( [&table, rows, ops, num_threads, is_writer, t]()
+                {
+                    auto ids = get_random_ids( rows, ops / num_threads, unsigned( 100 + t ) );
+
+                    for( auto id : ids )
+                    {
+                        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+                        auto rec = table.find__unlocked( ID, id );
+
+                        if( is_writer && rec )
+                            rec->update_field( PHONE, std::string( "+49" ) + std::to_string( id ) );
+                    }
+                } ) );
+    }
+
+    for( auto & e : threads )
+        e.join();
+
+    auto name = num_writers == 0 ? "find_mt" : ( num_readers == 0 ? "update_mt" : "find_update_mt" );
+
+    report( name, rows, num_threads, ops / num_threads * num_threads, timer.get_seconds() );
+}
+
+anyvalue_db::Table* bench_table_save_load( const anyvalue_db::Table & table, std::size_t rows )
+{
+    static const std::string filename = "bench_table.dat";
+
+    std::string error_msg;
+
+    Timer timer;
+
+    if( table.save( & error_msg, filename ) == false )
+    {
+        std::cerr << "ERROR: table_save: " << error_msg << std::endl;
+        return nullptr;
+    }
+
+    report( "table_save", rows, 1, 1, timer.get_seconds() );
+
+    auto res = new anyvalue_db::Table;
+
+    Timer timer_2;
+
+    try
+    {
+        res->init( filename );
+    }
+    catch( std::exception & e )
+    {
+        std::cerr << "ERROR: table_load: " << e.what() << std::endl;
+        delete res;
+        return nullptr;
+    }
+
+    report( "table_load", rows, 1, 1, timer_2.get_seconds() );
+
+    std::remove( filename.c_str() );
+
+    return res;
+}
+
+void bench_db_save_load( anyvalue_db::Table * table, std::size_t rows )
+{
+    static const std::string filename = "bench.db";
+
+    std::string error_msg;
+
+    {
+        anyvalue_db::DB db;
+
+        db.init();
+
+        if( db.add_table( "users", table, & error_msg ) == false )
+        {
+            std::cerr << "ERROR: db_save: " << error_msg << std::endl;
+            delete table;
+            return;
+        }
+
+        Timer timer;
+
+        if( db.save( & error_msg, filename ) == false )
+        {
+            std::cerr << "ERROR: db_save: " << error_msg << std::endl;
+            return;
+        }
+
+        report( "db_save", rows, 1, 1, timer.get_seconds() );
+    }
+
+    anyvalue_db::DB db;
+
+    Timer timer;
+
+    if( db.init( filename ) == false )
+    {
+        std::cerr << "ERROR: db_load: cannot load " << filename << std::endl;
+        return;
+    }
+
+    report( "db_load", rows, 1, 1, timer.get_seconds() );
+
+    std::remove( filename.c_str() );
+}
+
+void bench_delete( anyvalue_db::Table & table, std::size_t rows )
+{
+    auto num = std::min( rows, MAX_UPDATES );
+
+    std::string error_msg;
+
+    std::size_t num_failed = 0;
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    Timer timer;
+
+    // every n-th record, so that deletions are spread over the table
+
+    auto step = rows / num;
+
+    for( std::size_t i = 0; i < num; ++i )
+    {
+        if( table.delete_record__unlocked( ID, int( i * step ), & error_msg ) == false )
+            ++num_failed;
+    }
+
+    report( "delete_record", rows, 1, num, timer.get_seconds() );
+
+    if( num_failed )
+        std::cerr << "ERROR: delete_record: " << num_failed << " deletions failed" << std::endl;
+}
+
+void run( std::size_t rows, const std::vector<std::size_t> & thread_counts )
+{
+    std::cerr << "rows " << rows << std::endl;
+
+    anyvalue_db::Table table;
+
+    bench_add_record( & table, rows );
+    bench_find( table, rows );
+    bench_selects( table, rows );
+    bench_update( table, rows, "update_indexed", LOGIN );
+    bench_update( table, rows, "update_unindexed", PHONE );
+
+    for( auto n : thread_counts )
+    {
+        bench_threads( table, rows, n, 0 );
+        bench_threads( table, rows, 0, n );
+        bench_threads( table, rows, n, n );
+    }
+
+    auto loaded = bench_table_save_load( table, rows );
+
+    if( loaded )
+        bench_db_save_load( loaded, rows );
+
+    bench_delete( table, rows );
+}
+
+int main( int argc, char ** argv )
+{
+    auto rows_list      = parse_list( argc > 1 ? argv[1] : "10000,1000000,10000000" );
+    auto thread_counts  = parse_list( argc > 2 ? argv[2] : "1,2,4,8" );
+
+    std::cout << "name,rows,threads,ops,seconds,ops_per_sec" << std::endl;
+
+    for( auto rows : rows_list )
+    {
+        if( rows == 0 )
+            continue;
+
+        run( rows, thread_counts );
+    }
+
+    return 0;
+}
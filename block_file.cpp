@@ -0,0 +1,639 @@
+/*
+
+Block File. Framed, optionally compressed container for serialized data.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "block_file.h"     // self
+
+#include <fstream>          // std::ifstream
+#include <sstream>          // std::ostringstream
+#include <vector>           // std::vector
+#include <algorithm>        // std::min
+#include <cstring>          // memcmp
+#include <cstdint>          // uint32_t
+#include <cerrno>           // errno
+
+#include <fcntl.h>          // open
+#include <unistd.h>         // write, fsync, close
+
+#include "lz_codec.h"       // LzCodec
+#include "crc32c.h"         // Crc32c
+#include "parallel_helper.h"    // run_parallel
+
+namespace anyvalue_db
+{
+
+namespace
+{
+
+const char      MAGIC[4]    = { 'A', 'V', 'D', 'B' };
+const uint32_t  VERSION     = 1;
+
+const uint32_t  FLAG_LZ         = 0x01;
+const uint32_t  FLAG_CRC32C     = 0x02;
+const uint32_t  FLAG_SECTIONS   = 0x04;
+
+struct BlockInfo
+{
+    uint32_t    raw_size;
+    uint32_t    stored_size;
+    uint32_t    crc;
+    std::size_t stored_offset;
+};
+
+struct SectionInfo
+{
+    std::string name;
+    uint32_t    first_block;
+    uint32_t    num_blocks;
+};
+
+struct Header
+{
+    uint32_t                    flags;
+    std::vector<BlockInfo>      blocks;
+    std::vector<SectionInfo>    sections;
+};
+
+void write_32( std::string * res, uint32_t v )
+{
+    for( int i = 0; i < 4; ++i )
+        res->push_back( char( ( v >> ( 8 * i ) ) & 0xFF ) );
+}
+
+bool read_32( const std::string & data, std::size_t * pos, uint32_t * v )
+{
+    if( data.size() < * pos + 4 )
+        return false;
+
+    * v = 0;
+
+    for( int i = 0; i < 4; ++i )
+        * v |= uint32_t( static_cast<unsigned char>( data[ * pos + i ] ) ) << ( 8 * i );
+
+    * pos += 4;
+
+    return true;
+}
+
+/**
+ * @brief reads 4 bytes from the stream, appends them to res and parses them at *pos
+ */
+bool read_32( std::istream & is, std::string * res, std::size_t * pos, uint32_t * v )
+{
+    char buf[4];
+
+    is.read( buf, sizeof( buf ) );
+
+    if( is.gcount() != sizeof( buf ) )
+        return false;
+
+    res->append( buf, sizeof( buf ) );
+
+    return read_32( * res, pos, v );
+}
+
+std::string get_directory( const std::string & filename )
+{
+    auto pos = filename.find_last_of( '/' );
+
+    if( pos == std::string::npos )
+        return ".";
+
+    if( pos == 0 )
+        return "/";
+
+    return filename.substr( 0, pos );
+}
+
+bool write_all( int fd, const char * data, std::size_t size )
+{
+    while( size > 0 )
+    {
+        auto res = ::write( fd, data, size );
+
+        if( res < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            return false;
+        }
+
+        data    += res;
+        size    -= res;
+    }
+
+    return true;
+}
+
+bool is_block_file( std::istream & is )
+{
+    char buf[ sizeof( MAGIC ) ];
+
+    is.read( buf, sizeof( buf ) );
+
+    if( is.gcount() == sizeof( buf ) && memcmp( buf, MAGIC, sizeof( MAGIC ) ) == 0 )
+        return true;
+
+    is.clear();
+    is.seekg( 0 );
+
+    return false;
+}
+
+/**
+ * @brief number of bytes between the current position and the end of the stream
+ */
+uint64_t get_remaining_size( std::istream & is )
+{
+    auto pos = is.tellg();
+
+    is.seekg( 0, std::ios::end );
+
+    auto end = is.tellg();
+
+    is.seekg( pos );
+
+    if( pos < 0 || end < pos )
+        return 0;
+
+    return uint64_t( end - pos );
+}
+
+bool read_header( std::string * error_msg, std::istream & is, Header * res )
+{
+    std::string raw( MAGIC, sizeof( MAGIC ) );
+
+    std::size_t pos = sizeof( MAGIC );
+
+    uint32_t version, block_size, num_blocks;
+
+    if( read_32( is, & raw, & pos, & version ) == false || read_32( is, & raw, & pos, & res->flags ) == false
+            || read_32( is, & raw, & pos, & block_size ) == false || read_32( is, & raw, & pos, & num_blocks ) == false )
+    {
+        * error_msg = "truncated header";
+        return false;
+    }
+
+    if( version != VERSION )
+    {
+        * error_msg = "unsupported version " + std::to_string( version );
+        return false;
+    }
+
+    // checksums are mandatory, otherwise a single bit flip in the flags would turn off all verification
+
+    if( ( res->flags & FLAG_CRC32C ) == 0 )
+    {
+        * error_msg = "corrupt header: checksums are missing";
+        return false;
+    }
+
+    // the header checksum follows the tables, so the counts are checked against the file size before allocating
+
+    if( uint64_t( num_blocks ) * 12 > get_remaining_size( is ) )
+    {
+        * error_msg = "corrupt header: " + std::to_string( num_blocks ) + " blocks exceed file size";
+        return false;
+    }
+
+    res->blocks.resize( num_blocks );
+
+    for( auto & b : res->blocks )
+    {
+        if( read_32( is, & raw, & pos, & b.raw_size ) == false || read_32( is, & raw, & pos, & b.stored_size ) == false
+                || read_32( is, & raw, & pos, & b.crc ) == false )
+        {
+            * error_msg = "truncated block table";
+            return false;
+        }
+    }
+
+    if( res->flags & FLAG_SECTIONS )
+    {
+        uint32_t num_sections;
+
+        if( read_32( is, & raw, & pos, & num_sections ) == false )
+        {
+            * error_msg = "truncated section table";
+            return false;
+        }
+
+        if( uint64_t( num_sections ) * 12 > get_remaining_size( is ) )
+        {
+            * error_msg = "corrupt header: " + std::to_string( num_sections ) + " sections exceed file size";
+            return false;
+        }
+
+        res->sections.resize( num_sections );
+
+        for( auto & e : res->sections )
+        {
+            uint32_t len;
+
+            if( read_32( is, & raw, & pos, & len ) == false )
+            {
+                * error_msg = "truncated section table";
+                return false;
+            }
+
+            if( len > get_remaining_size( is ) )
+            {
+                * error_msg = "corrupt header: section name of " + std::to_string( len ) + " bytes exceeds file size";
+                return false;
+            }
+
+            e.name.resize( len );
+
+            is.read( & e.name[0], len );
+
+            if( std::size_t( is.gcount() ) != len )
+            {
+                * error_msg = "truncated section table";
+                return false;
+            }
+
+            raw.append( e.name );
+            pos += len;
+
+            if( read_32( is, & raw, & pos, & e.first_block ) == false || read_32( is, & raw, & pos, & e.num_blocks ) == false )
+            {
+                * error_msg = "truncated section table";
+                return false;
+            }
+
+            if( e.first_block + uint64_t( e.num_blocks ) > num_blocks )
+            {
+                * error_msg = "invalid section " + e.name;
+                return false;
+            }
+        }
+    }
+    else
+    {
+        res->sections.push_back( SectionInfo { std::string(), 0, num_blocks } );
+    }
+
+    auto header_size = pos;
+
+    uint32_t header_crc;
+
+    if( read_32( is, & raw, & pos, & header_crc ) == false )
+    {
+        * error_msg = "truncated header";
+        return false;
+    }
+
+    if( Crc32c::calc( raw.data(), header_size ) != header_crc )
+    {
+        * error_msg = "header checksum mismatch";
+        return false;
+    }
+
+    for( auto & b : res->blocks )
+    {
+        b.stored_offset = pos;
+        pos             += b.stored_size;
+    }
+
+    return true;
+}
+
+bool read_blocks( std::string * error_msg, std::istream & is, const Header & header, uint32_t first_block, uint32_t num_blocks, std::string * data )
+{
+    data->clear();
+
+    if( num_blocks == 0 )
+        return true;
+
+    auto & blocks       = header.blocks;
+    auto stored_begin   = blocks[ first_block ].stored_offset;
+
+    std::size_t stored_size = 0;
+    std::size_t raw_size    = 0;
+
+    for( uint32_t i = first_block; i < first_block + num_blocks; ++i )
+    {
+        stored_size += blocks[ i ].stored_size;
+        raw_size    += blocks[ i ].raw_size;
+    }
+
+    std::string stored( stored_size, '\0' );
+
+    is.seekg( stored_begin );
+    is.read( & stored[0], stored_size );
+
+    auto read_size = is.gcount();
+
+    for( uint32_t i = first_block; i < first_block + num_blocks; ++i )
+    {
+        if( std::size_t( read_size ) < blocks[ i ].stored_offset - stored_begin + blocks[ i ].stored_size )
+        {
+            * error_msg = "block " + std::to_string( i ) + " of " + std::to_string( blocks.size() ) + " is truncated";
+            return false;
+        }
+    }
+
+    data->resize( raw_size );
+
+    std::vector<char> is_crc_ok( num_blocks, 0 );
+    std::vector<char> is_ok( num_blocks, 0 );
+
+    std::vector<std::size_t> stored_offsets( num_blocks );
+    std::vector<std::size_t> raw_offsets( num_blocks );
+
+    for( uint32_t i = 0; i < num_blocks; ++i )
+    {
+        stored_offsets[ i ] = blocks[ first_block + i ].stored_offset - stored_begin;
+        raw_offsets[ i ]    = i ? raw_offsets[ i - 1 ] + blocks[ first_block + i - 1 ].raw_size : 0;
+    }
+
+    run_parallel( num_blocks, [&]( std::size_t i )
+            {
+                auto & b    = blocks[ first_block + i ];
+                auto src    = stored.data() + stored_offsets[ i ];
+                auto dst    = & ( * data )[ raw_offsets[ i ] ];
+
+                if( Crc32c::calc( src, b.stored_size ) != b.crc )
+                    return;
+
+                is_crc_ok[ i ] = 1;
+
+                if( b.stored_size == b.raw_size )
+                {
+                    memcpy( dst, src, b.raw_size );
+                    is_ok[ i ] = 1;
+                }
+                else if( header.flags & FLAG_LZ )
+                {
+                    is_ok[ i ] = LzCodec::decompress( dst, b.raw_size, src, b.stored_size );
+                }
+            } );
+
+    for( uint32_t i = 0; i < num_blocks; ++i )
+    {
+        auto block_id = std::to_string( first_block + i ) + " of " + std::to_string( blocks.size() );
+
+        if( is_crc_ok[ i ] == 0 )
+        {
+            * error_msg = "block " + block_id + ": checksum mismatch at offset " + std::to_string( blocks[ first_block + i ].stored_offset );
+            return false;
+        }
+
+        if( is_ok[ i ] == 0 )
+        {
+            * error_msg = "cannot decode block " + block_id;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+bool BlockFile::save( std::string * error_msg, const std::string & filename, const std::string & data, bool is_compressed )
+{
+    return save( error_msg, filename, std::vector<Section>( 1, Section( std::string(), data ) ), is_compressed );
+}
+
+bool BlockFile::save( std::string * error_msg, const std::string & filename, const std::vector<Section> & sections, bool is_compressed )
+{
+    struct BlockRef
+    {
+        const std::string   * data;
+        std::size_t         offset;
+        std::size_t         size;
+    };
+
+    std::vector<BlockRef>       refs;
+    std::vector<SectionInfo>    section_infos;
+
+    for( auto & e : sections )
+    {
+        auto & data = e.second;
+
+        section_infos.push_back( SectionInfo { e.first, static_cast<uint32_t>( refs.size() ), 0 } );
+
+        for( std::size_t offset = 0; offset < data.size(); offset += BLOCK_SIZE )
+        {
+            refs.push_back( BlockRef { & data, offset, std::min<std::size_t>( BLOCK_SIZE, data.size() - offset ) } );
+
+            ++section_infos.back().num_blocks;
+        }
+    }
+
+    auto num_blocks = refs.size();
+
+    std::vector<std::string>    blocks( num_blocks );
+    std::vector<uint32_t>       crcs( num_blocks );
+
+    run_parallel( num_blocks, [&]( std::size_t i )
+            {
+                auto & r    = refs[ i ];
+                auto src    = r.data->data() + r.offset;
+
+                if( is_compressed )
+                    LzCodec::compress( & blocks[ i ], src, r.size );
+
+                if( is_compressed == false || blocks[ i ].size() >= r.size )
+                    blocks[ i ].assign( src, r.size );      // incompressible or plain, store as is
+
+                crcs[ i ] = Crc32c::calc( blocks[ i ].data(), blocks[ i ].size() );
+            } );
+
+    std::string header;
+
+    header.append( MAGIC, sizeof( MAGIC ) );
+    write_32( & header, VERSION );
+    write_32( & header, FLAG_CRC32C | FLAG_SECTIONS | ( is_compressed ? FLAG_LZ : 0 ) );
+    write_32( & header, BLOCK_SIZE );
+    write_32( & header, static_cast<uint32_t>( num_blocks ) );
+
+    for( std::size_t i = 0; i < num_blocks; ++i )
+    {
+        write_32( & header, static_cast<uint32_t>( refs[ i ].size ) );
+        write_32( & header, static_cast<uint32_t>( blocks[ i ].size() ) );
+        write_32( & header, crcs[ i ] );
+    }
+
+    write_32( & header, static_cast<uint32_t>( section_infos.size() ) );
+
+    for( auto & e : section_infos )
+    {
+        write_32( & header, static_cast<uint32_t>( e.name.size() ) );
+        header.append( e.name );
+        write_32( & header, e.first_block );
+        write_32( & header, e.num_blocks );
+    }
+
+    write_32( & header, Crc32c::calc( header.data(), header.size() ) );
+
+    auto fd = ::open( filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+    if( fd < 0 )
+    {
+        * error_msg =  "cannot open file " + filename;
+        return false;
+    }
+
+    auto b = write_all( fd, header.data(), header.size() );
+
+    for( std::size_t i = 0; i < num_blocks && b; ++i )
+        b = write_all( fd, blocks[ i ].data(), blocks[ i ].size() );
+
+    if( b == false )
+    {
+        ::close( fd );
+        * error_msg =  "cannot write file " + filename;
+        return false;
+    }
+
+    if( ::fsync( fd ) != 0 )
+    {
+        ::close( fd );
+        * error_msg =  "cannot sync file " + filename;
+        return false;
+    }
+
+    if( ::close( fd ) != 0 )
+    {
+        * error_msg =  "cannot close file " + filename;
+        return false;
+    }
+
+    return sync_directory( error_msg, filename );
+}
+
+bool BlockFile::sync_directory( std::string * error_msg, const std::string & filename )
+{
+    auto dir = get_directory( filename );
+
+    auto fd = ::open( dir.c_str(), O_RDONLY | O_DIRECTORY );
+
+    if( fd < 0 )
+    {
+        * error_msg =  "cannot open directory " + dir;
+        return false;
+    }
+
+    auto res = ::fsync( fd );
+
+    ::close( fd );
+
+    if( res != 0 )
+    {
+        * error_msg =  "cannot sync directory " + dir;
+        return false;
+    }
+
+    return true;
+}
+
+bool BlockFile::load( std::string * error_msg, const std::string & filename, std::string * data )
+{
+    std::ifstream is( filename, std::ios::binary );
+
+    if( is.fail() )
+    {
+        * error_msg =  "cannot open file " + filename;
+        return false;
+    }
+
+    if( is_block_file( is ) == false )
+    {
+        std::ostringstream content;
+
+        content << is.rdbuf();
+
+        * data = content.str();     // plain file
+
+        return true;
+    }
+
+    Header header;
+
+    if( read_header( error_msg, is, & header ) == false )
+        return false;
+
+    return read_blocks( error_msg, is, header, 0, static_cast<uint32_t>( header.blocks.size() ), data );
+}
+
+bool BlockFile::load_section_names( std::string * error_msg, const std::string & filename, std::vector<std::string> * names, bool * is_plain )
+{
+    std::ifstream is( filename, std::ios::binary );
+
+    if( is.fail() )
+    {
+        * error_msg =  "cannot open file " + filename;
+        return false;
+    }
+
+    * is_plain = ( is_block_file( is ) == false );
+
+    if( * is_plain )
+        return true;
+
+    Header header;
+
+    if( read_header( error_msg, is, & header ) == false )
+        return false;
+
+    for( auto & e : header.sections )
+        names->push_back( e.name );
+
+    return true;
+}
+
+bool BlockFile::load_section( std::string * error_msg, const std::string & filename, std::size_t section_id, std::string * data )
+{
+    std::ifstream is( filename, std::ios::binary );
+
+    if( is.fail() )
+    {
+        * error_msg =  "cannot open file " + filename;
+        return false;
+    }
+
+    if( is_block_file( is ) == false )
+    {
+        * error_msg = "file " + filename + " has no sections";
+        return false;
+    }
+
+    Header header;
+
+    if( read_header( error_msg, is, & header ) == false )
+        return false;
+
+    if( section_id >= header.sections.size() )
+    {
+        * error_msg = "section " + std::to_string( section_id ) + " not found";
+        return false;
+    }
+
+    auto & section = header.sections[ section_id ];
+
+    return read_blocks( error_msg, is, header, section.first_block, section.num_blocks, data );
+}
+
+} // namespace anyvalue_db
@@ -0,0 +1,70 @@
+/*
+
+Block File. Framed, optionally compressed container for serialized data.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__BLOCK_FILE_H
+#define ANYVALUE_DB__BLOCK_FILE_H
+
+#include <string>           // std::string
+#include <vector>           // std::vector
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief File level container.
+ *
+ * Layout: header ( magic "AVDB", version, flags, block size, number of blocks ),
+ * block table ( raw size, stored size, CRC32C of stored bytes per block ),
+ * section table ( name, first block, number of blocks per section ), CRC32C of all above, block data.
+ * Blocks are independent, so they are compressed, decompressed and verified in parallel.
+ * Checksums are mandatory, files without the CRC32C flag are rejected as corrupt.
+ * A section always starts with a new block, so a single section can be read without touching the others.
+ * Files without the magic are treated as plain (legacy) serializer output.
+ *
+ * save() writes the data and fsyncs the file and its parent directory,
+ * sync_directory() is to be called once more after the file has been renamed.
+ */
+class BlockFile
+{
+public:
+
+    static const unsigned   BLOCK_SIZE  = 64 * 1024;
+
+    typedef std::pair<std::string,std::string>  Section;    // name, data
+
+public:
+
+    static bool save( std::string * error_msg, const std::string & filename, const std::string & data, bool is_compressed );
+    static bool save( std::string * error_msg, const std::string & filename, const std::vector<Section> & sections, bool is_compressed );
+
+    static bool load( std::string * error_msg, const std::string & filename, std::string * data );
+
+    static bool load_section_names( std::string * error_msg, const std::string & filename, std::vector<std::string> * names, bool * is_plain );
+    static bool load_section( std::string * error_msg, const std::string & filename, std::size_t section_id, std::string * data );
+
+    static bool sync_directory( std::string * error_msg, const std::string & filename );
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__BLOCK_FILE_H
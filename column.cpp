@@ -0,0 +1,230 @@
+/*
+
+Column. Dense storage of one field for column-at-a-time scans.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "column.h"         // self
+
+#include "anyvalue/value_operations.h"  // anyvalue::compare_values
+#include "filter_kernels.h"             // FilterKernels
+
+#include <cassert>
+
+namespace anyvalue_db
+{
+
+void Column::resize( std::size_t size )
+{
+    assert( size >= values_.size() );
+
+    values_.resize( size );
+
+    // new slots are null, bits beyond the size are kept set, so they never match
+
+    nulls_.resize( ( size + 63 ) / 64, ~uint64_t( 0 ) );
+
+    ints_.resize( size );
+    is_int_.resize( nulls_.size() );
+    prefixes_.resize( size );
+    is_string_.resize( nulls_.size() );
+}
+
+void Column::set( uint32_t slot, const Value & value )
+{
+    assert( slot < values_.size() );
+
+    values_[ slot ] = value;
+
+    set_bit( slot, false, & nulls_ );
+
+    auto type = value.get_type();
+
+    set_bit( slot, type == anyvalue::type_e::INT, & is_int_ );
+    set_bit( slot, type == anyvalue::type_e::STRING, & is_string_ );
+
+    if( type == anyvalue::type_e::INT )
+        ints_[ slot ]       = value.get_int();
+    else if( type == anyvalue::type_e::STRING )
+        prefixes_[ slot ]   = FilterKernels::get_prefix( value.get_string() );
+}
+
+void Column::clear( uint32_t slot )
+{
+    assert( slot < values_.size() );
+
+    values_[ slot ] = Value();     // releases memory of the old value
+
+    set_bit( slot, true, & nulls_ );
+    set_bit( slot, false, & is_int_ );
+    set_bit( slot, false, & is_string_ );
+}
+
+void Column::set_bit( uint32_t slot, bool is_set, Bitmap * res )
+{
+    auto mask = uint64_t( 1 ) << ( slot % 64 );
+
+    if( is_set )
+        ( * res )[ slot / 64 ] |= mask;
+    else
+        ( * res )[ slot / 64 ] &= ~mask;
+}
+
+bool Column::is_null( uint32_t slot ) const
+{
+    return ( nulls_[ slot / 64 ] >> ( slot % 64 ) ) & 1;
+}
+
+const Value & Column::get( uint32_t slot ) const
+{
+    return values_[ slot ];
+}
+
+void Column::select( anyvalue::comparison_type_e op, const Value & value, Bitmap * res ) const
+{
+    init_bitmap( values_.size(), false, res );
+
+    auto type = value.get_type();
+
+    if( type == anyvalue::type_e::INT )
+    {
+        FilterKernels::compare_int( op, ints_.data(), ints_.size(), value.get_int(), res->data() );
+
+        and_bitmap( is_int_, res );
+
+        select_other( op, value, is_int_, res );
+    }
+    else if( type == anyvalue::type_e::STRING && ( op == anyvalue::comparison_type_e::EQ || op == anyvalue::comparison_type_e::NEQ ) )
+    {
+        select_string_prefix( value.get_string(), true, res );
+
+        if( op == anyvalue::comparison_type_e::NEQ )
+        {
+            for( std::size_t w = 0; w < res->size(); ++w )
+                ( * res )[ w ] = is_string_[ w ] & ~( * res )[ w ];
+        }
+
+        select_other( op, value, is_string_, res );
+    }
+    else
+    {
+        Bitmap none;
+
+        init_bitmap( values_.size(), false, & none );
+
+        select_other( op, value, none, res );
+    }
+}
+
+void Column::select_prefix( const std::string & prefix, Bitmap * res ) const
+{
+    init_bitmap( values_.size(), false, res );
+
+    select_string_prefix( prefix, false, res );
+}
+
+void Column::select_string_prefix( const std::string & prefix, bool is_exact, Bitmap * res ) const
+{
+    // the kernel finds candidates by the first bytes, longer strings are verified one by one
+
+    auto mask = FilterKernels::get_prefix_mask( is_exact ? sizeof( uint64_t ) : prefix.size() );
+
+    FilterKernels::equal_masked( prefixes_.data(), prefixes_.size(), FilterKernels::get_prefix( prefix ), mask, res->data() );
+
+    and_bitmap( is_string_, res );
+
+    // zero padding of short strings would match zero bytes of the prefix
+
+    auto is_verified = prefix.size() >= sizeof( uint64_t ) || is_exact || prefix.find( '\0' ) != std::string::npos;
+
+    if( is_verified == false )
+        return;
+
+    for( std::size_t w = 0; w < res->size(); ++w )
+    {
+        auto word = ( * res )[ w ];
+
+        while( word )
+        {
+            auto bit = __builtin_ctzll( word );
+
+            word &= word - 1;
+
+            auto & s = values_[ w * 64 + bit ].get_string();
+
+            auto is_match = is_exact ? s == prefix : s.compare( 0, prefix.size(), prefix ) == 0;
+
+            if( is_match == false )
+                ( * res )[ w ] &= ~( uint64_t( 1 ) << bit );
+        }
+    }
+}
+
+void Column::select_other( anyvalue::comparison_type_e op, const Value & value, const Bitmap & done, Bitmap * res ) const
+{
+    for( std::size_t w = 0; w < nulls_.size(); ++w )
+    {
+        // visit only non-null slots, which were not evaluated by a kernel
+
+        auto todo = ~nulls_[ w ] & ~done[ w ];
+
+        while( todo )
+        {
+            auto bit = __builtin_ctzll( todo );
+
+            todo &= todo - 1;
+
+            if( anyvalue::compare_values( op, values_[ w * 64 + bit ], value ) )
+                ( * res )[ w ] |= uint64_t( 1 ) << bit;
+        }
+    }
+}
+
+void Column::init_bitmap( std::size_t size, bool is_set, Bitmap * res )
+{
+    res->assign( ( size + 63 ) / 64, 0 );
+
+    if( is_set == false )
+        return;
+
+    for( std::size_t i = 0; i < size / 64; ++i )
+        ( * res )[ i ] = ~uint64_t( 0 );
+
+    if( size % 64 )
+        res->back() = ( uint64_t( 1 ) << ( size % 64 ) ) - 1;
+}
+
+void Column::and_bitmap( const Bitmap & other, Bitmap * res )
+{
+    assert( other.size() == res->size() );
+
+    for( std::size_t i = 0; i < res->size(); ++i )
+        ( * res )[ i ] &= other[ i ];
+}
+
+void Column::or_bitmap( const Bitmap & other, Bitmap * res )
+{
+    assert( other.size() == res->size() );
+
+    for( std::size_t i = 0; i < res->size(); ++i )
+        ( * res )[ i ] |= other[ i ];
+}
+
+} // namespace anyvalue_db
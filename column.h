@@ -0,0 +1,97 @@
+/*
+
+Column. Dense storage of one field for column-at-a-time scans.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__COLUMN_H
+#define ANYVALUE_DB__COLUMN_H
+
+#include <vector>           // std::vector
+#include <cstdint>          // uint64_t
+
+#include "value.h"          // Value
+#include "anyvalue/operations.h"    // anyvalue::comparison_type_e
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief Values of one field of all records of a table, indexed by record slot.
+ *
+ * Slots without the field (or without a record) are marked in the null bitmap.
+ * Selections are bitmaps over slots.
+ * Integers and first bytes of strings are also kept in plain arrays (lanes), so that
+ * comparisons on them run through FilterKernels.
+ */
+class Column
+{
+public:
+
+    typedef std::vector<uint64_t>   Bitmap;
+
+    static const std::size_t SLOT_SIZE = sizeof( Value ) + sizeof( int64_t ) + sizeof( uint64_t );    // value and lanes, bitmaps aside
+
+public:
+
+    void resize( std::size_t size );
+
+    void set( uint32_t slot, const Value & value );
+    void clear( uint32_t slot );
+
+    bool is_null( uint32_t slot ) const;
+    const Value & get( uint32_t slot ) const;
+
+    /**
+     * @brief sets bits of the slots, which values match the condition
+     */
+    void select( anyvalue::comparison_type_e op, const Value & value, Bitmap * res ) const;
+
+    /**
+     * @brief sets bits of the slots, which values are strings starting with the prefix
+     */
+    void select_prefix( const std::string & prefix, Bitmap * res ) const;
+
+    static void init_bitmap( std::size_t size, bool is_set, Bitmap * res );
+    static void and_bitmap( const Bitmap & other, Bitmap * res );
+    static void or_bitmap( const Bitmap & other, Bitmap * res );
+
+private:
+
+    static void set_bit( uint32_t slot, bool is_set, Bitmap * res );
+
+    void select_string_prefix( const std::string & prefix, bool is_exact, Bitmap * res ) const;
+    void select_other( anyvalue::comparison_type_e op, const Value & value, const Bitmap & done, Bitmap * res ) const;
+
+private:
+
+    std::vector<Value>      values_;
+    Bitmap                  nulls_;     // bit is set, if the value is null
+
+    std::vector<int64_t>    ints_;      // lane of integer values
+    Bitmap                  is_int_;
+    std::vector<uint64_t>   prefixes_;  // lane of first 8 bytes of string values
+    Bitmap                  is_string_;
+};
+
+} // namespace anyvalue_db
+
+
+#endif // ANYVALUE_DB__COLUMN_H
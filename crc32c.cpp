@@ -0,0 +1,129 @@
+/*
+
+CRC32C (Castagnoli) checksum.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "crc32c.h"         // self
+
+#include <cstring>          // memcpy
+
+#if defined( __x86_64__ ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define ANYVALUE_DB__CRC32C_HW
+#include <nmmintrin.h>      // _mm_crc32_u64
+#endif
+
+namespace anyvalue_db
+{
+
+namespace
+{
+
+const uint32_t POLY = 0x82F63B78;   // reversed Castagnoli polynomial
+
+struct Table
+{
+    uint32_t    data[256];
+
+    Table()
+    {
+        for( uint32_t i = 0; i < 256; ++i )
+        {
+            uint32_t c = i;
+
+            for( int k = 0; k < 8; ++k )
+                c = ( c & 1 ) ? ( c >> 1 ) ^ POLY : ( c >> 1 );
+
+            data[ i ] = c;
+        }
+    }
+};
+
+uint32_t extend_sw( uint32_t crc, const char * data, std::size_t size )
+{
+    static const Table table;
+
+    auto p = reinterpret_cast<const unsigned char*>( data );
+
+    for( std::size_t i = 0; i < size; ++i )
+        crc = table.data[ ( crc ^ p[ i ] ) & 0xFF ] ^ ( crc >> 8 );
+
+    return crc;
+}
+
+#ifdef ANYVALUE_DB__CRC32C_HW
+
+__attribute__(( target( "sse4.2" ) ))
+uint32_t extend_hw( uint32_t crc, const char * data, std::size_t size )
+{
+    uint64_t c = crc;
+
+    while( size >= 8 )
+    {
+        uint64_t v;
+
+        memcpy( & v, data, sizeof( v ) );
+
+        c       = _mm_crc32_u64( c, v );
+        data    += 8;
+        size    -= 8;
+    }
+
+    auto res = static_cast<uint32_t>( c );
+
+    while( size > 0 )
+    {
+        res = _mm_crc32_u8( res, static_cast<unsigned char>( * data ) );
+        ++data;
+        --size;
+    }
+
+    return res;
+}
+
+bool has_hw()
+{
+    static const bool res = __builtin_cpu_supports( "sse4.2" );
+
+    return res;
+}
+
+#endif // ANYVALUE_DB__CRC32C_HW
+
+} // namespace
+
+uint32_t Crc32c::calc( const char * data, std::size_t size )
+{
+    return extend( 0, data, size );
+}
+
+uint32_t Crc32c::extend( uint32_t crc, const char * data, std::size_t size )
+{
+    crc = ~crc;
+
+#ifdef ANYVALUE_DB__CRC32C_HW
+    if( has_hw() )
+        return ~extend_hw( crc, data, size );
+#endif
+
+    return ~extend_sw( crc, data, size );
+}
+
+} // namespace anyvalue_db
@@ -0,0 +1,50 @@
+/*
+
+CRC32C (Castagnoli) checksum.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__CRC32C_H
+#define ANYVALUE_DB__CRC32C_H
+
+#include <cstdint>          // uint32_t
+#include <cstddef>          // std::size_t
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief CRC32C calculation.
+ *
+ * Uses SSE4.2 crc32 instruction when the CPU supports it (checked once at runtime),
+ * otherwise falls back to a table driven implementation.
+ */
+class Crc32c
+{
+public:
+
+    static uint32_t calc( const char * data, std::size_t size );
+
+    static uint32_t extend( uint32_t crc, const char * data, std::size_t size );
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__CRC32C_H
@@ -23,10 +23,11 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include "db.h"                      // self
 
-#include <fstream>                      // std::ifstream
+#include <sstream>                      // std::istringstream
+#include <unordered_map>                // std::unordered_multimap
+#include <functional>                   // std::less
 
 #include "utils/mutex_helper.h"         // MUTEX_SCOPE_LOCK
-#include "utils/dummy_logger.h"         // dummy_log
 #include "utils/utils_assert.h"         // ASSERT
 #include "utils/rename_and_backup.h"    // utils::rename_and_backup
 #include "anyvalue/value_operations.h"  // anyvalue::compare_values
@@ -34,6 +35,9 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include "str_helper.h"                 // StrHelper
 #include "serializer.h"                 // serializer::load
+#include "block_file.h"                 // BlockFile
+#include "log_helper.h"                 // AVDB_LOG_DEBUG
+#include "value_hash.h"                 // ValueHash
 
 #define MODULENAME      "DB"
 
@@ -56,11 +60,20 @@ DB::~DB()
 bool DB::init(
         const std::string   & filename )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    return init( filename, false );
+}
+
+bool DB::init(
+        const std::string   & filename,
+        bool                is_lazy )
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
     assert( is_inited_ == false );
 
-    auto b = load_intern( filename );
+    METRICS_SCOPE( metrics_, operation_e::LOAD );
+
+    auto b = load_intern( filename, is_lazy );
 
     if( b )
         is_inited_  = true;
@@ -70,7 +83,7 @@ bool DB::init(
 
 bool DB::init()
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
     assert( is_inited_ == false );
 
@@ -84,7 +97,7 @@ bool DB::add_table(
         Table               * table,
         std::string         * error_msg )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
     return add_table__unlocked( name, table, error_msg );
 }
@@ -100,13 +113,17 @@ bool DB::add_table__unlocked(
 
     if( b == false )
     {
-        dummy_log_error( MODULENAME, "add_table__unlocked: table %s already exists", name.c_str() );
+        AVDB_LOG_ERROR( MODULENAME, "add_table__unlocked: table %s already exists", name.c_str() );
 
         * error_msg = "table already exists";
 
         return false;
     }
 
+    TableInfo info = { -1, 0, std::chrono::steady_clock::now() };
+
+    map_name_to_table_info_[ name ] = info;
+
     return true;
 }
 
@@ -121,7 +138,7 @@ bool DB::delete_table__unlocked(
     if( it == map_name_to_table_.end() )
     {
         * error_msg   = "table " + name + " not found";
-        dummy_log_error( MODULENAME, "delete_table__unlocked: table %s not found", name.c_str() );
+        AVDB_LOG_ERROR( MODULENAME, "delete_table__unlocked: table %s not found", name.c_str() );
         return false;
     }
 
@@ -129,9 +146,11 @@ bool DB::delete_table__unlocked(
 
     map_name_to_table_.erase( it );
 
+    map_name_to_table_info_.erase( name );
+
     delete table;
 
-    dummy_log_info( MODULENAME, "delete_table__unlocked: table %s deleted", name.c_str() );
+    AVDB_LOG_INFO( MODULENAME, "delete_table__unlocked: table %s deleted", name.c_str() );
 
     return true;
 }
@@ -140,23 +159,39 @@ void DB::set_meta_key(
         metakey_id_t        metakey_id,
         const Value         & value )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
     set_meta_key__unlocked( metakey_id, value );
 }
 
+void DB::set_meta_key(
+        metakey_id_t        metakey_id,
+        Value               && value )
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    set_meta_key__unlocked( metakey_id, std::move( value ) );
+}
+
 void DB::set_meta_key__unlocked(
         metakey_id_t        metakey_id,
         const Value         & value )
 {
-    map_metakey_id_to_value_[ metakey_id ]    = value;
+    set_meta_key__unlocked( metakey_id, Value( value ) );
+}
+
+void DB::set_meta_key__unlocked(
+        metakey_id_t        metakey_id,
+        Value               && value )
+{
+    map_metakey_id_to_value_[ metakey_id ]    = std::move( value );
 }
 
 bool DB::get_meta_key(
         metakey_id_t        metakey_id,
         Value               * value )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
     return get_meta_key__unlocked( metakey_id, value );
 }
@@ -178,7 +213,7 @@ bool DB::get_meta_key__unlocked(
 bool DB::delete_meta_key(
         metakey_id_t        metakey_id )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
     return delete_meta_key__unlocked( metakey_id );
 }
@@ -197,29 +232,293 @@ bool DB::delete_meta_key__unlocked(
 }
 
 Table* DB::find__unlocked( const std::string & name )
+{
+    std::string error_msg;
+
+    return find__unlocked( name, & error_msg );
+}
+
+const Table* DB::find__unlocked( const std::string & name ) const
+{
+    std::string error_msg;
+
+    return find__unlocked( name, & error_msg );
+}
+
+Table* DB::find__unlocked( const std::string & name, std::string * error_msg )
+{
+    assert( is_inited_ );
+
+    return find_and_load( name, error_msg );
+}
+
+const Table* DB::find__unlocked( const std::string & name, std::string * error_msg ) const
 {
     assert( is_inited_ );
 
+    return find_and_load( name, error_msg );
+}
+
+Table* DB::find_and_load( const std::string & name, std::string * error_msg ) const
+{
+    METRICS_SCOPE( metrics_, operation_e::FIND_TABLE );
+
     auto it = map_name_to_table_.find( name );
     if( it == map_name_to_table_.end() )
     {
+        * error_msg   = "table " + name + " not found";
         return nullptr;
     }
 
+    auto & info = map_name_to_table_info_[ name ];
+
+    info.last_access    = std::chrono::steady_clock::now();
+
+    if( it->second == nullptr )
+    {
+        it->second = load_table( name, & info, error_msg );
+    }
+
     return it->second;
 }
 
-const Table* DB::find__unlocked( const std::string & name ) const
+Table* DB::load_table( const std::string & name, TableInfo * info, std::string * error_msg ) const
 {
-    assert( is_inited_ );
+    METRICS_SCOPE( metrics_, operation_e::LOAD );
 
-    auto it = map_name_to_table_.find( name );
-    if( it == map_name_to_table_.end() )
+    std::string data;
+
+    if( BlockFile::load_section( error_msg, filename_, info->section_id, & data ) == false )
     {
+        AVDB_LOG_ERROR( MODULENAME, "load_table: cannot read table %s from %s: %s", name.c_str(), filename_.c_str(), error_msg->c_str() );
+
+        * error_msg = "cannot load table " + name + ": " + * error_msg;
+
         return nullptr;
     }
 
-    return it->second;
+    std::istringstream is( data );
+
+    Table * res = nullptr;
+
+    if( serializer::load( is, & res ) == nullptr )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "load_table: cannot load table %s from %s", name.c_str(), filename_.c_str() );
+
+        * error_msg = "cannot load table " + name + ": cannot parse section " + std::to_string( info->section_id );
+
+        return nullptr;
+    }
+
+    info->change_count  = res->get_change_count__unlocked();
+
+    AVDB_LOG_INFO( MODULENAME, "load_table: loaded table %s from %s", name.c_str(), filename_.c_str() );
+
+    return res;
+}
+
+std::size_t DB::evict_idle_tables__unlocked( uint32_t idle_seconds )
+{
+    assert( is_inited_ );
+
+    std::size_t res = 0;
+
+    auto now = std::chrono::steady_clock::now();
+
+    for( auto & e : map_name_to_table_ )
+    {
+        if( e.second == nullptr )
+            continue;
+
+        auto & info = map_name_to_table_info_[ e.first ];
+
+        if( info.section_id < 0 )
+            continue;   // not stored in the file
+
+        if( e.second->get_change_count__unlocked() != info.change_count )
+            continue;   // modified since loaded or saved
+
+        if( now - info.last_access < std::chrono::seconds( idle_seconds ) )
+            continue;
+
+        {
+            // a caller may keep the table locked after releasing the database
+
+            std::unique_lock<std::mutex> lock( e.second->get_mutex(), std::try_to_lock );
+
+            if( lock.owns_lock() == false )
+            {
+                AVDB_LOG_DEBUG( MODULENAME, "evict_idle_tables__unlocked: table %s is in use", e.first.c_str() );
+                continue;
+            }
+        }
+
+        delete e.second;
+
+        e.second = nullptr;
+
+        ++res;
+
+        AVDB_LOG_INFO( MODULENAME, "evict_idle_tables__unlocked: unloaded table %s", e.first.c_str() );
+    }
+
+    return res;
+}
+
+bool DB::join(
+        const JoinQuery     & query,
+        const std::vector<field_id_t> & outer_field_ids,
+        const std::vector<field_id_t> & inner_field_ids,
+        ResultSet           * res,
+        std::string         * error_msg ) const
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    auto outer = find__unlocked( query.outer_table, error_msg );
+    auto inner = outer ? find__unlocked( query.inner_table, error_msg ) : nullptr;
+
+    if( outer == nullptr || inner == nullptr )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "join: %s", error_msg->c_str() );
+
+        return false;
+    }
+
+    // joins are the only place where two tables are locked at once, a fixed order keeps them from deadlocking each other
+
+    auto first  = std::min( outer, inner, std::less<const Table*>() );
+    auto second = std::max( outer, inner, std::less<const Table*>() );
+
+    MUTEX_SCOPE_LOCK( first->get_mutex() );
+
+    std::unique_lock<std::mutex> lock_2( second->get_mutex(), std::defer_lock );
+
+    if( second != first )
+        lock_2.lock();
+
+    VectorRecordPair pairs;
+
+    if( join__unlocked( query, & pairs, error_msg ) == false )
+        return false;
+
+    auto field_ids = outer_field_ids;
+
+    field_ids.insert( field_ids.end(), inner_field_ids.begin(), inner_field_ids.end() );
+
+    * res = ResultSet( field_ids );
+
+    res->reserve( pairs.size() );
+
+    for( auto & e : pairs )
+    {
+        res->add_row( * e.first, outer_field_ids.size(), * e.second );
+    }
+
+    return true;
+}
+
+bool DB::join__unlocked(
+        const JoinQuery     & query,
+        VectorRecordPair    * res,
+        std::string         * error_msg ) const
+{
+    assert( is_inited_ );
+
+    METRICS_SCOPE( metrics_, operation_e::JOIN );
+
+    auto outer = find__unlocked( query.outer_table, error_msg );
+    auto inner = outer ? find__unlocked( query.inner_table, error_msg ) : nullptr;
+
+    if( outer == nullptr || inner == nullptr )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "join__unlocked: %s", error_msg->c_str() );
+
+        return false;
+    }
+
+    auto outer_records = query.outer_conditions.empty() ?
+            outer->get_records__unlocked() :
+            outer->select__unlocked( query.is_or, query.outer_conditions );
+
+    if( inner->has_index( query.inner_field_id ) )
+    {
+        // index nested loop, keys are unique, so there is at most one inner record per outer one
+
+        AVDB_LOG_DEBUG( MODULENAME, "join__unlocked: %s x %s, index nested loop, %zu outer records", query.outer_table.c_str(), query.inner_table.c_str(), outer_records.size() );
+
+        for( auto o : outer_records )
+        {
+            Value v;
+
+            if( o->get_field( query.outer_field_id, & v ) == false )
+                continue;
+
+            auto i = inner->find__unlocked( query.inner_field_id, v );
+
+            if( i )
+                res->push_back( std::make_pair( o, const_cast<Record*>( i ) ) );
+        }
+
+        return true;
+    }
+
+    auto inner_records = inner->get_records__unlocked();
+
+    AVDB_LOG_DEBUG( MODULENAME, "join__unlocked: %s x %s, hash join, %zu outer records, %zu inner records", query.outer_table.c_str(), query.inner_table.c_str(), outer_records.size(), inner_records.size() );
+
+    std::unordered_multimap<Value,Record*,ValueHash,ValueEqual> map_value_to_inner;
+
+    map_value_to_inner.reserve( inner_records.size() );
+
+    for( auto i : inner_records )
+    {
+        Value v;
+
+        if( i->get_field( query.inner_field_id, & v ) )
+            map_value_to_inner.emplace( std::move( v ), i );
+    }
+
+    for( auto o : outer_records )
+    {
+        Value v;
+
+        if( o->get_field( query.outer_field_id, & v ) == false )
+            continue;
+
+        auto range = map_value_to_inner.equal_range( v );
+
+        for( auto it = range.first; it != range.second; ++it )
+            res->push_back( std::make_pair( o, it->second ) );
+    }
+
+    return true;
+}
+
+DBMemoryStats DB::get_memory_stats() const
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    DBMemoryStats res;
+
+    for( auto & e : map_name_to_table_ )
+    {
+        if( e.second )
+            res.tables.push_back( std::make_pair( e.first, e.second->get_memory_stats() ) );
+    }
+
+    for( auto & e : map_metakey_id_to_value_ )
+    {
+        res.metakeys += MemorySize::get_metakey( e.second );
+    }
+
+    res.metrics = metrics_.get_memory_size();
+
+    return res;
+}
+
+MetricsSnapshot DB::get_metrics() const
+{
+    return metrics_.get_snapshot();
 }
 
 std::mutex & DB::get_mutex() const
@@ -227,95 +526,188 @@ std::mutex & DB::get_mutex() const
     return mutex_;
 }
 
-bool DB::load_intern( const std::string & filename )
+bool DB::load_intern( const std::string & filename, bool is_lazy )
 {
-    std::ifstream is( filename );
+    std::string error_msg;
+    std::string data;
+
+    std::vector<std::string> section_names;
+    bool is_plain;
+
+    auto b = BlockFile::load_section_names( & error_msg, filename, & section_names, & is_plain );
+
+    if( b )
+    {
+        // section 0 holds DB status, older files also have all the tables in it
+        if( is_plain )
+            b = BlockFile::load( & error_msg, filename, & data );
+        else
+            b = BlockFile::load_section( & error_msg, filename, 0, & data );
+    }
 
-    if( is.fail() )
+    if( b == false )
     {
-        dummy_log_warn( MODULENAME, "load_intern: cannot open credentials file %s", filename.c_str() );
+        AVDB_LOG_WARN( MODULENAME, "load_intern: cannot read credentials file %s: %s", filename.c_str(), error_msg.c_str() );
         return false;
     }
 
+    std::istringstream is( data );
+
     DBStatus status;
 
     auto res = Serializer::load( is, & status );
 
     if( res == nullptr )
     {
-        dummy_log_error( MODULENAME, "load_intern: cannot load credentials" );
+        AVDB_LOG_ERROR( MODULENAME, "load_intern: cannot load credentials" );
         return false;
     }
 
-    std::string error_msg;
-
-    auto b = init_from_status( & error_msg, status );
+    b = init_from_status( & error_msg, status );
 
     if( b == false )
     {
-        dummy_log_error( MODULENAME, "load_intern: cannot init login map: %s", error_msg.c_str() );
+        AVDB_LOG_ERROR( MODULENAME, "load_intern: cannot init login map: %s", error_msg.c_str() );
         return false;
     }
 
-    dummy_log_info( MODULENAME, "load_intern: loaded %d tables from %s, number of metakeys %u", map_name_to_table_.size(), filename.c_str(), map_metakey_id_to_value_.size() );
+    filename_   = filename;
+
+    for( std::size_t i = 1; i < section_names.size(); ++i )
+    {
+        auto & name = section_names[ i ];
+
+        auto is_inserted = map_name_to_table_.insert( std::make_pair( name, nullptr ) ).second;
+
+        if( is_inserted == false )
+        {
+            AVDB_LOG_ERROR( MODULENAME, "load_intern: duplicate table %s", name.c_str() );
+            return false;
+        }
+
+        TableInfo info = { int( i ), 0, std::chrono::steady_clock::now() };
+
+        map_name_to_table_info_[ name ] = info;
+
+        std::string error_msg;
+
+        if( is_lazy == false && find_and_load( name, & error_msg ) == nullptr )
+            return false;
+    }
+
+    AVDB_LOG_INFO( MODULENAME, "load_intern: loaded %zu tables from %s, number of metakeys %zu", map_name_to_table_.size(), filename.c_str(), map_metakey_id_to_value_.size() );
 
     return true;
 }
 
 bool DB::save( std::string * error_msg, const std::string & filename ) const
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    return save( error_msg, filename, false );
+}
+
+bool DB::save( std::string * error_msg, const std::string & filename, bool is_compressed ) const
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    METRICS_SCOPE( metrics_, operation_e::SAVE );
 
     assert( is_inited_ );
 
     auto temp_name  = filename + ".tmp";
 
-    auto b = save_intern( error_msg, temp_name );
+    auto b = save_intern( error_msg, temp_name, is_compressed );
 
     if( b == false )
         return false;
 
     utils::rename_and_backup( temp_name, filename );
 
-    return true;
-}
+    b = BlockFile::sync_directory( error_msg, filename );
 
-bool DB::save_intern( std::string * error_msg, const std::string & filename ) const
-{
-    std::ofstream os( filename );
+    if( b == false )
+        return false;
+
+    // the saved file becomes the source for the tables loaded on demand
 
-    if( os.fail() )
+    filename_   = filename;
+
+    int section_id = 1;
+
+    for( auto & e : map_name_to_table_ )
     {
-        dummy_log_error( MODULENAME, "save_intern: cannot open credentials file %s", filename.c_str() );
+        auto & info = map_name_to_table_info_[ e.first ];
 
-        * error_msg =  "cannot open file " + filename;
+        info.section_id = section_id++;
 
-        return false;
+        if( e.second )
+            info.change_count   = e.second->get_change_count__unlocked();
     }
 
+    return true;
+}
+
+bool DB::save_intern( std::string * error_msg, const std::string & filename, bool is_compressed ) const
+{
+    std::vector<BlockFile::Section> sections;
+
+    std::ostringstream os;
+
     DBStatus status;
 
     get_status( & status );
 
     auto res = Serializer::save( os, status );
 
+    sections.push_back( BlockFile::Section( std::string(), os.str() ) );
+
+    // every table is stored in its own section, so that it can be loaded separately
+
+    for( auto & e : map_name_to_table_ )
+    {
+        sections.push_back( BlockFile::Section( e.first, std::string() ) );
+
+        if( e.second )
+        {
+            std::ostringstream os_table;
+
+            res &= Serializer::save( os_table, * e.second );
+
+            sections.back().second  = os_table.str();
+        }
+        else
+        {
+            auto & info = map_name_to_table_info_[ e.first ];
+
+            res &= BlockFile::load_section( error_msg, filename_, info.section_id, & sections.back().second );
+        }
+    }
+
     if( res == false )
     {
-        dummy_log_error( MODULENAME, "save_intern: cannot save credentials into file %s", filename.c_str()  );
+        AVDB_LOG_ERROR( MODULENAME, "save_intern: cannot serialize data for file %s", filename.c_str()  );
 
         * error_msg =  "cannot save data into file " + filename;
 
         return false;
     }
 
-    dummy_log_info( MODULENAME, "save: saved %d tables, %d metakeys into %s", map_name_to_table_.size(), map_metakey_id_to_value_.size(), filename.c_str() );
+    res = BlockFile::save( error_msg, filename, sections, is_compressed );
+
+    if( res == false )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "save_intern: cannot save credentials into file %s: %s", filename.c_str(), error_msg->c_str() );
+
+        return false;
+    }
+
+    AVDB_LOG_INFO( MODULENAME, "save: saved %zu tables, %zu metakeys into %s", map_name_to_table_.size(), map_metakey_id_to_value_.size(), filename.c_str() );
 
     return true;
 }
 
 void DB::get_status( DBStatus * res ) const
 {
-    res->map_name_to_table = map_name_to_table_;
+    // tables are saved separately
 
     for( auto & e : map_metakey_id_to_value_ )
     {
@@ -323,15 +715,15 @@ void DB::get_status( DBStatus * res ) const
     }
 }
 
-void DB::init_metakeys_from_status( const DBStatus & status )
+void DB::init_metakeys_from_status( DBStatus & status )
 {
-    for( auto e : status.metakeys )
+    for( auto & e : status.metakeys )
     {
-        map_metakey_id_to_value_.insert( std::make_pair( e.first, e.second ) );
+        map_metakey_id_to_value_.insert( std::make_pair( e.first, std::move( e.second ) ) );
     }
 }
 
-bool DB::init_from_status( std::string * error_msg, const DBStatus & status )
+bool DB::init_from_status( std::string * error_msg, DBStatus & status )
 {
     for( auto & e : status.map_name_to_table )
     {
@@ -27,9 +27,12 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 #include <mutex>            // std::mutex
 #include <map>              // std::map
 #include <set>              // std::set
+#include <chrono>           // std::chrono
 
 #include "table.h"          // Table
 #include "db_status.h"      // DBStatus
+#include "memory_stats.h"   // DBMemoryStats
+#include "metrics.h"        // Metrics
 
 namespace anyvalue_db
 {
@@ -39,6 +42,24 @@ class DB
     friend class Serializer;
     friend class StrHelper;
 
+public:
+
+    /**
+     * @brief records of the outer table, which match the conditions, are joined with the records of the inner table,
+     *        which have the same value in the inner field
+     */
+    struct JoinQuery
+    {
+        std::string         outer_table;
+        bool                is_or;
+        std::vector<Table::SelectCondition> outer_conditions;   // empty selects all records
+        field_id_t          outer_field_id;
+        std::string         inner_table;
+        field_id_t          inner_field_id;
+    };
+
+    typedef std::vector<std::pair<Record*,Record*>>   VectorRecordPair;     // outer, inner
+
 public:
 
     DB();
@@ -47,6 +68,13 @@ public:
     bool init(
             const std::string & filename );
 
+    /**
+     * @param is_lazy   if true, tables are loaded from the file on first find__unlocked()
+     */
+    bool init(
+            const std::string & filename,
+            bool                is_lazy );
+
     bool init();
 
     bool add_table(
@@ -67,6 +95,10 @@ public:
             metakey_id_t        metakey_id,
             const Value         & value );
 
+    void set_meta_key(
+            metakey_id_t        metakey_id,
+            Value               && value );
+
     bool get_meta_key(
             metakey_id_t        metakey_id,
             Value               * value );
@@ -78,6 +110,10 @@ public:
             metakey_id_t        metakey_id,
             const Value         & value );
 
+    void set_meta_key__unlocked(
+            metakey_id_t        metakey_id,
+            Value               && value );
+
     bool get_meta_key__unlocked(
             metakey_id_t        metakey_id,
             Value               * value );
@@ -88,7 +124,56 @@ public:
     Table* find__unlocked( const std::string & name );
     const Table* find__unlocked( const std::string & name ) const;
 
+    /**
+     * @brief as above, error_msg tells a missing table from a table which cannot be loaded from the file
+     */
+    Table* find__unlocked( const std::string & name, std::string * error_msg );
+    const Table* find__unlocked( const std::string & name, std::string * error_msg ) const;
+
+    /**
+     * @brief inner join; locks the database and both tables, the tables in the order of their addresses,
+     *        and copies outer_field_ids of the outer record followed by inner_field_ids of the inner record into each row
+     */
+    bool join(
+            const JoinQuery     & query,
+            const std::vector<field_id_t> & outer_field_ids,
+            const std::vector<field_id_t> & inner_field_ids,
+            ResultSet           * res,
+            std::string         * error_msg ) const;
+
+    /**
+     * @brief the database and both tables must be locked by the caller;
+     *        an index of the inner field is looked up per outer record, otherwise the inner records are hashed by the field
+     */
+    bool join__unlocked(
+            const JoinQuery     & query,
+            VectorRecordPair    * res,
+            std::string         * error_msg ) const;
+
     bool save( std::string * error_msg, const std::string & filename ) const;
+    bool save( std::string * error_msg, const std::string & filename, bool is_compressed ) const;
+
+    /**
+     * @brief unloads tables which were not modified and not accessed within idle_seconds
+     *
+     * A table can be unloaded only if it is stored in the last loaded or saved file.
+     * Tables whose mutex is held by someone else are in use and are skipped, so a pointer returned
+     * by find__unlocked() stays valid as long as the caller holds either the database or the table mutex.
+     * The caller must hold the database mutex and no table mutex.
+     *
+     * @return number of unloaded tables
+     */
+    std::size_t evict_idle_tables__unlocked( uint32_t idle_seconds );
+
+    /**
+     * @brief locks the database only, tables report their counters without locking
+     */
+    DBMemoryStats get_memory_stats() const;
+
+    /**
+     * @brief metrics of the database itself, each table keeps its own ones
+     */
+    MetricsSnapshot get_metrics() const;
 
     std::mutex & get_mutex() const;
 
@@ -97,23 +182,40 @@ private:
     typedef std::map<std::string,Table*>    MapStringToTable;
     typedef std::map<metakey_id_t,Value>    MapMetaKeyIdToValue;
 
+    struct TableInfo
+    {
+        int         section_id;     // section in filename_, -1 if the table is not stored there
+        uint64_t    change_count;   // change count of the table when it was loaded or saved
+        std::chrono::steady_clock::time_point   last_access;
+    };
+
+    typedef std::map<std::string,TableInfo> MapStringToTableInfo;
+
 private:
 
-    bool save_intern( std::string * error_msg, const std::string & filename ) const;
-    bool load_intern( const std::string & filename );
+    bool save_intern( std::string * error_msg, const std::string & filename, bool is_compressed ) const;
+    bool load_intern( const std::string & filename, bool is_lazy );
+
+    Table* load_table( const std::string & name, TableInfo * info, std::string * error_msg ) const;
+    Table* find_and_load( const std::string & name, std::string * error_msg ) const;
 
     void get_status( DBStatus * res ) const;
-    void init_metakeys_from_status( const DBStatus & status );
-    bool init_from_status( std::string * error_msg, const DBStatus & status );
+    void init_metakeys_from_status( DBStatus & status );
+    bool init_from_status( std::string * error_msg, DBStatus & status );
 
 private:
     mutable std::mutex          mutex_;
 
     bool                        is_inited_;
 
-    MapStringToTable            map_name_to_table_;
+    mutable std::string         filename_;      // file to load the tables from on demand
+
+    mutable MapStringToTable    map_name_to_table_;     // nullptr for tables which are not loaded yet
+    mutable MapStringToTableInfo    map_name_to_table_info_;
 
     MapMetaKeyIdToValue         map_metakey_id_to_value_;
+
+    Metrics                     metrics_;
 };
 
 } // namespace anyvalue_db
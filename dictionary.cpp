@@ -0,0 +1,93 @@
+/*
+
+Dictionary. Encoding of repeated values into small integer codes.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "dictionary.h"     // self
+
+#include "anyvalue/op_less.h"   // operator<
+#include "memory_stats.h"       // MemorySize
+
+#include <cassert>
+
+namespace anyvalue_db
+{
+
+bool Dictionary::Less::operator()( const Value & lhs, const Value & rhs ) const
+{
+    return ::operator<( lhs, rhs );
+}
+
+Dictionary::Dictionary():
+        memory_size_( 0 )
+{
+}
+
+int Dictionary::encode( const Value & value )
+{
+    auto it = map_value_to_code_.find( value );
+
+    if( it != map_value_to_code_.end() )
+        return it->second;
+
+    auto code = static_cast<int>( values_.size() );
+
+    values_.push_back( value );
+
+    map_value_to_code_.insert( std::make_pair( value, code ) );
+
+    // the value is kept twice: in the list of values and as a key of the map
+
+    auto payload = MemorySize::get_payload( value );
+
+    memory_size_ += sizeof( Value ) + payload + MemorySize::MAP_NODE_OVERHEAD + sizeof( std::pair<const Value,int> ) + payload;
+
+    return code;
+}
+
+int Dictionary::find_code( const Value & value ) const
+{
+    auto it = map_value_to_code_.find( value );
+
+    if( it == map_value_to_code_.end() )
+        return INVALID_CODE;
+
+    return it->second;
+}
+
+const Value & Dictionary::decode( int code ) const
+{
+    assert( code >= 0 && std::size_t( code ) < values_.size() );
+
+    return values_[ code ];
+}
+
+std::size_t Dictionary::get_size() const
+{
+    return values_.size();
+}
+
+uint64_t Dictionary::get_memory_size() const
+{
+    return memory_size_;
+}
+
+} // namespace anyvalue_db
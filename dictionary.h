@@ -0,0 +1,81 @@
+/*
+
+Dictionary. Encoding of repeated values into small integer codes.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__DICTIONARY_H
+#define ANYVALUE_DB__DICTIONARY_H
+
+#include <atomic>           // std::atomic
+#include <deque>            // std::deque
+#include <map>              // std::map
+
+#include "types.h"          // field_id_t
+#include "value.h"          // Value
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief Maps distinct values of a field to codes 0, 1, 2, ...
+ *
+ * Codes are never reused, so the dictionary only grows. Decoded values stay at the same address for
+ * the lifetime of the dictionary, so references to them can be handed out.
+ */
+class Dictionary
+{
+public:
+
+    static const int INVALID_CODE = -1;
+
+public:
+
+    Dictionary();
+
+    int encode( const Value & value );
+    int find_code( const Value & value ) const;
+    const Value & decode( int code ) const;
+
+    std::size_t get_size() const;
+
+    uint64_t get_memory_size() const;   // can be called without lock
+
+private:
+
+    struct Less
+    {
+        bool operator()( const Value & lhs, const Value & rhs ) const;
+    };
+
+private:
+
+    std::deque<Value>           values_;
+    std::map<Value,int,Less>    map_value_to_code_;
+
+    std::atomic<uint64_t>       memory_size_;
+};
+
+typedef std::map<field_id_t,Dictionary>     MapFieldIdToDictionary;
+
+} // namespace anyvalue_db
+
+
+#endif // ANYVALUE_DB__DICTIONARY_H
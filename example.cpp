@@ -1,8 +1,18 @@
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <map>
+#include <sstream>              // std::istringstream
+#include <thread>               // std::thread
+#include <condition_variable>   // std::condition_variable
+#include <atomic>               // std::atomic
+#include <algorithm>            // std::max
 
 #include "db.h"                 // DB
 #include "str_helper.h"         // StrHelper
+#include "log_helper.h"         // AVDB_LOG_DEBUG
+#include "block_file.h"         // BlockFile
+#include "serializer.h"         // Serializer
 #include "anyvalue/str_helper.h"        // anyvalue::StrHelper
 
 #include "utils/mutex_helper.h"         // MUTEX_SCOPE_LOCK
@@ -226,6 +236,40 @@ std::vector<anyvalue_db::Record*> init_order_table_3( anyvalue_db::Table * table
     return res;
 }
 
+anyvalue_db::Schema create_user_schema()
+{
+    anyvalue_db::Schema res;
+
+    res.add_field( ID,          anyvalue::type_e::INT,      false,  true );
+    res.add_field( LOGIN,       anyvalue::type_e::STRING,   false,  true );
+    res.add_field( PASSWORD,    anyvalue::type_e::STRING,   false,  false );
+    res.add_field( LAST_NAME,   anyvalue::type_e::STRING,   true,   false );
+    res.add_field( FIRST_NAME,  anyvalue::type_e::STRING,   true,   false );
+    res.add_field( EMAIL,       anyvalue::type_e::STRING,   true,   false );
+    res.add_field( PHONE,       anyvalue::type_e::STRING,   true,   false );
+    res.add_field( REG_KEY,     anyvalue::type_e::STRING,   true,   true );
+    res.add_field( STATUS,      anyvalue::type_e::INT,      false,  false );
+
+    return res;
+}
+
+void init_table_n( anyvalue_db::Table * table, unsigned n, const anyvalue_db::Schema & schema = anyvalue_db::Schema() )
+{
+    if( schema.is_empty() )
+        table->init( std::vector<anyvalue_db::field_id_t>( { ID, LOGIN, REG_KEY } ));
+    else
+        table->init( schema );
+
+    std::string error_msg;
+
+    for( unsigned i = 0; i < n; ++i )
+    {
+        auto s = std::to_string( i );
+
+        table->add_record( create_record( 10000 + i, "user" + s, "xxx", "Doe", "John", "john.doe." + s + "@yoyodyne.com", "+1234567890", "key" + s, i % 3 ), & error_msg );
+    }
+}
+
 void dump_selection( const std::vector<anyvalue_db::Record*> & vec, const std::string & comment )
 {
     std::cout << comment << ":" << "\n";
@@ -1335,6 +1379,2187 @@ void test_26_load_table_modify_save_ok_1()
     log_test( "test_26_load_table_modify_save_ok_1", b, true, "database saved", "cannot save database", error_msg );
 }
 
+void test_27_save_compressed_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 1000 );
+
+    std::string error_msg;
+
+    auto b = table.save( & error_msg, "test_27.dat", true );
+
+    log_test( "test_27_save_compressed_ok_1", b, true, "table was written", "cannot write file", error_msg );
+}
+
+void test_27_load_compressed_ok_1()
+{
+    anyvalue_db::Table table;
+
+    auto b = false;
+    std::string error_msg;
+
+    try
+    {
+        table.init( "test_27.dat" );
+
+        b = true;
+    }
+    catch( std::exception & e )
+    {
+        error_msg = e.what();
+    }
+
+    if( b == false )
+    {
+        log_test( "test_27_load_compressed_ok_1", b, true, "table was loaded", error_msg, "" );
+        return;
+    }
+
+    auto size = table.get_size();
+
+    auto & mutex = table.get_mutex();
+
+    MUTEX_SCOPE_LOCK( mutex );
+
+    auto rec = table.find__unlocked( LOGIN, "user777" );
+
+    b = size == 1000 && rec != nullptr && rec->get_field( ID ).get_int() == 10777;
+
+    log_test( "test_27_load_compressed_ok_1", b, true, "table was loaded", "loaded table differs", "" );
+}
+
+void test_27_load_compressed_db_ok_1()
+{
+    auto * users = new anyvalue_db::Table;
+
+    init_table_n( users, 1000 );
+
+    std::string error_msg;
+
+    {
+        anyvalue_db::DB db;
+
+        db.init();
+
+        db.add_table( "users", users, & error_msg );
+
+        auto b = db.save( & error_msg, "test_27.db", true );
+
+        if( b == false )
+        {
+            log_test( "test_27_load_compressed_db_ok_1", b, true, "database saved", "cannot save database", error_msg );
+            return;
+        }
+    }
+
+    anyvalue_db::DB db;
+
+    auto b = db.init( "test_27.db" );
+
+    auto t = b ? db.find__unlocked( "users" ) : nullptr;
+
+    log_test( "test_27_load_compressed_db_ok_1", t != nullptr && t->get_size() == 1000, true, "database loaded", "cannot load database", "" );
+}
+
+void test_28_load_corrupted_nok_1()
+{
+    std::string data;
+
+    {
+        std::ifstream is( "test_27.dat", std::ios::binary );
+
+        data.assign( std::istreambuf_iterator<char>( is ), std::istreambuf_iterator<char>() );
+    }
+
+    data[ data.size() - 10 ] ^= 0x5A;   // damage the last block
+
+    {
+        std::ofstream os( "test_28_corrupted.dat", std::ios::binary );
+
+        os.write( data.data(), data.size() );
+    }
+
+    anyvalue_db::Table table;
+
+    auto b = false;
+    std::string error_msg;
+
+    try
+    {
+        table.init( "test_28_corrupted.dat" );
+
+        b = true;
+    }
+    catch( std::exception & e )
+    {
+        error_msg = e.what();
+    }
+
+    b |= error_msg.find( "checksum mismatch" ) == std::string::npos;
+
+    log_test( "test_28_load_corrupted_nok_1", b, false, "corrupted block was detected", "corrupted block was not detected", error_msg );
+}
+
+void test_28_load_corrupted_nok_2()
+{
+    std::string data;
+
+    {
+        std::ifstream is( "test_27.dat", std::ios::binary );
+
+        data.assign( std::istreambuf_iterator<char>( is ), std::istreambuf_iterator<char>() );
+    }
+
+    // magic, version, flags, block size, then the number of blocks
+
+    data[ 19 ] = char( 0x7F );
+
+    {
+        std::ofstream os( "test_28_corrupted_2.dat", std::ios::binary );
+
+        os.write( data.data(), data.size() );
+    }
+
+    anyvalue_db::Table table;
+
+    auto b = false;
+    std::string error_msg;
+
+    try
+    {
+        table.init( "test_28_corrupted_2.dat" );
+
+        b = true;
+    }
+    catch( std::exception & e )
+    {
+        error_msg = e.what();
+    }
+
+    b |= error_msg.find( "corrupt header" ) == std::string::npos;
+
+    log_test( "test_28_load_corrupted_nok_2", b, false, "corrupted header was detected", "corrupted header was not detected", error_msg );
+}
+
+void test_28_load_corrupted_nok_3()
+{
+    std::string data;
+
+    {
+        std::ifstream is( "test_27.dat", std::ios::binary );
+
+        data.assign( std::istreambuf_iterator<char>( is ), std::istreambuf_iterator<char>() );
+    }
+
+    // the flags follow magic and version, clearing the checksum flag must not turn verification off
+
+    data[ 8 ] &= ~0x02;
+
+    {
+        std::ofstream os( "test_28_corrupted_3.dat", std::ios::binary );
+
+        os.write( data.data(), data.size() );
+    }
+
+    anyvalue_db::Table table;
+
+    auto b = false;
+    std::string error_msg;
+
+    try
+    {
+        table.init( "test_28_corrupted_3.dat" );
+
+        b = true;
+    }
+    catch( std::exception & e )
+    {
+        error_msg = e.what();
+    }
+
+    b |= error_msg.find( "checksums are missing" ) == std::string::npos;
+
+    log_test( "test_28_load_corrupted_nok_3", b, false, "missing checksums were detected", "missing checksums were not detected", error_msg );
+}
+
+void test_28_load_truncated_nok_1()
+{
+    std::string data;
+
+    {
+        std::ifstream is( "test_27.dat", std::ios::binary );
+
+        data.assign( std::istreambuf_iterator<char>( is ), std::istreambuf_iterator<char>() );
+    }
+
+    {
+        std::ofstream os( "test_28_truncated.dat", std::ios::binary );
+
+        os.write( data.data(), data.size() / 2 );
+    }
+
+    anyvalue_db::Table table;
+
+    auto b = false;
+    std::string error_msg;
+
+    try
+    {
+        table.init( "test_28_truncated.dat" );
+
+        b = true;
+    }
+    catch( std::exception & e )
+    {
+        error_msg = e.what();
+    }
+
+    b |= error_msg.find( "truncated" ) == std::string::npos;
+
+    log_test( "test_28_load_truncated_nok_1", b, false, "truncated file was detected", "truncated file was not detected", error_msg );
+}
+
+void test_29_lazy_load_ok_1()
+{
+    std::string error_msg;
+
+    {
+        auto * users = new anyvalue_db::Table;
+
+        init_table_n( users, 1000 );
+
+        auto * orders = new anyvalue_db::Table;
+
+        init_order_table_3( orders );
+
+        anyvalue_db::DB db;
+
+        db.init();
+
+        db.add_table( "users", users, & error_msg );
+        db.add_table( "orders", orders, & error_msg );
+
+        db.save( & error_msg, "test_29.db" );
+    }
+
+    anyvalue_db::DB db;
+
+    auto b = db.init( "test_29.db", true );
+
+    std::cout << anyvalue_db::StrHelper::to_string( db ) << "\n";
+
+    auto t = b ? db.find__unlocked( "users" ) : nullptr;
+
+    b = t != nullptr && t->get_size() == 1000;
+
+    log_test( "test_29_lazy_load_ok_1", b, true, "table was loaded on demand", "cannot load table on demand", "" );
+}
+
+void test_29_lazy_evict_ok_1()
+{
+    anyvalue_db::DB db;
+
+    db.init( "test_29.db", true );
+
+    db.find__unlocked( "users" );
+
+    auto num = db.evict_idle_tables__unlocked( 0 );
+
+    auto t = db.find__unlocked( "users" );
+
+    auto b = num == 1 && t != nullptr && t->get_size() == 1000;
+
+    log_test( "test_29_lazy_evict_ok_1", b, true, "table was unloaded and loaded again", "cannot unload table", "" );
+}
+
+void test_29_lazy_evict_nok_1()
+{
+    anyvalue_db::DB db;
+
+    db.init( "test_29.db", true );
+
+    auto t = db.find__unlocked( "orders" );
+
+    t->set_meta_key( LAST_ID, 123456 );
+
+    auto num = db.evict_idle_tables__unlocked( 0 );
+
+    log_test( "test_29_lazy_evict_nok_1", num == 0, true, "modified table was not unloaded", "modified table was unloaded", "" );
+}
+
+void test_29_lazy_evict_nok_2()
+{
+    anyvalue_db::DB db;
+
+    db.init( "test_29.db", true );
+
+    auto t = db.find__unlocked( "users" );
+
+    std::size_t num;
+
+    // another thread keeps the table locked
+
+    std::mutex m;
+    std::condition_variable cv;
+    bool is_locked = false;
+    bool is_done = false;
+
+    std::thread thread( [&]()
+            {
+                MUTEX_SCOPE_LOCK( t->get_mutex() );
+
+                std::unique_lock<std::mutex> lock( m );
+
+                is_locked = true;
+
+                cv.notify_all();
+
+                cv.wait( lock, [&]() { return is_done; } );
+            } );
+
+    {
+        std::unique_lock<std::mutex> lock( m );
+
+        cv.wait( lock, [&]() { return is_locked; } );
+
+        num = db.evict_idle_tables__unlocked( 0 );
+
+        is_done = true;
+
+        cv.notify_all();
+    }
+
+    thread.join();
+
+    auto b = num == 0 && db.find__unlocked( "users" ) == t && t->get_size() == 1000;
+
+    log_test( "test_29_lazy_evict_nok_2", b, true, "table in use was not unloaded", "table in use was unloaded", "" );
+}
+
+void test_29_lazy_load_nok_1()
+{
+    std::string data;
+
+    {
+        std::ifstream is( "test_29.db", std::ios::binary );
+
+        data.assign( std::istreambuf_iterator<char>( is ), std::istreambuf_iterator<char>() );
+    }
+
+    data[ data.size() - 10 ] ^= 0x5A;   // damage the last section
+
+    {
+        std::ofstream os( "test_29_corrupted.db", std::ios::binary );
+
+        os.write( data.data(), data.size() );
+    }
+
+    anyvalue_db::DB db;
+
+    auto b = db.init( "test_29_corrupted.db", true );
+
+    std::string error_msg_1;
+    std::string error_msg_2;
+
+    b = b && db.find__unlocked( "users", & error_msg_1 ) == nullptr && db.find__unlocked( "payments", & error_msg_2 ) == nullptr;
+
+    b = b && error_msg_1.find( "cannot load table users" ) != std::string::npos && error_msg_2 == "table payments not found";
+
+    log_test( "test_29_lazy_load_nok_1", b, true, "load error was reported", "load error was not reported", error_msg_1 );
+}
+
+void test_29_lazy_save_ok_1()
+{
+    std::string error_msg;
+
+    {
+        anyvalue_db::DB db;
+
+        db.init( "test_29.db", true );
+
+        auto b = db.save( & error_msg, "test_29_2.db" );
+
+        if( b == false )
+        {
+            log_test( "test_29_lazy_save_ok_1", b, true, "database saved", "cannot save database", error_msg );
+            return;
+        }
+    }
+
+    anyvalue_db::DB db;
+
+    auto b = db.init( "test_29_2.db" );
+
+    auto t = b ? db.find__unlocked( "orders" ) : nullptr;
+
+    b = t != nullptr && t->get_size() == 3;
+
+    log_test( "test_29_lazy_save_ok_1", b, true, "not loaded tables were saved", "not loaded tables were lost", "" );
+}
+
+void test_30_load_bulk_index_ok_1()
+{
+    std::string error_msg;
+
+    // large enough for the indices to be built in parallel
+
+    {
+        anyvalue_db::Table table;
+
+        init_table_n( & table, 12000 );
+
+        table.save( & error_msg, "test_30_bulk.dat" );
+    }
+
+    anyvalue_db::Table table;
+
+    auto b = false;
+
+    try
+    {
+        table.init( "test_30_bulk.dat" );
+
+        b = true;
+    }
+    catch( std::exception & e )
+    {
+        error_msg = e.what();
+    }
+
+    if( b )
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        for( unsigned i = 0; b && i < 12000; i += 7 )
+        {
+            auto s = std::to_string( i );
+
+            auto rec = table.find__unlocked( ID, int( 10000 + i ) );
+
+            b = rec != nullptr && table.find__unlocked( LOGIN, "user" + s ) == rec && table.find__unlocked( REG_KEY, "key" + s ) == rec;
+        }
+    }
+
+    b = b && table.get_size() == 12000;
+
+    log_test( "test_30_load_bulk_index_ok_1", b, true, "indices were built in parallel", "indices are broken", error_msg );
+}
+
+void test_30_load_duplicate_key_nok_1()
+{
+    std::string error_msg;
+
+    {
+        anyvalue_db::Table table;
+
+        init_table_n( & table, 10 );
+
+        table.save( & error_msg, "test_30_dup.dat" );
+    }
+
+    std::string data;
+
+    auto b = anyvalue_db::BlockFile::load( & error_msg, "test_30_dup.dat", & data );
+
+    unsigned int version = 0;
+
+    anyvalue_db::Status status;
+
+    {
+        std::istringstream is( data );
+
+        b = b && serializer::load( is, & version ) != nullptr && anyvalue_db::Serializer::load( is, & status ) != nullptr && status.records.size() == 10;
+    }
+
+    if( b == false )
+    {
+        log_test( "test_30_load_duplicate_key_nok_1", b, false, "table was read", "cannot read table", error_msg );
+        return;
+    }
+
+    // two records get the same key, as if the file was written by a broken version
+
+    anyvalue::Value login;
+
+    status.records[ 0 ]->get_field( LOGIN, & login );
+
+    status.records[ 1 ]->update_field( LOGIN, login );
+
+    {
+        std::ostringstream os;
+
+        serializer::save( os, version );
+        anyvalue_db::Serializer::save( os, status );
+
+        b = anyvalue_db::BlockFile::save( & error_msg, "test_30_dup.dat", os.str(), false );
+    }
+
+    for( auto r : status.records )
+        anyvalue_db::Serializer::destroy_Record( r );
+
+    anyvalue_db::Table table;
+
+    try
+    {
+        table.init( "test_30_dup.dat" );
+    }
+    catch( std::exception & e )
+    {
+        b = false;
+        error_msg = e.what();
+    }
+
+    log_test( "test_30_load_duplicate_key_nok_1", b, false, "duplicate key was rejected", "duplicate key was accepted", error_msg );
+}
+
+void test_30_save_persisted_index_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 1000 );
+
+    table.set_persist_index( true );
+
+    std::string error_msg;
+
+    auto b = table.save( & error_msg, "test_30.dat" );
+
+    log_test( "test_30_save_persisted_index_ok_1", b, true, "table was written", "cannot write file", error_msg );
+}
+
+void test_30_save_persisted_index_ok_2()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        for( int i = 0; i < 10; ++i )
+            table.find__unlocked( ID, 10000 + i )->delete_field( LOGIN );
+    }
+
+    table.set_persist_index( true );
+
+    std::string error_msg;
+    std::string data;
+
+    auto b = table.save( & error_msg, "test_30_2.dat" ) && anyvalue_db::BlockFile::load( & error_msg, "test_30_2.dat", & data );
+
+    unsigned int version = 0;
+
+    anyvalue_db::Status status;
+
+    {
+        std::istringstream is( data );
+
+        b = b && serializer::load( is, & version ) != nullptr && anyvalue_db::Serializer::load( is, & status ) != nullptr;
+    }
+
+    // records without an indexed field don't make the index inconsistent
+
+    b = b && status.is_index_valid && status.indices.size() == 3;
+
+    for( auto & e : status.indices )
+        b = b && e.second.size() == ( e.first == LOGIN ? 90u : 100u );
+
+    for( auto r : status.records )
+        anyvalue_db::Serializer::destroy_Record( r );
+
+    log_test( "test_30_save_persisted_index_ok_2", b, true, "index was checked on save", "index was not checked on save", error_msg );
+}
+
+void test_30_load_persisted_index_ok_1()
+{
+    anyvalue_db::Table table;
+
+    auto b = false;
+    std::string error_msg;
+
+    try
+    {
+        table.init( "test_30.dat" );
+
+        b = true;
+    }
+    catch( std::exception & e )
+    {
+        error_msg = e.what();
+    }
+
+    if( b == false )
+    {
+        log_test( "test_30_load_persisted_index_ok_1", b, true, "table was loaded", error_msg, "" );
+        return;
+    }
+
+    auto & mutex = table.get_mutex();
+
+    MUTEX_SCOPE_LOCK( mutex );
+
+    auto rec_1 = table.find__unlocked( LOGIN, "user777" );
+    auto rec_2 = table.find__unlocked( REG_KEY, "key777" );
+    auto rec_3 = table.find__unlocked( ID, 10777 );
+
+    b = rec_1 != nullptr && rec_1 == rec_2 && rec_1 == rec_3;
+
+    log_test( "test_30_load_persisted_index_ok_1", b, true, "index was restored", "index was not restored", "" );
+}
+
+void test_30_load_persisted_index_nok_1()
+{
+    std::string error_msg;
+    std::string data;
+
+    auto b = anyvalue_db::BlockFile::load( & error_msg, "test_30.dat", & data );
+
+    // table version, then its status
+
+    unsigned int version = 0;
+
+    anyvalue_db::Status status;
+
+    {
+        std::istringstream is( data );
+
+        b = b && serializer::load( is, & version ) != nullptr && anyvalue_db::Serializer::load( is, & status ) != nullptr &&
+                status.is_index_valid && status.indices.empty() == false;
+    }
+
+    if( b == false )
+    {
+        log_test( "test_30_load_persisted_index_nok_1", b, true, "table was read", "cannot read table", error_msg );
+        return;
+    }
+
+    // the last entry of the first index is lost
+
+    status.indices.front().second.pop_back();
+
+    {
+        std::ostringstream os;
+
+        serializer::save( os, version );
+        anyvalue_db::Serializer::save( os, status );
+
+        b = anyvalue_db::BlockFile::save( & error_msg, "test_30_truncated.dat", os.str(), false );
+    }
+
+    for( auto r : status.records )
+        anyvalue_db::Serializer::destroy_Record( r );
+
+    anyvalue_db::Table table;
+
+    try
+    {
+        table.init( "test_30_truncated.dat" );
+    }
+    catch( std::exception & e )
+    {
+        b = false;
+        error_msg = e.what();
+    }
+
+    auto field_id = status.indices.front().first;
+
+    std::size_t num_found = 0;
+
+    if( b )
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        for( unsigned i = 0; i < 1000; ++i )
+        {
+            auto s = std::to_string( i );
+
+            auto v = field_id == ID ? anyvalue::Value( int( 10000 + i ) ) : field_id == LOGIN ? anyvalue::Value( "user" + s ) : anyvalue::Value( "key" + s );
+
+            if( table.find__unlocked( field_id, v ) )
+                ++num_found;
+        }
+    }
+
+    b = b && num_found == 1000;
+
+    log_test( "test_30_load_persisted_index_nok_1", b, true, "truncated index was rebuilt", "records are missing in the index", error_msg );
+}
+
+void test_31_create_delete_records_ok_1()
+{
+    anyvalue_db::Table table;
+
+    table.init( std::vector<anyvalue_db::field_id_t>( { ID, LOGIN } ));
+
+    std::string error_msg;
+
+    auto & mutex = table.get_mutex();
+
+    bool b = true;
+
+    {
+        MUTEX_SCOPE_LOCK( mutex );
+
+        std::vector<anyvalue_db::Record*> records;
+
+        for( int i = 0; i < 2000 && b; ++i )
+        {
+            auto rec = table.create_record__unlocked( & error_msg );
+
+            b = rec != nullptr && rec->add_field( ID, 20000 + i ) && rec->add_field( LOGIN, "login" + std::to_string( i ) );
+
+            records.push_back( rec );
+        }
+
+        for( int i = 0; i < 2000 && b; i += 2 )
+        {
+            b = table.delete_record__unlocked( records[i], & error_msg );
+        }
+
+        for( int i = 0; i < 500 && b; ++i )
+        {
+            auto rec = table.create_record__unlocked( & error_msg );
+
+            b = rec != nullptr && rec->add_field( ID, 30000 + i );
+        }
+    }
+
+    b = b && table.get_size() == 1500;
+
+    log_test( "test_31_create_delete_records_ok_1", b, true, "records were created and deleted", "cannot create or delete records", error_msg );
+}
+
+void test_31_save_load_records_ok_1()
+{
+    std::string error_msg;
+
+    bool b;
+
+    {
+        anyvalue_db::Table table;
+
+        init_table_n( & table, 1000 );
+
+        b = table.save( & error_msg, "test_31.dat" );
+    }
+
+    if( b == false )
+    {
+        log_test( "test_31_save_load_records_ok_1", b, true, "table was written", "cannot write file", error_msg );
+        return;
+    }
+
+    anyvalue_db::Table table;
+
+    try
+    {
+        table.init( "test_31.dat" );
+    }
+    catch( std::exception & e )
+    {
+        log_test( "test_31_save_load_records_ok_1", false, true, "table was loaded", e.what(), "" );
+        return;
+    }
+
+    b = table.get_size() == 1000;
+
+    if( b )
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        auto rec = table.find__unlocked( LOGIN, "user123" );
+
+        b = rec != nullptr && rec->get_field( REG_KEY ).get_string() == "key123" && table.delete_record__unlocked( rec, & error_msg );
+    }
+
+    log_test( "test_31_save_load_records_ok_1", b, true, "records were loaded", "records were not loaded", error_msg );
+}
+
+void test_32_stale_handle_nok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 10 );
+
+    std::string error_msg;
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto rec = table.find__unlocked( LOGIN, "user5" );
+
+    auto handle = table.get_handle__unlocked( rec );
+
+    auto b = table.get_record__unlocked( handle ) == rec && table.delete_record__unlocked( handle, & error_msg );
+
+    if( b )
+    {
+        // the slot is reused by the next record, but the old handle must stay stale
+
+        auto rec_2 = table.create_record__unlocked( & error_msg );
+
+        b = table.get_record__unlocked( handle ) != nullptr || table.delete_record__unlocked( handle, & error_msg ) || rec_2 == nullptr;
+    }
+    else
+    {
+        b = true;
+    }
+
+    log_test( "test_32_stale_handle_nok_1", b, false, "stale handle was rejected", "stale handle was accepted", error_msg );
+}
+
+void test_32_scan_order_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    std::string error_msg;
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto res = table.select__unlocked( REG_KEY, anyvalue::comparison_type_e::NEQ, std::string( "" ) );
+
+    bool b = res.size() == 100;
+
+    for( std::size_t i = 0; i < res.size() && b; ++i )
+    {
+        b = res[ i ]->get_field( ID ).get_int() == int( 10000 + i );
+    }
+
+    log_test( "test_32_scan_order_ok_1", b, true, "records are scanned in insertion order", "records are scanned in arbitrary order", error_msg );
+}
+
+void init_table_dictionary( anyvalue_db::Table * table )
+{
+    table->init( std::vector<anyvalue_db::field_id_t>( { ID, LOGIN } ), std::vector<anyvalue_db::field_id_t>( { LAST_NAME } ) );
+
+    static const char * last_names[] = { "Doe", "Smith", "Brown" };
+
+    std::string error_msg;
+
+    for( unsigned i = 0; i < 30; ++i )
+    {
+        auto s = std::to_string( i );
+
+        table->add_record( create_record( 10000 + i, "user" + s, "xxx", last_names[ i % 3 ], "John", "john." + s + "@yoyodyne.com", "+1234567890", "key" + s, 1 ), & error_msg );
+    }
+}
+
+void test_33_select_dictionary_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_dictionary( & table );
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto res_1 = table.select__unlocked( LAST_NAME, anyvalue::comparison_type_e::EQ, std::string( "Smith" ) );
+    auto res_2 = table.select__unlocked( LAST_NAME, anyvalue::comparison_type_e::NEQ, std::string( "Smith" ) );
+    auto res_3 = table.select__unlocked( LAST_NAME, anyvalue::comparison_type_e::EQ, std::string( "Unknown" ) );
+
+    auto b = res_1.size() == 10 && res_2.size() == 20 && res_3.empty() && res_1[ 0 ]->get_field( LAST_NAME ).get_string() == "Smith";
+
+    log_test( "test_33_select_dictionary_ok_1", b, true, "dictionary field was selected", "wrong selection on dictionary field", "" );
+}
+
+void test_33_update_dictionary_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_dictionary( & table );
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto rec = table.find__unlocked( LOGIN, "user1" );
+
+    auto b = rec != nullptr && rec->update_field( LAST_NAME, std::string( "Miller" ) );
+
+    auto res_1 = table.select__unlocked( LAST_NAME, anyvalue::comparison_type_e::EQ, std::string( "Smith" ) );
+    auto res_2 = table.select__unlocked( LAST_NAME, anyvalue::comparison_type_e::EQ, std::string( "Miller" ) );
+
+    b = b && res_1.size() == 9 && res_2.size() == 1 && res_2[ 0 ] == rec;
+
+    log_test( "test_33_update_dictionary_ok_1", b, true, "dictionary field was updated", "cannot update dictionary field", "" );
+}
+
+void test_33_save_load_dictionary_ok_1()
+{
+    std::string error_msg;
+
+    bool b;
+
+    {
+        anyvalue_db::Table table;
+
+        init_table_dictionary( & table );
+
+        b = table.save( & error_msg, "test_33.dat" );
+    }
+
+    anyvalue_db::Table table;
+
+    if( b )
+    {
+        try
+        {
+            table.init( "test_33.dat" );
+        }
+        catch( std::exception & e )
+        {
+            b = false;
+            error_msg = e.what();
+        }
+    }
+
+    if( b )
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        auto res = table.select__unlocked( LAST_NAME, anyvalue::comparison_type_e::EQ, std::string( "Brown" ) );
+
+        b = res.size() == 10 && res[ 0 ]->get_field( LAST_NAME ).get_string() == "Brown";
+    }
+
+    log_test( "test_33_save_load_dictionary_ok_1", b, true, "dictionary field was restored", "dictionary field was not restored", error_msg );
+}
+
+void test_34_select_columnar_ok_1()
+{
+    anyvalue_db::Table table;
+    anyvalue_db::Table table_columnar;
+
+    init_table_n( & table, 200 );
+    init_table_n( & table_columnar, 200 );
+
+    table_columnar.set_columnar( { ID, STATUS, LAST_NAME } );
+
+    std::vector<anyvalue_db::Table::SelectCondition> conditions =
+    {
+        { ID,       anyvalue::comparison_type_e::GE,    10050 },
+        { STATUS,   anyvalue::comparison_type_e::EQ,    1 },
+    };
+
+    bool b = true;
+
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+        MUTEX_SCOPE_LOCK( table_columnar.get_mutex() );
+
+        for( auto is_or : { false, true } )
+        {
+            auto res_1 = table.select__unlocked( is_or, conditions );
+            auto res_2 = table_columnar.select__unlocked( is_or, conditions );
+
+            b = b && res_1.size() == res_2.size();
+
+            for( std::size_t i = 0; i < res_1.size() && b; ++i )
+            {
+                b = res_1[ i ]->get_field( ID ).get_int() == res_2[ i ]->get_field( ID ).get_int();
+            }
+        }
+    }
+
+    log_test( "test_34_select_columnar_ok_1", b, true, "columnar select matches row select", "columnar select differs from row select", "" );
+}
+
+void test_34_modify_columnar_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    table.set_columnar( { ID, REG_KEY } );
+
+    std::string error_msg;
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto rec_1 = table.find__unlocked( ID, 10001 );
+    auto rec_2 = table.find__unlocked( ID, 10002 );
+
+    auto b = rec_1 && rec_2 &&
+            rec_1->update_field( REG_KEY, std::string( "new_key" ) ) &&
+            rec_2->delete_field( REG_KEY ) &&
+            table.delete_record__unlocked( ID, 10003, & error_msg );
+
+    auto res_1 = table.select__unlocked( REG_KEY, anyvalue::comparison_type_e::EQ, std::string( "new_key" ) );
+    auto res_2 = table.select__unlocked( REG_KEY, anyvalue::comparison_type_e::NEQ, std::string( "new_key" ) );
+    auto res_3 = table.select__unlocked( ID, anyvalue::comparison_type_e::LT, 10005 );
+
+    b = b && res_1.size() == 1 && res_1[ 0 ] == rec_1 && res_2.size() == 97 && res_3.size() == 4;
+
+    log_test( "test_34_modify_columnar_ok_1", b, true, "columns follow modifications", "columns are out of sync", error_msg );
+}
+
+void test_35_select_int_kernels_ok_1()
+{
+    anyvalue_db::Table table;
+    anyvalue_db::Table table_columnar;
+
+    init_table_n( & table, 300 );
+    init_table_n( & table_columnar, 300 );
+
+    table_columnar.set_columnar( { ID, LOGIN } );
+
+    bool b = true;
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+    MUTEX_SCOPE_LOCK( table_columnar.get_mutex() );
+
+    for( auto op : { anyvalue::comparison_type_e::EQ, anyvalue::comparison_type_e::NEQ, anyvalue::comparison_type_e::LT,
+        anyvalue::comparison_type_e::LE, anyvalue::comparison_type_e::GT, anyvalue::comparison_type_e::GE } )
+    {
+        for( auto value : { 9000, 10000, 10131, 10299, 20000 } )
+        {
+            auto res_1 = table.select__unlocked( ID, op, value );
+            auto res_2 = table_columnar.select__unlocked( ID, op, value );
+
+            b = b && res_1.size() == res_2.size();
+        }
+    }
+
+    for( auto value : { "user0", "user299", "user", "nobody" } )
+    {
+        auto res_1 = table.select__unlocked( LOGIN, anyvalue::comparison_type_e::EQ, std::string( value ) );
+        auto res_2 = table_columnar.select__unlocked( LOGIN, anyvalue::comparison_type_e::EQ, std::string( value ) );
+
+        b = b && res_1.size() == res_2.size();
+    }
+
+    log_test( "test_35_select_int_kernels_ok_1", b, true, "vectorized select matches row select", "vectorized select differs from row select", "" );
+}
+
+void test_35_select_prefix_ok_1()
+{
+    anyvalue_db::Table table;
+    anyvalue_db::Table table_columnar;
+
+    init_table_n( & table, 300 );
+    init_table_n( & table_columnar, 300 );
+
+    table_columnar.set_columnar( { LOGIN, EMAIL } );
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+    MUTEX_SCOPE_LOCK( table_columnar.get_mutex() );
+
+    auto res_1 = table.select_prefix__unlocked( LOGIN, "user1" );
+    auto res_2 = table_columnar.select_prefix__unlocked( LOGIN, "user1" );
+    auto res_3 = table_columnar.select_prefix__unlocked( EMAIL, "john.doe.12@" );
+    auto res_4 = table_columnar.select_prefix__unlocked( LOGIN, "" );
+
+    auto b = res_1.size() == 111 && res_2.size() == 111 && res_3.size() == 1 && res_4.size() == 300;
+
+    log_test( "test_35_select_prefix_ok_1", b, true, "prefix select is correct", "prefix select is wrong", "" );
+}
+
+void test_36_schema_ok_1()
+{
+    anyvalue_db::Table table;
+
+    table.init( create_user_schema() );
+
+    std::string error_msg;
+
+    auto b = table.add_record( create_record_1(), & error_msg ) && table.add_record( create_record_2(), & error_msg );
+
+    int64_t id = 0;
+    std::string login;
+
+    if( b )
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        auto rec = table.find__unlocked( LOGIN, "test" );
+
+        b = rec && rec->get_field_as( ID, & id ) && rec->get_field_as( LOGIN, & login ) && rec->get_field_as( LOGIN, & id ) == false &&
+                table.select__unlocked( ID, anyvalue::comparison_type_e::GT, 1111 ).size() == 1;
+    }
+
+    b = b && id == 1111 && login == "test";
+
+    log_test( "test_36_schema_ok_1", b, true, "records match schema", "records don't match schema", error_msg );
+}
+
+void test_36_schema_nok_1()
+{
+    anyvalue_db::Table table;
+
+    table.init( create_user_schema() );
+
+    std::string error_msg;
+
+    auto rec = new anyvalue_db::Record();
+
+    rec->add_field( ID,         std::string( "1111" ) );
+    rec->add_field( LOGIN,      std::string( "test" ) );
+    rec->add_field( PASSWORD,   std::string( "xxx" ) );
+    rec->add_field( STATUS,     1 );
+
+    auto b = table.add_record( rec, & error_msg );
+
+    if( b == false )
+        delete rec;
+
+    log_test( "test_36_schema_nok_1", b, false, "wrong type was rejected", "wrong type was accepted", error_msg );
+}
+
+void test_36_schema_nok_2()
+{
+    anyvalue_db::Table table;
+
+    table.init( create_user_schema() );
+
+    std::string error_msg;
+
+    table.add_record( create_record_1(), & error_msg );
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto rec = table.find__unlocked( LOGIN, "test" );
+
+    auto b = rec == nullptr ||
+            rec->update_field( STATUS, std::string( "active" ) ) ||
+            rec->delete_field( PASSWORD ) ||
+            rec->add_field( 12345, 1 );
+
+    b = b || rec->delete_field( PHONE ) == false;   // nullable field can be deleted
+
+    log_test( "test_36_schema_nok_2", b, false, "schema violations were rejected", "schema violations were accepted", error_msg );
+}
+
+void test_36_schema_nok_3()
+{
+    anyvalue_db::Table table;
+
+    table.init( std::vector<anyvalue_db::field_id_t>( { ID } ) );
+
+    std::string error_msg;
+
+    // LOGIN and REG_KEY are declared unique, but the table has no index to enforce it
+
+    auto b = table.set_schema( create_user_schema(), & error_msg );
+
+    log_test( "test_36_schema_nok_3", b, false, "schema with missing keys was rejected", "schema with missing keys was accepted", error_msg );
+}
+
+void test_37_init_list_record_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 10 );
+
+    std::string error_msg;
+
+    auto rec = new anyvalue_db::Record( {
+        { ID,       20000 },
+        { LOGIN,    std::string( "init_list" ) },
+        { REG_KEY,  std::string( "init_list_key" ) },
+        { STATUS,   1 } } );
+
+    auto b = table.add_record( rec, & error_msg );
+
+    if( b )
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        b = table.find__unlocked( LOGIN, "init_list" ) == rec && table.find__unlocked( ID, 20000 ) == rec;
+    }
+    else
+    {
+        delete rec;
+    }
+
+    log_test( "test_37_init_list_record_ok_1", b, true, "record was added", "cannot add record", error_msg );
+}
+
+void test_37_move_field_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 10 );
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto rec = table.find__unlocked( LOGIN, "user3" );
+
+    anyvalue::Value login( std::string( "moved_login" ) );
+
+    auto b = rec != nullptr && rec->update_field( LOGIN, std::move( login ) ) &&
+            rec->delete_field( PHONE ) && rec->add_field( PHONE, anyvalue::Value( std::string( "+12345" ) ) ) &&
+            table.find__unlocked( LOGIN, "moved_login" ) == rec && table.find__unlocked( LOGIN, "user3" ) == nullptr &&
+            rec->update_field( LOGIN, anyvalue::Value( std::string( "user4" ) ) ) == false;
+
+    log_test( "test_37_move_field_ok_1", b, true, "fields were moved in", "cannot move fields in", "" );
+}
+
+void test_37_update_key_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 10 );
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    std::string error_msg;
+
+    // the new key goes right before the old one in the index
+
+    auto b = table.delete_record__unlocked( ID, 10004, & error_msg );
+
+    auto rec = table.find__unlocked( ID, 10005 );
+
+    b = b && rec != nullptr && rec->update_field( ID, anyvalue::Value( 10004 ) ) &&
+            table.find__unlocked( ID, 10004 ) == rec && table.find__unlocked( ID, 10005 ) == nullptr;
+
+    for( int i = 0; b && i < 10; ++i )
+    {
+        if( i != 5 )
+            b = table.find__unlocked( ID, 10000 + i ) != nullptr;
+    }
+
+    log_test( "test_37_update_key_ok_1", b, true, "key was updated to the adjacent smaller one", "index is broken", error_msg );
+}
+
+void test_38_memory_stats_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    auto stats_1 = table.get_memory_stats();
+
+    std::string error_msg;
+
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        for( int i = 0; i < 100; ++i )
+            table.delete_record__unlocked( ID, 10000 + i, & error_msg );
+    }
+
+    auto stats_2 = table.get_memory_stats();
+
+    auto b = stats_1.num_records == 100 && stats_1.records == 100 * sizeof( anyvalue_db::Record ) && stats_1.fields > 0 && stats_1.payload > 0 &&
+            stats_1.indices.size() == 3 && stats_1.indices[ 0 ].num_entries == 100 && stats_1.indices[ 0 ].size > 0 &&
+            stats_2.num_records == 0 && stats_2.records == 0 && stats_2.fields == 0 && stats_2.payload == 0 &&
+            stats_2.indices[ 0 ].num_entries == 0 && stats_2.indices[ 0 ].size == 0 && stats_2.indices[ 2 ].size == 0;
+
+    log_test( "test_38_memory_stats_ok_1", b, true, "memory stats are correct", "memory stats are wrong", error_msg );
+}
+
+void test_38_memory_stats_ok_2()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 10 );
+
+    auto stats_1 = table.get_memory_stats();
+
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        auto rec = table.find__unlocked( ID, 10005 );
+
+        rec->update_field( EMAIL, std::string( 200, 'x' ) );
+    }
+
+    table.set_meta_key( 1, std::string( 100, 'y' ) );
+
+    auto stats_2 = table.get_memory_stats();
+
+    auto b = stats_2.payload > stats_1.payload + 150 && stats_2.metakeys > stats_1.metakeys + 100 && stats_2.get_total() > stats_1.get_total();
+
+    log_test( "test_38_memory_stats_ok_2", b, true, "memory stats follow updates", "memory stats don't follow updates", "" );
+}
+
+void test_39_memory_budget_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 200 );
+
+    auto stats_1 = table.get_memory_stats();
+
+    std::string error_msg;
+
+    auto b = table.set_memory_budget( stats_1.fields / 10, "test_39_1.spill", & error_msg );
+
+    if( b == false )
+    {
+        log_test( "test_39_memory_budget_ok_1", b, true, "budget was set", "cannot set budget", error_msg );
+        return;
+    }
+
+    auto stats_2 = table.get_memory_stats();
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto rec_1 = table.find__unlocked( LOGIN, "user5" );
+
+    auto res = table.select__unlocked( EMAIL, anyvalue::comparison_type_e::EQ, "john.doe.7@yoyodyne.com" );
+
+    b = stats_2.num_spilled_records > 100 && stats_2.spilled > 0 && stats_2.fields < stats_1.fields / 5 &&
+            rec_1 != nullptr && rec_1->get_field( ID ).get_int() == 10005 && rec_1->get_field( EMAIL ).get_string() == "john.doe.5@yoyodyne.com" &&
+            res.size() == 1 && res[ 0 ]->get_field( ID ).get_int() == 10007;
+
+    log_test( "test_39_memory_budget_ok_1", b, true, "spilled records were loaded back", "spilled records were lost", error_msg );
+}
+
+void test_39_memory_budget_ok_2()
+{
+    std::string error_msg;
+
+    {
+        anyvalue_db::Table table;
+
+        init_table_n( & table, 200 );
+
+        table.set_memory_budget( 1000, "test_39_2.spill", & error_msg );
+
+        {
+            MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+            auto rec = table.find__unlocked( ID, 10010 );
+
+            rec->update_field( PHONE, "+4911111111" );
+
+            // touches all records, so that the updated one gets spilled again
+            table.select__unlocked( LAST_NAME, anyvalue::comparison_type_e::EQ, "Doe" );
+            table.find__unlocked( ID, 10011 );
+        }
+
+        table.save( & error_msg, "test_39.dat" );
+    }
+
+    anyvalue_db::Table table;
+
+    auto b = false;
+
+    try
+    {
+        table.init( "test_39.dat" );
+
+        b = true;
+    }
+    catch( std::exception & e )
+    {
+        error_msg = e.what();
+    }
+
+    if( b == false )
+    {
+        log_test( "test_39_memory_budget_ok_2", b, true, "table was loaded", error_msg, "" );
+        return;
+    }
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto rec_1 = table.find__unlocked( ID, 10010 );
+    auto rec_2 = table.find__unlocked( LOGIN, "user199" );
+
+    b = table.get_memory_stats().num_records == 200 &&
+            rec_1 && rec_1->get_field( PHONE ).get_string() == "+4911111111" &&
+            rec_2 && rec_2->get_field( REG_KEY ).get_string() == "key199";
+
+    log_test( "test_39_memory_budget_ok_2", b, true, "spilled records were saved", "spilled records were not saved", error_msg );
+}
+
+void test_39_memory_budget_ok_3()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 200 );
+
+    std::string error_msg;
+
+    auto b = table.set_memory_budget( 1000, "test_39_3.spill", & error_msg );
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto rec = table.find__unlocked( ID, 10005 );
+
+    anyvalue::Value email;
+
+    b = b && rec && rec->get_field( EMAIL, & email );
+
+    // the following finds spill the record, the copy stays valid, the record is loaded back on access
+
+    for( int i = 0; b && i < 50; ++i )
+        b = table.find__unlocked( ID, 10100 + i ) != nullptr;
+
+    b = b && table.get_memory_stats().num_spilled_records > 100 &&
+            email.get_string() == "john.doe.5@yoyodyne.com" && rec->get_field( EMAIL ).get_string() == "john.doe.5@yoyodyne.com";
+
+    log_test( "test_39_memory_budget_ok_3", b, true, "copied field survived spilling", "copied field was lost", error_msg );
+}
+
+void test_39_memory_stats_concurrent_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 200 );
+
+    std::string error_msg;
+
+    auto b = table.set_memory_budget( 1000, "test_39_4.spill", & error_msg );
+
+    // a monitoring thread reads the counters without the lock, while records are spilled and loaded back
+
+    std::atomic<bool> is_done( false );
+
+    uint64_t max_spilled = 0;
+
+    std::thread monitor( [&]()
+            {
+                while( is_done == false )
+                    max_spilled = std::max( max_spilled, table.get_memory_stats().spilled );
+            } );
+
+    for( int n = 0; b && n < 5; ++n )
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        for( int i = 0; b && i < 200; ++i )
+        {
+            auto rec = table.find__unlocked( ID, 10000 + i );
+
+            b = rec && rec->update_field( PHONE, "+49" + std::to_string( n * 1000 + i ) );
+        }
+    }
+
+    is_done = true;
+
+    monitor.join();
+
+    b = b && max_spilled > 0 && table.get_memory_stats().spilled >= max_spilled;
+
+    log_test( "test_39_memory_stats_concurrent_ok_1", b, true, "counters were read while spilling", "cannot read counters while spilling", error_msg );
+}
+
+void test_40_record_fields_order_ok_1()
+{
+    anyvalue_db::Record rec( {
+        { STATUS,   1 },
+        { ID,       30000 },
+        { EMAIL,    std::string( "x@yoyodyne.com" ) },
+        { ID,       30001 } } );
+
+    auto b = rec.add_field( LOGIN, std::string( "user_40" ) ) && rec.add_field( LOGIN, std::string( "user_40_2" ) ) == false &&
+            rec.delete_field( EMAIL ) && rec.update_field( STATUS, 2 ) && rec.has_field( EMAIL ) == false;
+
+    auto s = anyvalue_db::StrHelper::to_string( rec );
+
+    b = b && rec.get_field( ID ).get_int() == 30000 && rec.get_field( STATUS ).get_int() == 2 &&
+            s.find( "key_1 " ) < s.find( "key_2 " ) && s.find( "key_2 " ) < s.find( "key_10 " );
+
+    log_test( "test_40_record_fields_order_ok_1", b, true, "fields are kept in order", "fields are out of order", s );
+}
+
+void test_42_histogram_ok_1()
+{
+    anyvalue_db::Histogram h;
+
+    for( uint64_t i = 1; i <= 1000; ++i )
+        h.add( i );
+
+    anyvalue_db::HistogramSnapshot snapshot;
+
+    h.merge_into( & snapshot );
+
+    auto p50 = snapshot.get_percentile( 50 );
+    auto p99 = snapshot.get_percentile( 99 );
+
+    auto b = snapshot.count == 1000 && snapshot.max == 1000 && snapshot.get_mean() == 500.5 &&
+            p50 >= 500 && p50 < 500 * 1.125 && p99 >= 990 && p99 <= 1000 &&
+            anyvalue_db::Histogram::get_bucket( 7 ) == 7 &&
+            anyvalue_db::Histogram::get_lower_bound( anyvalue_db::Histogram::get_bucket( 1000 ) ) <= 1000 &&
+            anyvalue_db::Histogram::get_upper_bound( anyvalue_db::Histogram::get_bucket( 1000 ) ) >= 1000;
+
+    log_test( "test_42_histogram_ok_1", b, true, "percentiles are within precision", "percentiles are wrong", std::to_string( p50 ) + " " + std::to_string( p99 ) );
+}
+
+void test_42_metrics_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        for( int i = 0; i < 10; ++i )
+            table.find__unlocked( ID, 10000 + i );
+
+        table.select__unlocked( STATUS, anyvalue::comparison_type_e::EQ, 1 );
+    }
+
+    auto m = table.get_metrics();
+
+    auto & find     = m.operations[ static_cast<unsigned>( anyvalue_db::operation_e::FIND ) ];
+    auto & select   = m.operations[ static_cast<unsigned>( anyvalue_db::operation_e::SELECT ) ];
+    auto & add      = m.operations[ static_cast<unsigned>( anyvalue_db::operation_e::ADD_RECORD ) ];
+
+    auto b = find.count == 10 && select.count == 1 && add.count == 100 && find.sum > 0 &&
+            m.rows_scanned == 100 && m.rows_returned == 33 && m.lock_wait.count >= 100;
+
+    log_test( "test_42_metrics_ok_1", b, true, "operations were counted", "operations were not counted", "" );
+}
+
+void test_42_metrics_threads_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    auto size_1 = table.get_memory_stats().metrics;
+
+    // each thread gets its own shard, which is folded into the retired one when the thread exits
+
+    for( int n = 0; n < 3; ++n )
+    {
+        std::vector<std::thread> threads;
+
+        for( int t = 0; t < 4; ++t )
+        {
+            threads.push_back( std::thread( [&table]()
+                    {
+                        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+                        for( int i = 0; i < 10; ++i )
+                            table.find__unlocked( ID, 10000 + i );
+                    } ) );
+        }
+
+        for( auto & e : threads )
+            e.join();
+    }
+
+    auto size_2 = table.get_memory_stats().metrics;
+
+    auto m = table.get_metrics();
+
+    auto & find = m.operations[ static_cast<unsigned>( anyvalue_db::operation_e::FIND ) ];
+
+    auto b = size_1 > 0 && size_2 == size_1 && find.count == 120 &&
+            anyvalue_db::Histogram::get_bucket( uint64_t( 1 ) << 50 ) == anyvalue_db::Histogram::NUM_BUCKETS - 1;
+
+    log_test( "test_42_metrics_threads_ok_1", b, true, "shards of exited threads were released", "shards of exited threads are kept",
+            std::to_string( size_1 ) + " " + std::to_string( size_2 ) );
+}
+
+void test_43_log_level_ok_1()
+{
+    int num_formatted = 0;
+
+    auto format = [&num_formatted]()
+            {
+                ++num_formatted;
+                return "test_43";
+            };
+
+    anyvalue_db::LogHelper::set_level( anyvalue_db::log_level_e::NONE );
+
+    AVDB_LOG_DEBUG( "Test", "%s", format() );
+    AVDB_LOG_ERROR( "Test", "%s", format() );
+
+    auto b = num_formatted == 0;
+
+    anyvalue_db::LogHelper::set_level( anyvalue_db::log_level_e::WARN );
+
+    AVDB_LOG_INFO( "Test", "%s", format() );
+    AVDB_LOG_WARN( "Test", "%s", format() );
+
+    b = b && num_formatted == 1;
+
+    anyvalue_db::LogHelper::set_level( anyvalue_db::log_level_e::DEBUG );
+
+    log_test( "test_43_log_level_ok_1", b, true, "disabled levels are not formatted", "disabled levels are formatted", std::to_string( num_formatted ) );
+}
+
+void test_44_select_index_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    anyvalue_db::Table::SelectCondition login       = { LOGIN, anyvalue::comparison_type_e::EQ, std::string( "user5" ) };
+    anyvalue_db::Table::SelectCondition status_2    = { STATUS, anyvalue::comparison_type_e::EQ, 2 };
+    anyvalue_db::Table::SelectCondition status_1    = { STATUS, anyvalue::comparison_type_e::EQ, 1 };
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto res_1 = table.select__unlocked( false, { login, status_2 } );
+    auto res_2 = table.select__unlocked( false, { status_1, login } );
+    auto res_3 = table.select__unlocked( true, { login, status_1 } );
+
+    auto b = res_1.size() == 1 && res_2.empty() && res_3.size() == 34;
+
+    log_test( "test_44_select_index_ok_1", b, true, "index lookup applies all conditions", "index lookup returned wrong records",
+            std::to_string( res_1.size() ) + " " + std::to_string( res_2.size() ) + " " + std::to_string( res_3.size() ) );
+}
+
+void test_44_slow_query_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    table.enable_query_log( 0, 2 );
+
+    anyvalue_db::Table::SelectCondition login       = { LOGIN, anyvalue::comparison_type_e::EQ, std::string( "user5" ) };
+    anyvalue_db::Table::SelectCondition status_2    = { STATUS, anyvalue::comparison_type_e::EQ, 2 };
+    anyvalue_db::Table::SelectCondition status_1    = { STATUS, anyvalue::comparison_type_e::EQ, 1 };
+
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        table.select__unlocked( false, { login, status_2 } );
+        table.select__unlocked( status_1 );
+        table.select__unlocked( status_1 );
+    }
+
+    auto slow   = table.get_slow_queries();
+    auto stats  = table.get_query_stats();
+
+    std::map<std::string,anyvalue_db::QueryShapeStats> map_shape_to_stats;
+
+    for( auto & e : stats )
+        map_shape_to_stats[ e.shape ] = e;
+
+    auto & s = map_shape_to_stats[ "10 EQ ?" ];
+
+    auto b = stats.size() == 2 && s.count == 2 && s.num_slow == 2 && s.rows_scanned == 200 && s.rows_matched == 66 && s.access_path == anyvalue_db::access_path_e::SCAN
+            && slow.size() == 2 && slow.front().shape == "10 EQ ?" && slow.front().description != slow.front().shape;
+
+    auto & i = map_shape_to_stats[ "2 EQ ? AND 10 EQ ?" ];
+
+    b = b && i.count == 1 && i.rows_scanned == 1 && i.rows_matched == 1 && i.access_path == anyvalue_db::access_path_e::INDEX;
+
+    table.disable_query_log();
+
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        table.select__unlocked( status_1 );
+    }
+
+    b = b && table.get_query_stats().empty() && table.get_slow_queries().empty();
+
+    log_test( "test_44_slow_query_ok_1", b, true, "queries are logged and aggregated by shape", "wrong query log",
+            std::to_string( stats.size() ) + " " + std::to_string( slow.size() ) + " " + std::to_string( s.count ) + " " + std::to_string( s.rows_matched ) );
+}
+
+void test_45_explain_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100, create_user_schema() );
+
+    auto plan = table.explain( false, {
+            { ID, anyvalue::comparison_type_e::GE, 10010 },
+            { ID, anyvalue::comparison_type_e::LT, 10020 },
+            { STATUS, anyvalue::comparison_type_e::EQ, 1 } } );
+
+    auto b = plan.access_path == anyvalue_db::access_path_e::INDEX && plan.index_field_id == ID &&
+            plan.lower_bound.is_set && plan.lower_bound.is_inclusive && plan.lower_bound.value.get_int() == 10010 &&
+            plan.upper_bound.is_set && plan.upper_bound.is_inclusive == false && plan.upper_bound.value.get_int() == 10020 &&
+            plan.rows_scanned == 10 && plan.rows_matched == 4 && plan.estimated_rows_scanned < 100 &&
+            plan.conditions.size() == 3 &&
+            plan.conditions[0].selectivity <= plan.conditions[1].selectivity && plan.conditions[1].selectivity <= plan.conditions[2].selectivity;
+
+    log_test( "test_45_explain_ok_1", b, true, "range of the index is used", "range of the index is not used", anyvalue_db::to_string( plan ) );
+}
+
+void test_45_explain_ok_2()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100, create_user_schema() );
+
+    auto plan_1 = table.explain( false, { { ID, anyvalue::comparison_type_e::GT, 10050 } } );
+    auto plan_2 = table.explain( false, { { STATUS, anyvalue::comparison_type_e::EQ, 1 } } );
+    auto plan_3 = table.explain( false, {
+            { ID, anyvalue::comparison_type_e::GT, 10050 },
+            { ID, anyvalue::comparison_type_e::LT, 10040 } } );
+
+    auto b = plan_1.access_path == anyvalue_db::access_path_e::INDEX && plan_1.rows_scanned == 49 && plan_1.rows_matched == 49 &&
+            plan_2.access_path == anyvalue_db::access_path_e::SCAN && plan_2.rows_scanned == 100 && plan_2.rows_matched == 33 &&
+            plan_3.access_path == anyvalue_db::access_path_e::INDEX && plan_3.is_empty_range() && plan_3.rows_scanned == 0 && plan_3.rows_matched == 0;
+
+    log_test( "test_45_explain_ok_2", b, true, "access paths are chosen by cost", "wrong access path",
+            anyvalue_db::to_string( plan_1 ) + "; " + anyvalue_db::to_string( plan_2 ) + "; " + anyvalue_db::to_string( plan_3 ) );
+}
+
+void test_45_explain_ok_3()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    // without a schema keys may have any type, so ranges of the index are not used
+
+    std::vector<anyvalue_db::Table::SelectCondition> conditions_1 = { { ID, anyvalue::comparison_type_e::GT, 10050 } };
+    std::vector<anyvalue_db::Table::SelectCondition> conditions_2 = {
+            { LOGIN, anyvalue::comparison_type_e::EQ, std::string( "user5" ) },
+            { STATUS, anyvalue::comparison_type_e::EQ, 1 } };
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto plan_1 = table.explain__unlocked( false, conditions_1 );
+    auto plan_2 = table.explain__unlocked( true, conditions_2 );
+
+    auto b = plan_1.access_path == anyvalue_db::access_path_e::SCAN && plan_1.rows_matched == table.select__unlocked( false, conditions_1 ).size() &&
+            plan_2.access_path == anyvalue_db::access_path_e::SCAN && plan_2.rows_matched == 34 &&
+            plan_2.conditions.front().field_id == STATUS && plan_2.conditions.back().field_id == LOGIN;
+
+    log_test( "test_45_explain_ok_3", b, true, "untyped keys are scanned", "wrong plan for untyped keys",
+            anyvalue_db::to_string( plan_1 ) + "; " + anyvalue_db::to_string( plan_2 ) );
+}
+
+void test_46_field_stats_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 1000, create_user_schema() );
+
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        for( int i = 0; i < 100; ++i )
+            table.find__unlocked( ID, 10000 + i )->delete_field( EMAIL );
+    }
+
+    anyvalue_db::FieldStats status, id, email;
+
+    auto b = table.get_field_stats( STATUS, & status ) && table.get_field_stats( ID, & id ) && table.get_field_stats( EMAIL, & email ) &&
+            table.get_field_stats( 999, & id ) == false;
+
+    anyvalue::Value min, max;
+
+    b = b && status.get_num_values() == 1000 && status.get_num_distinct() == 3 &&
+            id.get_num_distinct() > 900 && id.get_num_distinct() < 1100 &&
+            id.get_min_max( & min, & max ) && min.get_int() == 10000 && max.get_int() == 10999 &&
+            email.get_num_values() == 900 && email.get_missing_share( 1000 ) > 0.09 && email.get_missing_share( 1000 ) < 0.11 &&
+            id.get_histogram_bounds().empty();
+
+    table.analyze();
+
+    b = b && table.get_field_stats( ID, & id );
+
+    uint64_t total = 0;
+
+    for( auto c : id.get_histogram_counts() )
+        total += c;
+
+    auto less = id.estimate_less( 10500, false );
+
+    b = b && id.get_histogram_bounds().size() == anyvalue_db::FieldStats::NUM_BUCKETS && total == 1000 && less > 0.45 && less < 0.55 &&
+            id.estimate_less( 9000, true ) == 0 && id.estimate_eq( 20000 ) == 0;
+
+    log_test( "test_46_field_stats_ok_1", b, true, "statistics match the records", "wrong statistics",
+            std::to_string( id.get_num_distinct() ) + " " + std::to_string( email.get_num_values() ) + " " + std::to_string( less ) );
+}
+
+void test_46_field_stats_ok_2()
+{
+    std::string error_msg;
+
+    anyvalue_db::FieldStats id_1, id_2;
+
+    {
+        anyvalue_db::Table table;
+
+        init_table_n( & table, 1000, create_user_schema() );
+
+        table.analyze();
+
+        table.get_field_stats( ID, & id_1 );
+
+        table.save( & error_msg, "test_46.dat" );
+    }
+
+    anyvalue_db::Table table;
+
+    table.init( "test_46.dat" );
+
+    auto b = table.get_field_stats( ID, & id_2 ) && id_1.get_num_values() == id_2.get_num_values() && id_1.get_num_distinct() == id_2.get_num_distinct() &&
+            id_1.get_histogram_bounds().size() == id_2.get_histogram_bounds().size() && id_2.get_histogram_bounds().empty() == false;
+
+    log_test( "test_46_field_stats_ok_2", b, true, "statistics are persisted", "statistics are not persisted", error_msg );
+}
+
+void test_46_planner_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 1000, create_user_schema() );
+
+    table.analyze();
+
+    auto plan_1 = table.explain( false, { { ID, anyvalue::comparison_type_e::GT, 10990 } } );
+    auto plan_2 = table.explain( false, { { ID, anyvalue::comparison_type_e::GT, 10010 } } );
+
+    auto b = plan_1.access_path == anyvalue_db::access_path_e::INDEX && plan_1.estimated_rows_scanned > 5 && plan_1.estimated_rows_scanned < 20 && plan_1.rows_matched == 9 &&
+            plan_2.access_path == anyvalue_db::access_path_e::SCAN && plan_2.estimated_rows_matched > 950 && plan_2.rows_matched == 989;
+
+    log_test( "test_46_planner_ok_1", b, true, "access paths follow the statistics", "access paths ignore the statistics",
+            anyvalue_db::to_string( plan_1 ) + "; " + anyvalue_db::to_string( plan_2 ) );
+}
+
+std::string get_ids( const std::vector<anyvalue_db::Record*> & records )
+{
+    std::string res;
+
+    for( auto & e : records )
+    {
+        int64_t id = 0;
+
+        e->get_field_as( ID, & id );
+
+        res += ( res.empty() ? "" : "," ) + std::to_string( id );
+    }
+
+    return res;
+}
+
+void test_47_order_by_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100, create_user_schema() );
+
+    std::vector<anyvalue_db::Table::SelectCondition> conditions = { { ID, anyvalue::comparison_type_e::LT, 10030 } };
+
+    anyvalue_db::Table::SelectOptions options( { { STATUS, false }, { ID, true } }, 5, 2 );
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto ids    = get_ids( table.select__unlocked( false, conditions, options ) );
+    auto plan   = table.explain__unlocked( false, conditions, options );
+
+    auto b = ids == "10021,10018,10015,10012,10009" && plan.is_top_k && plan.is_index_order == false;
+
+    log_test( "test_47_order_by_ok_1", b, true, "records are sorted by several keys", "records are not sorted", ids + "; " + anyvalue_db::to_string( plan ) );
+}
+
+void test_47_order_by_ok_2()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 1000, create_user_schema() );
+
+    table.analyze();
+
+    std::vector<anyvalue_db::Table::SelectCondition> conditions_1 = { { STATUS, anyvalue::comparison_type_e::EQ, 2 } };
+    std::vector<anyvalue_db::Table::SelectCondition> conditions_2 = { { ID, anyvalue::comparison_type_e::GE, 10500 } };
+
+    anyvalue_db::Table::SelectOptions options_1( { { ID, true } }, 3, 0 );
+    anyvalue_db::Table::SelectOptions options_2( { { ID, false } }, 2, 0 );
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto ids_1  = get_ids( table.select__unlocked( false, conditions_1, options_1 ) );
+    auto plan_1 = table.explain__unlocked( false, conditions_1, options_1 );
+    auto ids_2  = get_ids( table.select__unlocked( false, conditions_2, options_2 ) );
+    auto plan_2 = table.explain__unlocked( false, conditions_2, options_2 );
+
+    auto b = ids_1 == "10998,10995,10992" && plan_1.is_index_order && plan_1.rows_scanned == 8 &&
+            ids_2 == "10500,10501" && plan_2.is_index_order && plan_2.rows_scanned == 2;
+
+    log_test( "test_47_order_by_ok_2", b, true, "index is walked in order", "index is not walked in order",
+            ids_1 + " " + ids_2 + "; " + anyvalue_db::to_string( plan_1 ) + "; " + anyvalue_db::to_string( plan_2 ) );
+}
+
+void test_47_order_by_ok_3()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 1000, create_user_schema() );
+
+    table.analyze();
+
+    std::vector<anyvalue_db::Table::SelectCondition> conditions;
+
+    anyvalue_db::Table::SelectOptions options_1( { { ID, true } }, 3, 0 );
+    anyvalue_db::Table::SelectOptions options_2( { { STATUS, false }, { ID, false } }, 2, 1 );
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    auto ids_1  = get_ids( table.select__unlocked( false, conditions, options_1 ) );
+    auto plan_1 = table.explain__unlocked( false, conditions, options_1 );
+    auto ids_2  = get_ids( table.select__unlocked( true, conditions, options_2 ) );
+    auto plan_2 = table.explain__unlocked( true, conditions, options_2 );
+    auto res    = table.select__unlocked( false, conditions );
+
+    // no conditions select all records, the index on ID is walked only as far as the limit needs
+
+    auto b = ids_1 == "10999,10998,10997" && plan_1.is_index_order && plan_1.rows_scanned == 3 &&
+            ids_2 == "10003,10006" && plan_2.is_top_k && plan_2.rows_matched == 1000 && res.size() == 1000;
+
+    log_test( "test_47_order_by_ok_3", b, true, "no conditions select all records", "no conditions select wrong records",
+            ids_1 + " " + ids_2 + " " + std::to_string( res.size() ) + "; " + anyvalue_db::to_string( plan_1 ) + "; " + anyvalue_db::to_string( plan_2 ) );
+}
+
+void test_47_limit_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    std::vector<anyvalue_db::Table::SelectCondition> conditions = { { STATUS, anyvalue::comparison_type_e::EQ, 1 } };
+
+    MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+    for( int i = 0; i < 10; ++i )
+        table.find__unlocked( ID, 10000 + i )->delete_field( EMAIL );
+
+    auto plan   = table.explain__unlocked( false, conditions, anyvalue_db::Table::SelectOptions( {}, 5, 0 ) );
+    auto res_1  = table.select__unlocked( false, conditions, anyvalue_db::Table::SelectOptions( {}, 5, 40 ) );
+    auto res_2  = table.select__unlocked( false, conditions, anyvalue_db::Table::SelectOptions( {}, 0, 0 ) );
+    auto ids    = get_ids( table.select__unlocked( false, conditions, anyvalue_db::Table::SelectOptions( { { EMAIL, true } }, 3, 30 ) ) );
+
+    // records without EMAIL come last: 10001, 10004, 10007
+
+    auto b = plan.rows_matched == 5 && plan.rows_scanned == 14 && res_1.empty() && res_2.empty() && ids == "10001,10004,10007";
+
+    log_test( "test_47_limit_ok_1", b, true, "limit and offset are applied", "limit and offset are not applied", ids + "; " + anyvalue_db::to_string( plan ) );
+}
+
+void test_48_aggregate_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100, create_user_schema() );
+
+    auto rows = table.aggregate( false, {}, {
+            { anyvalue_db::aggregate_e::COUNT, 0 },
+            { anyvalue_db::aggregate_e::SUM, STATUS },
+            { anyvalue_db::aggregate_e::AVG, STATUS },
+            { anyvalue_db::aggregate_e::MAX, ID } }, STATUS );
+
+    auto b = rows.size() == 3;
+
+    for( std::size_t i = 0; b && i < rows.size(); ++i )
+    {
+        auto & r = rows[ i ];
+
+        b = r.has_group_key && r.group_key.get_int() == int( i ) &&
+                r.values[ 0 ].get_int() == ( i == 0 ? 34 : 33 ) &&
+                r.values[ 1 ].get_int() == r.values[ 0 ].get_int() * int( i ) &&
+                r.values[ 2 ].get_type() == anyvalue::type_e::DOUBLE && r.values[ 2 ].get_double() == double( i ) &&
+                r.values[ 3 ].get_int() == 10099 - ( 3 - int( i ) ) % 3;
+    }
+
+    log_test( "test_48_aggregate_ok_1", b, true, "groups are aggregated", "wrong aggregates", std::to_string( rows.size() ) );
+}
+
+void test_48_aggregate_ok_2()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100, create_user_schema() );
+
+    std::vector<anyvalue_db::Table::SelectCondition> status_2   = { { STATUS, anyvalue::comparison_type_e::EQ, 2 } };
+    std::vector<anyvalue_db::Table::SelectCondition> none       = { { STATUS, anyvalue::comparison_type_e::EQ, 5 } };
+
+    auto rows_1 = table.aggregate( false, status_2, { { anyvalue_db::aggregate_e::MIN, ID }, { anyvalue_db::aggregate_e::MAX, ID } } );
+    auto rows_2 = table.aggregate( false, {}, { { anyvalue_db::aggregate_e::COUNT, 0 }, { anyvalue_db::aggregate_e::SUM, ID } } );
+    auto rows_3 = table.aggregate( false, none, { { anyvalue_db::aggregate_e::COUNT, 0 }, { anyvalue_db::aggregate_e::MIN, ID } } );
+
+    auto b = rows_1.size() == 1 && rows_1[ 0 ].has_group_key == false && rows_1[ 0 ].values[ 0 ].get_int() == 10002 && rows_1[ 0 ].values[ 1 ].get_int() == 10098 &&
+            rows_2.size() == 1 && rows_2[ 0 ].values[ 0 ].get_int() == 100 && rows_2[ 0 ].values[ 1 ].get_int() == 1004950 &&
+            rows_3.size() == 1 && rows_3[ 0 ].values[ 0 ].get_int() == 0 && rows_3[ 0 ].values[ 1 ].get_type() == anyvalue::type_e::UNDEF;
+
+    log_test( "test_48_aggregate_ok_2", b, true, "aggregates without grouping", "wrong aggregates without grouping", "" );
+}
+
+void test_48_aggregate_ok_3()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        for( int i = 0; i < 10; ++i )
+            table.find__unlocked( ID, 10000 + i )->delete_field( STATUS );
+    }
+
+    auto rows = table.aggregate( false, {}, { { anyvalue_db::aggregate_e::COUNT, 0 }, { anyvalue_db::aggregate_e::MIN, ID } }, STATUS );
+
+    auto b = rows.size() == 4 && rows[ 0 ].values[ 0 ].get_int() == 30 && rows[ 0 ].values[ 1 ].get_int() == 10012 &&
+            rows[ 3 ].has_group_key == false && rows[ 3 ].values[ 0 ].get_int() == 10 && rows[ 3 ].values[ 1 ].get_int() == 10000;
+
+    log_test( "test_48_aggregate_ok_3", b, true, "records without the group field form their own group", "wrong group of records without the field", std::to_string( rows.size() ) );
+}
+
+void test_48_aggregate_ok_4()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100 );
+
+    std::vector<anyvalue_db::Table::SelectCondition> none = { { STATUS, anyvalue::comparison_type_e::EQ, 5 } };
+
+    auto rows_1 = table.aggregate( false, none, { { anyvalue_db::aggregate_e::COUNT, 0 } }, STATUS );
+    auto rows_2 = table.aggregate( false, none, { { anyvalue_db::aggregate_e::COUNT, 0 } } );
+
+    // no groups at all, unlike the single row without grouping
+
+    auto b = rows_1.empty() && rows_2.size() == 1 && rows_2[ 0 ].values[ 0 ].get_int() == 0;
+
+    log_test( "test_48_aggregate_ok_4", b, true, "no groups for no matches", "groups for no matches", std::to_string( rows_1.size() ) );
+}
+
+void test_49_select_fields_ok_1()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 100, create_user_schema() );
+
+    {
+        MUTEX_SCOPE_LOCK( table.get_mutex() );
+
+        table.find__unlocked( ID, 10001 )->delete_field( EMAIL );
+    }
+
+    auto res = table.select_fields( false, { { STATUS, anyvalue::comparison_type_e::EQ, 1 } }, { ID, LOGIN, EMAIL },
+            anyvalue_db::Table::SelectOptions( { { ID, false } }, 3, 0 ) );
+
+    auto b = res.get_num_rows() == 3 && res.get_num_columns() == 3 &&
+            res.get( 0, 0 ).get_int() == 10001 && res.get( 0, 1 ).get_string() == "user1" && res.get( 0, 2 ).get_type() == anyvalue::type_e::UNDEF &&
+            res.get_row( 2 )[ 0 ].get_int() == 10007 && res.get_row( 2 )[ 2 ].get_string() == "john.doe.7@yoyodyne.com" &&
+            res.find_column( LOGIN ) == 1 && res.find_column( 999 ) == anyvalue_db::ResultSet::NOT_FOUND;
+
+    log_test( "test_49_select_fields_ok_1", b, true, "fields are copied", "wrong fields", std::to_string( res.get_num_rows() ) );
+}
+
+void test_49_select_fields_ok_2()
+{
+    anyvalue_db::Table table;
+
+    init_table_n( & table, 200 );
+
+    std::string error_msg;
+
+    auto b = table.set_memory_budget( table.get_memory_stats().fields / 10, "test_49.spill", & error_msg );
+
+    auto num_spilled = table.get_memory_stats().num_spilled_records;
+
+    auto res = table.select_fields( false, { { STATUS, anyvalue::comparison_type_e::EQ, 2 } }, { EMAIL } );
+
+    // spilled records are read in place
+
+    b = b && num_spilled > 100 && table.get_memory_stats().num_spilled_records == num_spilled && res.get_num_rows() == 66;
+
+    for( std::size_t i = 0; b && i < res.get_num_rows(); ++i )
+        b = res.get( i, 0 ).get_type() == anyvalue::type_e::STRING;
+
+    log_test( "test_49_select_fields_ok_2", b, true, "spilled records are projected", "spilled records are not projected", error_msg );
+}
+
+void init_join_db( anyvalue_db::DB * db, unsigned num_users, unsigned num_orders )
+{
+    auto users  = new anyvalue_db::Table;
+    auto orders = new anyvalue_db::Table;
+
+    init_table_n( users, num_users );
+
+    orders->init( std::vector<anyvalue_db::field_id_t>( { ORDER_ID } ));
+
+    std::string error_msg;
+
+    for( unsigned i = 0; i < num_orders; ++i )
+        orders->add_record( create_order( i, 10000 + i % ( num_users + 5 ) ), & error_msg );
+
+    db->init();
+
+    db->add_table( "users", users, & error_msg );
+    db->add_table( "orders", orders, & error_msg );
+}
+
+void test_50_join_ok_1()
+{
+    anyvalue_db::DB db;
+
+    init_join_db( & db, 10, 30 );
+
+    // users has an index on ID, so each order looks up its user
+
+    anyvalue_db::DB::JoinQuery query = { "orders", false, { { ORDER_ID, anyvalue::comparison_type_e::LT, 20 } }, USER_ID, "users", ID };
+
+    anyvalue_db::ResultSet res;
+
+    std::string error_msg;
+
+    auto b = db.join( query, { ORDER_ID }, { LOGIN, STATUS }, & res, & error_msg );
+
+    // orders 0..19 reference users 10000..10014, of which 10010..10014 do not exist
+
+    b = b && res.get_num_rows() == 15 && res.get_num_columns() == 3 && res.find_column( STATUS ) == 2;
+
+    for( std::size_t i = 0; b && i < res.get_num_rows(); ++i )
+    {
+        auto order_id = res.get( i, 0 ).get_int();
+
+        b = res.get( i, 1 ).get_string() == "user" + std::to_string( order_id % 15 ) && res.get( i, 2 ).get_int() == order_id % 15 % 3;
+    }
+
+    log_test( "test_50_join_ok_1", b, true, "index nested loop join", "wrong join result", error_msg );
+}
+
+void test_50_join_ok_2()
+{
+    anyvalue_db::DB db;
+
+    init_join_db( & db, 10, 30 );
+
+    // orders has no index on USER_ID, so the orders are hashed
+
+    anyvalue_db::DB::JoinQuery query = { "users", false, { { STATUS, anyvalue::comparison_type_e::EQ, 1 } }, ID, "orders", USER_ID };
+
+    anyvalue_db::DB::VectorRecordPair pairs;
+
+    std::string error_msg;
+
+    bool b;
+
+    {
+        MUTEX_SCOPE_LOCK( db.get_mutex() );
+
+        auto users  = db.find__unlocked( "users" );
+        auto orders = db.find__unlocked( "orders" );
+
+        MUTEX_SCOPE_LOCK( users->get_mutex() );
+        MUTEX_SCOPE_LOCK( orders->get_mutex() );
+
+        b = db.join__unlocked( query, & pairs, & error_msg );
+    }
+
+    // users 1, 4, 7 have status 1, each of them has two orders
+
+    b = b && pairs.size() == 6;
+
+    for( std::size_t i = 0; b && i < pairs.size(); ++i )
+        b = pairs[ i ].first->get_field( ID ).get_int() == pairs[ i ].second->get_field( USER_ID ).get_int() && pairs[ i ].first->get_field( STATUS ).get_int() == 1;
+
+    // self-join locks the table only once, an empty condition list takes all records
+
+    anyvalue_db::DB::JoinQuery query_2 = { "users", false, {}, STATUS, "users", STATUS };
+
+    anyvalue_db::ResultSet res;
+
+    b = b && db.join( query_2, { ID }, { ID }, & res, & error_msg ) && res.get_num_rows() == 4 * 4 + 3 * 3 + 3 * 3;
+
+    // missing table
+
+    b = b && db.join( { "users", false, {}, ID, "payments", ID }, {}, {}, & res, & error_msg ) == false;
+
+    log_test( "test_50_join_ok_2", b, true, "hash join", "wrong join result", error_msg );
+}
+
 int main( int argc, const char* argv[] )
 {
     test_1_add_record_ok_1();
@@ -1394,6 +3619,74 @@ int main( int argc, const char* argv[] )
     test_24_load_table_ok_1();
     test_25_load_table_find_table_ok_1();
     test_26_load_table_modify_save_ok_1();
+    test_27_save_compressed_ok_1();
+    test_27_load_compressed_ok_1();
+    test_27_load_compressed_db_ok_1();
+    test_28_load_corrupted_nok_1();
+    test_28_load_corrupted_nok_2();
+    test_28_load_corrupted_nok_3();
+    test_28_load_truncated_nok_1();
+    test_29_lazy_load_ok_1();
+    test_29_lazy_evict_ok_1();
+    test_29_lazy_evict_nok_1();
+    test_29_lazy_evict_nok_2();
+    test_29_lazy_load_nok_1();
+    test_29_lazy_save_ok_1();
+    test_30_load_bulk_index_ok_1();
+    test_30_load_duplicate_key_nok_1();
+    test_30_save_persisted_index_ok_1();
+    test_30_save_persisted_index_ok_2();
+    test_30_load_persisted_index_ok_1();
+    test_30_load_persisted_index_nok_1();
+    test_31_create_delete_records_ok_1();
+    test_31_save_load_records_ok_1();
+    test_32_stale_handle_nok_1();
+    test_32_scan_order_ok_1();
+    test_33_select_dictionary_ok_1();
+    test_33_update_dictionary_ok_1();
+    test_33_save_load_dictionary_ok_1();
+    test_34_select_columnar_ok_1();
+    test_34_modify_columnar_ok_1();
+    test_35_select_int_kernels_ok_1();
+    test_35_select_prefix_ok_1();
+    test_36_schema_ok_1();
+    test_36_schema_nok_1();
+    test_36_schema_nok_2();
+    test_36_schema_nok_3();
+    test_37_init_list_record_ok_1();
+    test_37_move_field_ok_1();
+    test_37_update_key_ok_1();
+    test_38_memory_stats_ok_1();
+    test_38_memory_stats_ok_2();
+    test_39_memory_budget_ok_1();
+    test_39_memory_budget_ok_2();
+    test_39_memory_budget_ok_3();
+    test_39_memory_stats_concurrent_ok_1();
+    test_40_record_fields_order_ok_1();
+    test_42_histogram_ok_1();
+    test_42_metrics_ok_1();
+    test_42_metrics_threads_ok_1();
+    test_43_log_level_ok_1();
+    test_44_select_index_ok_1();
+    test_44_slow_query_ok_1();
+    test_45_explain_ok_1();
+    test_45_explain_ok_2();
+    test_45_explain_ok_3();
+    test_46_field_stats_ok_1();
+    test_46_field_stats_ok_2();
+    test_46_planner_ok_1();
+    test_47_order_by_ok_1();
+    test_47_order_by_ok_2();
+    test_47_order_by_ok_3();
+    test_47_limit_ok_1();
+    test_48_aggregate_ok_1();
+    test_48_aggregate_ok_2();
+    test_48_aggregate_ok_3();
+    test_48_aggregate_ok_4();
+    test_49_select_fields_ok_1();
+    test_49_select_fields_ok_2();
+    test_50_join_ok_1();
+    test_50_join_ok_2();
 
     return 0;
 }
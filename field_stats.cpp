@@ -0,0 +1,300 @@
+/*
+
+Field statistics.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "field_stats.h"    // self
+
+#include <algorithm>        // std::sort
+#include <cmath>            // std::log
+
+#include "anyvalue/op_less.h"       // operator<
+
+#include "value_hash.h"     // hash_value, ValueEqual
+
+namespace anyvalue_db
+{
+
+FieldStats::FieldStats():
+        num_values_( 0 ),
+        type_( anyvalue::type_e::UNDEF ),
+        is_mixed_( false ),
+        has_min_max_( false )
+{
+}
+
+void FieldStats::add( const Value & value )
+{
+    if( registers_.empty() )
+        registers_.assign( 1 << HLL_PRECISION, 0 );
+
+    auto h = hash_value( value );
+
+    auto idx = h >> ( 64 - HLL_PRECISION );
+    auto w   = h << HLL_PRECISION;
+
+    auto rank = static_cast<char>( w == 0 ? 64 - HLL_PRECISION + 1 : __builtin_clzll( w ) + 1 );
+
+    if( registers_[ idx ] < rank )
+        registers_[ idx ] = rank;
+
+    if( num_values_ == 0 )
+        type_ = value.get_type();
+    else if( value.get_type() != type_ )
+        is_mixed_ = true;
+
+    ++num_values_;
+
+    if( is_mixed_ || is_ordered( type_ ) == false )
+    {
+        has_min_max_ = false;
+        bounds_.clear();
+        counts_.clear();
+        return;
+    }
+
+    if( has_min_max_ == false )
+    {
+        min_ = value;
+        max_ = value;
+
+        has_min_max_ = true;
+    }
+    else if( value < min_ )
+    {
+        min_ = value;
+    }
+    else if( max_ < value )
+    {
+        max_ = value;
+    }
+
+    if( bounds_.empty() )
+        return;
+
+    // values above the last bound go to the last bucket
+
+    auto i = std::lower_bound( bounds_.begin(), bounds_.end(), value ) - bounds_.begin();
+
+    ++counts_[ std::min<std::size_t>( i, counts_.size() - 1 ) ];
+}
+
+void FieldStats::remove( const Value & value )
+{
+    if( num_values_ == 0 )
+        return;
+
+    if( --num_values_ == 0 )
+    {
+        reset();
+        return;
+    }
+
+    if( bounds_.empty() || is_single_type( value ) == false )
+        return;
+
+    auto i = std::min<std::size_t>( std::lower_bound( bounds_.begin(), bounds_.end(), value ) - bounds_.begin(), counts_.size() - 1 );
+
+    if( counts_[ i ] )
+        --counts_[ i ];
+}
+
+void FieldStats::rebuild( std::vector<Value> * values )
+{
+    reset();
+
+    for( auto & e : * values )
+        add( e );
+
+    if( has_min_max_ == false )
+        return;
+
+    std::sort( values->begin(), values->end() );
+
+    // equal values are kept in one bucket, so buckets may be deeper than the target
+
+    auto n      = values->size();
+    auto depth  = std::max<std::size_t>( 1, ( n + NUM_BUCKETS - 1 ) / NUM_BUCKETS );
+
+    std::size_t start = 0;
+
+    while( start < n )
+    {
+        auto end = std::min( n, start + depth );
+
+        while( end < n && ValueEqual()( ( * values )[ end ], ( * values )[ end - 1 ] ) )
+            ++end;
+
+        bounds_.push_back( ( * values )[ end - 1 ] );
+        counts_.push_back( end - start );
+
+        start = end;
+    }
+}
+
+uint64_t FieldStats::get_num_values() const
+{
+    return num_values_;
+}
+
+uint64_t FieldStats::get_num_distinct() const
+{
+    if( num_values_ == 0 )
+        return 0;
+
+    const double m = 1 << HLL_PRECISION;
+
+    double sum = 0;
+    unsigned num_zeros = 0;
+
+    for( auto r : registers_ )
+    {
+        sum += std::ldexp( 1.0, -r );
+
+        if( r == 0 )
+            ++num_zeros;
+    }
+
+    auto res = 0.7213 / ( 1 + 1.079 / m ) * m * m / sum;
+
+    // linear counting is more precise for small cardinalities
+
+    if( res <= 2.5 * m && num_zeros )
+        res = m * std::log( m / num_zeros );
+
+    return std::max<uint64_t>( 1, std::min<uint64_t>( num_values_, static_cast<uint64_t>( res + 0.5 ) ) );
+}
+
+double FieldStats::get_missing_share( uint64_t num_records ) const
+{
+    if( num_records == 0 || num_values_ >= num_records )
+        return 0;
+
+    return 1 - static_cast<double>( num_values_ ) / num_records;
+}
+
+bool FieldStats::get_min_max( Value * min, Value * max ) const
+{
+    if( has_min_max_ == false )
+        return false;
+
+    * min = min_;
+    * max = max_;
+
+    return true;
+}
+
+const std::vector<Value> & FieldStats::get_histogram_bounds() const
+{
+    return bounds_;
+}
+
+const std::vector<uint64_t> & FieldStats::get_histogram_counts() const
+{
+    return counts_;
+}
+
+double FieldStats::estimate_eq( const Value & value ) const
+{
+    if( num_values_ == 0 )
+        return 0;
+
+    if( has_min_max_ && is_single_type( value ) && ( value < min_ || max_ < value ) )
+        return 0;
+
+    return 1.0 / get_num_distinct();
+}
+
+double FieldStats::estimate_less( const Value & value, bool is_inclusive ) const
+{
+    if( has_min_max_ == false || is_single_type( value ) == false )
+        return -1;
+
+    double res = 0;
+
+    if( bounds_.empty() )
+    {
+        res = estimate_less_in_range( value, min_, max_ );
+    }
+    else
+    {
+        uint64_t total = 0;
+        double   less  = 0;
+
+        for( std::size_t i = 0; i < bounds_.size(); ++i )
+        {
+            auto & lower = i == 0 ? min_ : bounds_[ i - 1 ];
+            auto & upper = i + 1 == bounds_.size() && bounds_[ i ] < max_ ? max_ : bounds_[ i ];
+
+            total += counts_[ i ];
+
+            if( upper < value )
+                less += counts_[ i ];
+            else if( ( value < lower ) == false )
+                less += counts_[ i ] * estimate_less_in_range( value, lower, upper );
+        }
+
+        res = total ? less / total : 0;
+    }
+
+    if( is_inclusive )
+        res += estimate_eq( value );
+
+    return std::min( 1.0, res );
+}
+
+double FieldStats::estimate_less_in_range( const Value & value, const Value & lower, const Value & upper ) const
+{
+    if( ( lower < value ) == false )
+        return 0;
+
+    if( upper < value )
+        return 1;
+
+    if( type_ == anyvalue::type_e::STRING )
+        return 0.5;
+
+    auto range = to_double( upper ) - to_double( lower );
+
+    return range > 0 ? ( to_double( value ) - to_double( lower ) ) / range : 0.5;
+}
+
+bool FieldStats::is_ordered( anyvalue::type_e type )
+{
+    return type == anyvalue::type_e::INT || type == anyvalue::type_e::DOUBLE || type == anyvalue::type_e::STRING;
+}
+
+double FieldStats::to_double( const Value & value )
+{
+    return value.get_type() == anyvalue::type_e::INT ? static_cast<double>( value.get_int() ) : value.get_double();
+}
+
+bool FieldStats::is_single_type( const Value & value ) const
+{
+    return is_mixed_ == false && value.get_type() == type_;
+}
+
+void FieldStats::reset()
+{
+    * this = FieldStats();
+}
+
+} // namespace anyvalue_db
@@ -0,0 +1,114 @@
+/*
+
+Field statistics.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__FIELD_STATS_H
+#define ANYVALUE_DB__FIELD_STATS_H
+
+#include <cstdint>          // uint64_t
+#include <vector>           // std::vector
+#include <string>           // std::string
+
+#include "value.h"          // Value
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief Distribution of values of a field, maintained on every change of the field.
+ *
+ * Deletions don't shrink the distinct count and min/max, and don't move the bounds of the histogram,
+ * rebuild() makes all of them exact again.
+ */
+class FieldStats
+{
+    friend class Serializer;
+
+public:
+
+    static const unsigned HLL_PRECISION = 10;   // 2^10 registers, standard error about 3%
+    static const unsigned NUM_BUCKETS   = 32;
+
+public:
+
+    FieldStats();
+
+    void add( const Value & value );
+    void remove( const Value & value );
+
+    /**
+     * @brief recalculates the statistics from all values of the field, sorts the values
+     */
+    void rebuild( std::vector<Value> * values );
+
+    uint64_t get_num_values() const;
+    uint64_t get_num_distinct() const;
+    double get_missing_share( uint64_t num_records ) const;
+
+    /**
+     * @brief false, if values have different types or are not ordered, i.e. BOOL
+     */
+    bool get_min_max( Value * min, Value * max ) const;
+
+    /**
+     * @brief inclusive upper bounds of equi-depth buckets and numbers of values in them, empty until rebuild()
+     */
+    const std::vector<Value> & get_histogram_bounds() const;
+    const std::vector<uint64_t> & get_histogram_counts() const;
+
+    /**
+     * @brief estimated share of values equal to the value
+     */
+    double estimate_eq( const Value & value ) const;
+
+    /**
+     * @brief estimated share of values less than ( or equal to ) the value, negative if unknown
+     */
+    double estimate_less( const Value & value, bool is_inclusive ) const;
+
+private:
+
+    static bool is_ordered( anyvalue::type_e type );
+    static double to_double( const Value & value );
+
+    bool is_single_type( const Value & value ) const;
+
+    double estimate_less_in_range( const Value & value, const Value & lower, const Value & upper ) const;
+
+    void reset();
+
+private:
+
+    uint64_t                num_values_;
+    std::string             registers_;     // of HyperLogLog, allocated on first value
+    anyvalue::type_e        type_;          // of the first value
+    bool                    is_mixed_;      // true, if values have different types
+    bool                    has_min_max_;
+    Value                   min_;
+    Value                   max_;
+    std::vector<Value>      bounds_;
+    std::vector<uint64_t>   counts_;
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__FIELD_STATS_H
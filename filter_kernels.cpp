@@ -0,0 +1,307 @@
+/*
+
+Filter kernels. Vectorized predicates over column lanes.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "filter_kernels.h"     // self
+
+#include <cstring>          // memcpy, memset
+#include <algorithm>        // std::min
+
+#if defined( __x86_64__ ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define ANYVALUE_DB__FILTER_KERNELS_HW
+#include <immintrin.h>      // _mm256_cmpeq_epi64
+#endif
+
+namespace anyvalue_db
+{
+
+namespace
+{
+
+// every comparison is one of these, possibly negated
+
+enum class mode_e
+{
+    EQ,
+    GT,
+    LT
+};
+
+void clear_bitmap( std::size_t size, uint64_t * res )
+{
+    std::fill( res, res + ( size + 63 ) / 64, 0 );
+}
+
+void negate_bitmap( std::size_t size, uint64_t * res )
+{
+    auto num_words = ( size + 63 ) / 64;
+
+    for( std::size_t i = 0; i < num_words; ++i )
+        res[ i ] = ~res[ i ];
+
+    if( size % 64 )
+        res[ num_words - 1 ] &= ( uint64_t( 1 ) << ( size % 64 ) ) - 1;
+}
+
+inline bool compare( mode_e mode, int64_t a, int64_t b )
+{
+    switch( mode )
+    {
+    case mode_e::EQ:
+        return a == b;
+    case mode_e::GT:
+        return a > b;
+    default:
+        return a < b;
+    }
+}
+
+void compare_int_sw( mode_e mode, const int64_t * values, std::size_t begin, std::size_t size, int64_t value, uint64_t * res )
+{
+    for( auto i = begin; i < size; ++i )
+    {
+        if( compare( mode, values[ i ], value ) )
+            res[ i / 64 ] |= uint64_t( 1 ) << ( i % 64 );
+    }
+}
+
+void equal_masked_sw( const uint64_t * values, std::size_t begin, std::size_t size, uint64_t value, uint64_t mask, uint64_t * res )
+{
+    for( auto i = begin; i < size; ++i )
+    {
+        if( ( values[ i ] & mask ) == value )
+            res[ i / 64 ] |= uint64_t( 1 ) << ( i % 64 );
+    }
+}
+
+#ifdef ANYVALUE_DB__FILTER_KERNELS_HW
+
+__attribute__(( target( "avx2" ) ))
+std::size_t compare_int_avx2( mode_e mode, const int64_t * values, std::size_t size, int64_t value, uint64_t * res )
+{
+    auto v = _mm256_set1_epi64x( value );
+
+    std::size_t i = 0;
+
+    for( ; i + 4 <= size; i += 4 )
+    {
+        auto x = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( values + i ) );
+
+        __m256i m;
+
+        switch( mode )
+        {
+        case mode_e::EQ:
+            m = _mm256_cmpeq_epi64( x, v );
+            break;
+        case mode_e::GT:
+            m = _mm256_cmpgt_epi64( x, v );
+            break;
+        default:
+            m = _mm256_cmpgt_epi64( v, x );
+            break;
+        }
+
+        uint64_t bits = _mm256_movemask_pd( _mm256_castsi256_pd( m ) );
+
+        res[ i / 64 ] |= bits << ( i % 64 );
+    }
+
+    return i;
+}
+
+__attribute__(( target( "sse4.2" ) ))
+std::size_t compare_int_sse( mode_e mode, const int64_t * values, std::size_t size, int64_t value, uint64_t * res )
+{
+    auto v = _mm_set1_epi64x( value );
+
+    std::size_t i = 0;
+
+    for( ; i + 2 <= size; i += 2 )
+    {
+        auto x = _mm_loadu_si128( reinterpret_cast<const __m128i*>( values + i ) );
+
+        __m128i m;
+
+        switch( mode )
+        {
+        case mode_e::EQ:
+            m = _mm_cmpeq_epi64( x, v );
+            break;
+        case mode_e::GT:
+            m = _mm_cmpgt_epi64( x, v );
+            break;
+        default:
+            m = _mm_cmpgt_epi64( v, x );
+            break;
+        }
+
+        uint64_t bits = _mm_movemask_pd( _mm_castsi128_pd( m ) );
+
+        res[ i / 64 ] |= bits << ( i % 64 );
+    }
+
+    return i;
+}
+
+__attribute__(( target( "avx2" ) ))
+std::size_t equal_masked_avx2( const uint64_t * values, std::size_t size, uint64_t value, uint64_t mask, uint64_t * res )
+{
+    auto v = _mm256_set1_epi64x( value );
+    auto k = _mm256_set1_epi64x( mask );
+
+    std::size_t i = 0;
+
+    for( ; i + 4 <= size; i += 4 )
+    {
+        auto x = _mm256_and_si256( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( values + i ) ), k );
+
+        uint64_t bits = _mm256_movemask_pd( _mm256_castsi256_pd( _mm256_cmpeq_epi64( x, v ) ) );
+
+        res[ i / 64 ] |= bits << ( i % 64 );
+    }
+
+    return i;
+}
+
+__attribute__(( target( "sse4.2" ) ))
+std::size_t equal_masked_sse( const uint64_t * values, std::size_t size, uint64_t value, uint64_t mask, uint64_t * res )
+{
+    auto v = _mm_set1_epi64x( value );
+    auto k = _mm_set1_epi64x( mask );
+
+    std::size_t i = 0;
+
+    for( ; i + 2 <= size; i += 2 )
+    {
+        auto x = _mm_and_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>( values + i ) ), k );
+
+        uint64_t bits = _mm_movemask_pd( _mm_castsi128_pd( _mm_cmpeq_epi64( x, v ) ) );
+
+        res[ i / 64 ] |= bits << ( i % 64 );
+    }
+
+    return i;
+}
+
+bool has_avx2()
+{
+    static const bool res = __builtin_cpu_supports( "avx2" );
+
+    return res;
+}
+
+bool has_sse42()
+{
+    static const bool res = __builtin_cpu_supports( "sse4.2" );
+
+    return res;
+}
+
+#endif // ANYVALUE_DB__FILTER_KERNELS_HW
+
+} // namespace
+
+void FilterKernels::compare_int( anyvalue::comparison_type_e op, const int64_t * values, std::size_t size, int64_t value, uint64_t * res )
+{
+    mode_e  mode;
+    bool    is_negated  = false;
+
+    switch( op )
+    {
+    case anyvalue::comparison_type_e::EQ:
+        mode        = mode_e::EQ;
+        break;
+    case anyvalue::comparison_type_e::NEQ:
+        mode        = mode_e::EQ;
+        is_negated  = true;
+        break;
+    case anyvalue::comparison_type_e::GT:
+        mode        = mode_e::GT;
+        break;
+    case anyvalue::comparison_type_e::LE:
+        mode        = mode_e::GT;
+        is_negated  = true;
+        break;
+    case anyvalue::comparison_type_e::LT:
+        mode        = mode_e::LT;
+        break;
+    default:
+        mode        = mode_e::LT;
+        is_negated  = true;
+        break;
+    }
+
+    clear_bitmap( size, res );
+
+    std::size_t done = 0;
+
+#ifdef ANYVALUE_DB__FILTER_KERNELS_HW
+    if( has_avx2() )
+        done = compare_int_avx2( mode, values, size, value, res );
+    else if( has_sse42() )
+        done = compare_int_sse( mode, values, size, value, res );
+#endif
+
+    compare_int_sw( mode, values, done, size, value, res );
+
+    if( is_negated )
+        negate_bitmap( size, res );
+}
+
+void FilterKernels::equal_masked( const uint64_t * values, std::size_t size, uint64_t value, uint64_t mask, uint64_t * res )
+{
+    clear_bitmap( size, res );
+
+    std::size_t done = 0;
+
+#ifdef ANYVALUE_DB__FILTER_KERNELS_HW
+    if( has_avx2() )
+        done = equal_masked_avx2( values, size, value, mask, res );
+    else if( has_sse42() )
+        done = equal_masked_sse( values, size, value, mask, res );
+#endif
+
+    equal_masked_sw( values, done, size, value, mask, res );
+}
+
+uint64_t FilterKernels::get_prefix( const std::string & s )
+{
+    uint64_t res = 0;
+
+    memcpy( & res, s.data(), std::min( s.size(), sizeof( res ) ) );
+
+    return res;
+}
+
+uint64_t FilterKernels::get_prefix_mask( std::size_t size )
+{
+    // built in memory order as the prefix itself, so it doesn't depend on endianness
+
+    uint64_t res = 0;
+
+    memset( & res, 0xFF, std::min( size, sizeof( res ) ) );
+
+    return res;
+}
+
+} // namespace anyvalue_db
@@ -0,0 +1,69 @@
+/*
+
+Filter kernels. Vectorized predicates over column lanes.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__FILTER_KERNELS_H
+#define ANYVALUE_DB__FILTER_KERNELS_H
+
+#include <cstdint>          // int64_t
+#include <cstddef>          // std::size_t
+#include <string>           // std::string
+
+#include "anyvalue/operations.h"    // anyvalue::comparison_type_e
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief Predicates over dense arrays, evaluated several elements per instruction.
+ *
+ * Results are bitmaps, bit i of the result corresponds to element i, bits beyond the size are zero.
+ * AVX2 or SSE4.2 is picked once at runtime, otherwise scalar code is used.
+ */
+class FilterKernels
+{
+public:
+
+    /**
+     * @brief res[i] = values[i] <op> value
+     */
+    static void compare_int( anyvalue::comparison_type_e op, const int64_t * values, std::size_t size, int64_t value, uint64_t * res );
+
+    /**
+     * @brief res[i] = ( values[i] & mask ) == value
+     */
+    static void equal_masked( const uint64_t * values, std::size_t size, uint64_t value, uint64_t mask, uint64_t * res );
+
+    /**
+     * @brief first 8 bytes of the string, zero padded
+     */
+    static uint64_t get_prefix( const std::string & s );
+
+    /**
+     * @brief mask covering first min( size, 8 ) bytes of a prefix
+     */
+    static uint64_t get_prefix_mask( std::size_t size );
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__FILTER_KERNELS_H
@@ -27,6 +27,8 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 #include "types.h"  // field_id_t
 #include "value.h"  // Value
 
+#include <string>   // std::string
+
 namespace anyvalue_db
 {
 
@@ -40,7 +42,12 @@ public:
 
     virtual bool on_add_field( field_id_t field_id, const Value & value, Record * record )      = 0;
     virtual bool on_update_field( field_id_t field_id, const Value & old_value, const Value & new_value, Record * record )  = 0;
-    virtual void on_delete_field( field_id_t field_id, const Value & value )                    = 0;
+    virtual bool on_delete_field( field_id_t field_id, const Value & value, Record * record )   = 0;
+
+    // fields of a spilled record are kept by the table outside of the record
+
+    virtual void on_load_spilled( Record * record ) = 0;
+    virtual bool get_spilled_data( const Record * record, std::string * data ) const    = 0;
 };
 
 } // namespace anyvalue_db
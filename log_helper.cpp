@@ -0,0 +1,41 @@
+/*
+
+Log helper. Level-gated logging.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "log_helper.h"     // self
+
+namespace anyvalue_db
+{
+
+std::atomic<log_level_e> LogHelper::level_( log_level_e::DEBUG );    // everything is passed to the logger by default
+
+void LogHelper::set_level( log_level_e level )
+{
+    level_.store( level, std::memory_order_relaxed );
+}
+
+log_level_e LogHelper::get_level()
+{
+    return level_.load( std::memory_order_relaxed );
+}
+
+} // namespace anyvalue_db
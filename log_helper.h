@@ -0,0 +1,78 @@
+/*
+
+Log helper. Level-gated logging.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__LOG_HELPER_H
+#define ANYVALUE_DB__LOG_HELPER_H
+
+#include <atomic>           // std::atomic
+
+#include "utils/dummy_logger.h"     // dummy_log
+
+namespace anyvalue_db
+{
+
+enum class log_level_e
+{
+    NONE,
+    ERROR,
+    WARN,
+    INFO,
+    DEBUG,
+};
+
+class LogHelper
+{
+public:
+
+    static void set_level( log_level_e level );
+    static log_level_e get_level();
+
+    static bool is_enabled( log_level_e level )
+    {
+        return level <= level_.load( std::memory_order_relaxed );
+    }
+
+private:
+
+    static std::atomic<log_level_e>     level_;
+};
+
+} // namespace anyvalue_db
+
+// Arguments are evaluated only if the level is enabled, so formatting of values costs nothing otherwise.
+// Defining ANYVALUE_DB__NO_DEBUG_LOG strips debug logging at compile time.
+
+#define AVDB_LOG_X( _level, _log, ... ) \
+        do { if( anyvalue_db::LogHelper::is_enabled( anyvalue_db::log_level_e::_level ) ) _log( __VA_ARGS__ ); } while( 0 )
+
+#ifndef ANYVALUE_DB__NO_DEBUG_LOG
+#define AVDB_LOG_DEBUG( ... )   AVDB_LOG_X( DEBUG, dummy_log_debug, __VA_ARGS__ )
+#else
+#define AVDB_LOG_DEBUG( ... )   do { } while( 0 )
+#endif
+
+#define AVDB_LOG_INFO( ... )    AVDB_LOG_X( INFO, dummy_log_info, __VA_ARGS__ )
+#define AVDB_LOG_WARN( ... )    AVDB_LOG_X( WARN, dummy_log_warn, __VA_ARGS__ )
+#define AVDB_LOG_ERROR( ... )   AVDB_LOG_X( ERROR, dummy_log_error, __VA_ARGS__ )
+
+#endif // ANYVALUE_DB__LOG_HELPER_H
@@ -0,0 +1,200 @@
+/*
+
+LZ codec. Simple LZ77-style block compressor.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "lz_codec.h"       // self
+
+#include <cstdint>          // uint32_t
+#include <cstring>          // memcpy
+#include <vector>           // std::vector
+
+namespace anyvalue_db
+{
+
+namespace
+{
+
+const std::size_t MIN_MATCH     = 4;
+const std::size_t MAX_OFFSET    = 0xFFFF;
+const unsigned    HASH_BITS     = 14;
+
+inline uint32_t read_32( const char * p )
+{
+    uint32_t res;
+
+    memcpy( & res, p, sizeof( res ) );
+
+    return res;
+}
+
+inline uint32_t hash_32( uint32_t v )
+{
+    return ( v * 2654435761U ) >> ( 32 - HASH_BITS );
+}
+
+void write_length( std::string * res, std::size_t len )
+{
+    while( len >= 255 )
+    {
+        res->push_back( char( 255 ) );
+        len -= 255;
+    }
+
+    res->push_back( char( len ) );
+}
+
+bool read_length( const unsigned char ** ip, const unsigned char * end, std::size_t * len )
+{
+    unsigned char b;
+
+    do
+    {
+        if( * ip >= end )
+            return false;
+
+        b       = * ( * ip )++;
+        * len   += b;
+    }
+    while( b == 255 );
+
+    return true;
+}
+
+void write_sequence( std::string * res, const char * literals, std::size_t literal_len, std::size_t offset, std::size_t match_len )
+{
+    auto token_lit      = literal_len < 15 ? literal_len : 15;
+    auto token_match    = 0;
+
+    if( match_len )
+        token_match     = ( match_len - MIN_MATCH ) < 15 ? ( match_len - MIN_MATCH ) : 15;
+
+    res->push_back( char( ( token_lit << 4 ) | token_match ) );
+
+    if( literal_len >= 15 )
+        write_length( res, literal_len - 15 );
+
+    res->append( literals, literal_len );
+
+    if( match_len == 0 )
+        return;
+
+    res->push_back( char( offset & 0xFF ) );
+    res->push_back( char( offset >> 8 ) );
+
+    if( match_len - MIN_MATCH >= 15 )
+        write_length( res, match_len - MIN_MATCH - 15 );
+}
+
+} // namespace
+
+void LzCodec::compress( std::string * res, const char * src, std::size_t size )
+{
+    res->clear();
+    res->reserve( size / 2 + 16 );
+
+    std::vector<uint32_t> table( 1 << HASH_BITS, 0 );
+
+    std::size_t anchor  = 0;
+    std::size_t pos     = 1;    // position 0 is used as "no candidate" marker in the table
+
+    while( size >= MIN_MATCH && pos + MIN_MATCH <= size )
+    {
+        auto seq    = read_32( src + pos );
+        auto h      = hash_32( seq );
+        auto cand   = table[ h ];
+
+        table[ h ]  = static_cast<uint32_t>( pos );
+
+        if( cand == 0 || pos - cand > MAX_OFFSET || read_32( src + cand ) != seq )
+        {
+            ++pos;
+            continue;
+        }
+
+        auto match_len = MIN_MATCH;
+
+        while( pos + match_len < size && src[ cand + match_len ] == src[ pos + match_len ] )
+            ++match_len;
+
+        write_sequence( res, src + anchor, pos - anchor, pos - cand, match_len );
+
+        pos     += match_len;
+        anchor  = pos;
+    }
+
+    // last sequence carries literals only
+    write_sequence( res, src + anchor, size - anchor, 0, 0 );
+}
+
+bool LzCodec::decompress( char * dst, std::size_t dst_size, const char * src, std::size_t size )
+{
+    auto ip     = reinterpret_cast<const unsigned char*>( src );
+    auto end    = ip + size;
+
+    std::size_t op = 0;
+
+    while( ip < end )
+    {
+        auto token = * ip++;
+
+        std::size_t literal_len = token >> 4;
+
+        if( literal_len == 15 && read_length( & ip, end, & literal_len ) == false )
+            return false;
+
+        if( literal_len > std::size_t( end - ip ) || literal_len > dst_size - op )
+            return false;
+
+        memcpy( dst + op, ip, literal_len );
+
+        ip  += literal_len;
+        op  += literal_len;
+
+        if( ip == end )
+            break;      // last sequence
+
+        if( end - ip < 2 )
+            return false;
+
+        std::size_t offset = ip[0] | ( ip[1] << 8 );
+
+        ip += 2;
+
+        std::size_t match_len = token & 0x0F;
+
+        if( match_len == 15 && read_length( & ip, end, & match_len ) == false )
+            return false;
+
+        match_len += MIN_MATCH;
+
+        if( offset == 0 || offset > op || match_len > dst_size - op )
+            return false;
+
+        // byte by byte, source and destination may overlap
+        for( std::size_t i = 0; i < match_len; ++i, ++op )
+            dst[ op ] = dst[ op - offset ];
+    }
+
+    return op == dst_size;
+}
+
+} // namespace anyvalue_db
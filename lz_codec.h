@@ -0,0 +1,50 @@
+/*
+
+LZ codec. Simple LZ77-style block compressor.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__LZ_CODEC_H
+#define ANYVALUE_DB__LZ_CODEC_H
+
+#include <string>           // std::string
+#include <cstddef>          // std::size_t
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief LZ4-like byte oriented codec.
+ *
+ * Each call compresses one independent block, there is no state shared between blocks.
+ * Block layout is a sequence of: token, literals, 16-bit offset, match length.
+ */
+class LzCodec
+{
+public:
+
+    static void compress( std::string * res, const char * src, std::size_t size );
+
+    static bool decompress( char * dst, std::size_t dst_size, const char * src, std::size_t size );
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__LZ_CODEC_H
@@ -0,0 +1,105 @@
+/*
+
+Memory stats. Memory footprint of tables and databases.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "memory_stats.h"   // self
+
+#include <map>              // std::map
+
+namespace anyvalue_db
+{
+
+MemoryStats::MemoryStats():
+        num_records( 0 ),
+        records( 0 ),
+        fields( 0 ),
+        payload( 0 ),
+        metakeys( 0 ),
+        dictionaries( 0 ),
+        columns( 0 ),
+        allocator_overhead( 0 ),
+        metrics( 0 ),
+        num_spilled_records( 0 ),
+        spilled( 0 )
+{
+}
+
+uint64_t MemoryStats::get_total() const
+{
+    auto res = records + fields + payload + metakeys + dictionaries + columns + allocator_overhead + metrics;
+
+    for( auto & e : indices )
+        res += e.size;
+
+    return res;
+}
+
+DBMemoryStats::DBMemoryStats():
+        metakeys( 0 ),
+        metrics( 0 )
+{
+}
+
+uint64_t DBMemoryStats::get_total() const
+{
+    auto res = metakeys + metrics;
+
+    for( auto & e : tables )
+        res += e.second.get_total();
+
+    return res;
+}
+
+std::size_t MemorySize::get_payload( const Value & value )
+{
+    if( value.get_type() != anyvalue::type_e::STRING )
+        return 0;
+
+    auto & s = value.get_string();
+
+    // short strings are kept inside the string object itself
+
+    auto p      = reinterpret_cast<const char*>( s.data() );
+    auto self   = reinterpret_cast<const char*>( & s );
+
+    if( p >= self && p < self + sizeof( s ) )
+        return 0;
+
+    return s.capacity() + 1;
+}
+
+std::size_t MemorySize::get_field( const Value & value )
+{
+    return sizeof( std::pair<field_id_t,Value> ) + get_payload( value );
+}
+
+std::size_t MemorySize::get_index_entry( const Value & key )
+{
+    return MAP_NODE_OVERHEAD + sizeof( std::pair<const Value,void*> ) + get_payload( key );
+}
+
+std::size_t MemorySize::get_metakey( const Value & value )
+{
+    return MAP_NODE_OVERHEAD + sizeof( std::pair<const metakey_id_t,Value> ) + get_payload( value );
+}
+
+} // namespace anyvalue_db
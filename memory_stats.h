@@ -0,0 +1,95 @@
+/*
+
+Memory stats. Memory footprint of tables and databases.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__MEMORY_STATS_H
+#define ANYVALUE_DB__MEMORY_STATS_H
+
+#include <cstdint>          // uint64_t
+#include <vector>           // std::vector
+#include <string>           // std::string
+
+#include "types.h"          // field_id_t
+#include "value.h"          // Value
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief Memory used by a table, in bytes. Sizes of containers are estimated from their node layout.
+ */
+struct MemoryStats
+{
+    struct Index
+    {
+        field_id_t  field_id;
+        uint64_t    num_entries;
+        uint64_t    size;
+    };
+
+    uint64_t            num_records;
+    uint64_t            records;            // Record objects
+    uint64_t            fields;             // field entries of records, spare capacity is not counted
+    uint64_t            payload;            // heap memory owned by field values, e.g. long strings
+    std::vector<Index>  indices;
+    uint64_t            metakeys;
+    uint64_t            dictionaries;
+    uint64_t            columns;
+    uint64_t            allocator_overhead; // reserved by the arena, but not handed out
+    uint64_t            metrics;            // per-thread shards of latency histograms
+    uint64_t            num_spilled_records;
+    uint64_t            spilled;            // size of the spill file, not included in the total
+
+    MemoryStats();
+
+    uint64_t get_total() const;
+};
+
+struct DBMemoryStats
+{
+    std::vector<std::pair<std::string,MemoryStats>>   tables;     // loaded tables only
+    uint64_t            metakeys;
+    uint64_t            metrics;
+
+    DBMemoryStats();
+
+    uint64_t get_total() const;
+};
+
+/**
+ * @brief Estimations of sizes of single entries.
+ */
+class MemorySize
+{
+public:
+
+    static const std::size_t MAP_NODE_OVERHEAD  = 4 * sizeof( void* );    // color, parent, left, right of a tree node
+
+    static std::size_t get_payload( const Value & value );
+    static std::size_t get_field( const Value & value );
+    static std::size_t get_index_entry( const Value & key );
+    static std::size_t get_metakey( const Value & value );
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__MEMORY_STATS_H
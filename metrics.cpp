@@ -0,0 +1,411 @@
+/*
+
+Metrics. Operation counters and latency histograms.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "metrics.h"        // self
+
+#include <unordered_map>    // std::unordered_map
+#include <cmath>            // std::ceil
+#include <algorithm>        // std::min
+
+namespace anyvalue_db
+{
+
+namespace
+{
+
+std::atomic<uint64_t>   next_metrics_id( 1 );
+
+const std::size_t       MIN_PRUNE_SIZE  = 16;   // entries of a thread, before the ones of destroyed metrics are pruned
+
+uint64_t get_ns_since( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+}
+
+void increment( std::atomic<uint64_t> & counter, uint64_t value )
+{
+    // single writer, so load and store don't need to be an atomic RMW
+
+    counter.store( counter.load( std::memory_order_relaxed ) + value, std::memory_order_relaxed );
+}
+
+} // namespace
+
+const char* to_string( operation_e op )
+{
+    switch( op )
+    {
+    case operation_e::FIND:             return "find";
+    case operation_e::SELECT:           return "select";
+    case operation_e::ADD_RECORD:       return "add_record";
+    case operation_e::DELETE_RECORD:    return "delete_record";
+    case operation_e::SAVE:             return "save";
+    case operation_e::LOAD:             return "load";
+    case operation_e::FIND_TABLE:       return "find_table";
+    case operation_e::JOIN:             return "join";
+    }
+
+    return "unknown";
+}
+
+HistogramSnapshot::HistogramSnapshot():
+        count( 0 ),
+        sum( 0 ),
+        max( 0 ),
+        buckets( Histogram::NUM_BUCKETS, 0 )
+{
+}
+
+uint64_t HistogramSnapshot::get_percentile( double percentile ) const
+{
+    if( count == 0 )
+        return 0;
+
+    auto target = static_cast<uint64_t>( std::ceil( percentile / 100 * count ) );
+
+    if( target == 0 )
+        target = 1;
+
+    uint64_t sum = 0;
+
+    for( unsigned i = 0; i < buckets.size(); ++i )
+    {
+        sum += buckets[ i ];
+
+        if( sum >= target )
+            return std::min( Histogram::get_upper_bound( i ), max );
+    }
+
+    return max;
+}
+
+double HistogramSnapshot::get_mean() const
+{
+    if( count == 0 )
+        return 0;
+
+    return static_cast<double>( sum ) / count;
+}
+
+Histogram::Histogram():
+        count_( 0 ),
+        sum_( 0 ),
+        max_( 0 )
+{
+    for( auto & e : buckets_ )
+        e.store( 0, std::memory_order_relaxed );
+}
+
+void Histogram::add( uint64_t value )
+{
+    increment( buckets_[ get_bucket( value ) ], 1 );
+    increment( count_, 1 );
+    increment( sum_, value );
+
+    if( value > max_.load( std::memory_order_relaxed ) )
+        max_.store( value, std::memory_order_relaxed );
+}
+
+void Histogram::merge( const Histogram & other )
+{
+    for( unsigned i = 0; i < NUM_BUCKETS; ++i )
+        increment( buckets_[ i ], other.buckets_[ i ].load( std::memory_order_relaxed ) );
+
+    increment( count_, other.count_.load( std::memory_order_relaxed ) );
+    increment( sum_, other.sum_.load( std::memory_order_relaxed ) );
+
+    auto max = other.max_.load( std::memory_order_relaxed );
+
+    if( max > max_.load( std::memory_order_relaxed ) )
+        max_.store( max, std::memory_order_relaxed );
+}
+
+void Histogram::merge_into( HistogramSnapshot * res ) const
+{
+    for( unsigned i = 0; i < NUM_BUCKETS; ++i )
+        res->buckets[ i ] += buckets_[ i ].load( std::memory_order_relaxed );
+
+    res->count  += count_.load( std::memory_order_relaxed );
+    res->sum    += sum_.load( std::memory_order_relaxed );
+    res->max    = std::max( res->max, max_.load( std::memory_order_relaxed ) );
+}
+
+unsigned Histogram::get_bucket( uint64_t value )
+{
+    if( value < ( 1u << SUB_BUCKET_BITS ) )
+        return static_cast<unsigned>( value );
+
+    if( value >> MAX_VALUE_BITS )
+        return NUM_BUCKETS - 1;
+
+    unsigned msb    = 63 - __builtin_clzll( value );
+    unsigned shift  = msb - SUB_BUCKET_BITS;
+    unsigned sub    = static_cast<unsigned>( value >> shift ) & ( ( 1u << SUB_BUCKET_BITS ) - 1 );
+
+    return ( ( shift + 1 ) << SUB_BUCKET_BITS ) + sub;
+}
+
+uint64_t Histogram::get_lower_bound( unsigned bucket )
+{
+    if( bucket < ( 1u << SUB_BUCKET_BITS ) )
+        return bucket;
+
+    unsigned shift  = ( bucket >> SUB_BUCKET_BITS ) - 1;
+    unsigned sub    = bucket & ( ( 1u << SUB_BUCKET_BITS ) - 1 );
+
+    return static_cast<uint64_t>( ( 1u << SUB_BUCKET_BITS ) + sub ) << shift;
+}
+
+uint64_t Histogram::get_upper_bound( unsigned bucket )
+{
+    if( bucket < ( 1u << SUB_BUCKET_BITS ) )
+        return bucket;
+
+    unsigned shift  = ( bucket >> SUB_BUCKET_BITS ) - 1;
+
+    return get_lower_bound( bucket ) + ( ( uint64_t( 1 ) << shift ) - 1 );
+}
+
+MetricsSnapshot::MetricsSnapshot():
+        rows_scanned( 0 ),
+        rows_returned( 0 )
+{
+}
+
+Metrics::Shard::Shard():
+        rows_scanned( 0 ),
+        rows_returned( 0 )
+{
+}
+
+void Metrics::Shard::merge( const Shard & other )
+{
+    for( unsigned i = 0; i < NUM_OPERATIONS; ++i )
+        operations[ i ].merge( other.operations[ i ] );
+
+    lock_wait.merge( other.lock_wait );
+
+    increment( rows_scanned, other.rows_scanned.load( std::memory_order_relaxed ) );
+    increment( rows_returned, other.rows_returned.load( std::memory_order_relaxed ) );
+}
+
+/**
+ * @brief Shards of the current thread by id of the metrics. Ids are never reused, entries of destroyed metrics
+ *        are pruned when the map grows, the shards of live ones are retired when the thread exits.
+ */
+class MetricsThreadShards
+{
+public:
+
+    ~MetricsThreadShards()
+    {
+        for( auto & e : map_id_to_entry_ )
+        {
+            auto shards = e.second.shards.lock();
+
+            if( shards )
+                Metrics::retire( shards.get(), e.second.shard );
+        }
+    }
+
+    Metrics::Shard * find( uint64_t id ) const
+    {
+        auto it = map_id_to_entry_.find( id );
+
+        if( it == map_id_to_entry_.end() )
+            return nullptr;
+
+        return it->second.shard;
+    }
+
+    void add( uint64_t id, const std::shared_ptr<Metrics::Shards> & shards, Metrics::Shard * shard )
+    {
+        if( map_id_to_entry_.size() >= prune_size_ )
+        {
+            for( auto it = map_id_to_entry_.begin(); it != map_id_to_entry_.end(); )
+            {
+                if( it->second.shards.expired() )
+                    it = map_id_to_entry_.erase( it );
+                else
+                    ++it;
+            }
+
+            prune_size_ = std::max( MIN_PRUNE_SIZE, 2 * map_id_to_entry_.size() );
+        }
+
+        map_id_to_entry_[ id ] = Entry { shards, shard };
+    }
+
+private:
+
+    struct Entry
+    {
+        std::weak_ptr<Metrics::Shards>  shards;
+        Metrics::Shard                  * shard;
+    };
+
+    std::unordered_map<uint64_t,Entry>  map_id_to_entry_;
+    std::size_t                         prune_size_ = MIN_PRUNE_SIZE;
+};
+
+Metrics::Metrics():
+        id_( next_metrics_id++ ),
+        shards_( std::make_shared<Shards>() )
+{
+}
+
+Metrics::Shard & Metrics::get_shard() const
+{
+    thread_local uint64_t   last_id     = 0;
+    thread_local Shard      * last_shard = nullptr;
+
+    thread_local MetricsThreadShards    thread_shards;
+
+    if( last_id == id_ )
+        return * last_shard;
+
+    auto shard = thread_shards.find( id_ );
+
+    if( shard == nullptr )
+    {
+        {
+            MUTEX_SCOPE_LOCK( shards_->mutex );
+
+            shards_->active.emplace_back( new Shard );
+
+            shard = shards_->active.back().get();
+        }
+
+        thread_shards.add( id_, shards_, shard );
+    }
+
+    last_id     = id_;
+    last_shard  = shard;
+
+    return * shard;
+}
+
+void Metrics::retire( Shards * shards, Shard * shard )
+{
+    MUTEX_SCOPE_LOCK( shards->mutex );
+
+    shards->retired.merge( * shard );
+
+    auto & active = shards->active;
+
+    for( auto it = active.begin(); it != active.end(); ++it )
+    {
+        if( it->get() == shard )
+        {
+            active.erase( it );
+            break;
+        }
+    }
+}
+
+void Metrics::add_latency( operation_e op, uint64_t ns ) const
+{
+    get_shard().operations[ static_cast<unsigned>( op ) ].add( ns );
+}
+
+void Metrics::add_lock_wait( uint64_t ns ) const
+{
+    get_shard().lock_wait.add( ns );
+}
+
+void Metrics::add_rows( uint64_t scanned, uint64_t returned ) const
+{
+    auto & shard = get_shard();
+
+    increment( shard.rows_scanned, scanned );
+    increment( shard.rows_returned, returned );
+}
+
+MetricsSnapshot Metrics::get_snapshot() const
+{
+    MetricsSnapshot res;
+
+    MUTEX_SCOPE_LOCK( shards_->mutex );
+
+    auto merge_into = [&res]( const Shard & s )
+            {
+                for( unsigned i = 0; i < NUM_OPERATIONS; ++i )
+                    s.operations[ i ].merge_into( & res.operations[ i ] );
+
+                s.lock_wait.merge_into( & res.lock_wait );
+
+                res.rows_scanned    += s.rows_scanned.load( std::memory_order_relaxed );
+                res.rows_returned   += s.rows_returned.load( std::memory_order_relaxed );
+            };
+
+    merge_into( shards_->retired );
+
+    for( auto & s : shards_->active )
+        merge_into( * s );
+
+    return res;
+}
+
+uint64_t Metrics::get_memory_size() const
+{
+    MUTEX_SCOPE_LOCK( shards_->mutex );
+
+    return sizeof( Shards ) + shards_->active.size() * sizeof( Shard );
+}
+
+MetricsScope::MetricsScope( const Metrics & metrics, operation_e op ):
+        metrics_( metrics ),
+        op_( op ),
+        start_( std::chrono::steady_clock::now() )
+{
+}
+
+MetricsScope::~MetricsScope()
+{
+    metrics_.add_latency( op_, get_ns_since( start_ ) );
+}
+
+MetricsScopeLock::MetricsScopeLock( std::mutex & mutex, const Metrics & metrics ):
+        mutex_( mutex )
+{
+    // the clock is read only if the mutex is contended
+
+    if( mutex_.try_lock() )
+    {
+        metrics.add_lock_wait( 0 );
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    mutex_.lock();
+
+    metrics.add_lock_wait( get_ns_since( start ) );
+}
+
+MetricsScopeLock::~MetricsScopeLock()
+{
+    mutex_.unlock();
+}
+
+} // namespace anyvalue_db
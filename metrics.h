@@ -0,0 +1,233 @@
+/*
+
+Metrics. Operation counters and latency histograms.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__METRICS_H
+#define ANYVALUE_DB__METRICS_H
+
+#include <cstdint>          // uint64_t
+#include <atomic>           // std::atomic
+#include <mutex>            // std::mutex
+#include <memory>           // std::unique_ptr, std::shared_ptr
+#include <vector>           // std::vector
+#include <chrono>           // std::chrono
+
+#include "utils/mutex_helper.h"     // MUTEX_SCOPE_LOCK
+
+namespace anyvalue_db
+{
+
+enum class operation_e
+{
+    FIND,
+    SELECT,
+    ADD_RECORD,
+    DELETE_RECORD,
+    SAVE,
+    LOAD,
+    FIND_TABLE,
+    JOIN,
+};
+
+const unsigned NUM_OPERATIONS = static_cast<unsigned>( operation_e::JOIN ) + 1;
+
+const char* to_string( operation_e op );
+
+struct HistogramSnapshot
+{
+    uint64_t                count;
+    uint64_t                sum;
+    uint64_t                max;
+    std::vector<uint64_t>   buckets;    // see Histogram for bucket bounds
+
+    HistogramSnapshot();
+
+    /**
+     * @brief returns upper bound of the bucket holding the given percentile (0..100), 0 if empty
+     */
+    uint64_t get_percentile( double percentile ) const;
+
+    double get_mean() const;
+};
+
+/**
+ * @brief Log-linear histogram: every power of two is split into 2^SUB_BUCKET_BITS buckets,
+ *        so a value is known with 1/2^SUB_BUCKET_BITS relative precision. Values below 2^SUB_BUCKET_BITS are exact,
+ *        values from 2^MAX_VALUE_BITS on (about 18 minutes in nanoseconds) are counted in the last bucket.
+ *
+ * Has a single writer, the readers may run concurrently with it.
+ */
+class Histogram
+{
+public:
+
+    static const unsigned SUB_BUCKET_BITS   = 3;
+    static const unsigned MAX_VALUE_BITS    = 40;
+    static const unsigned NUM_BUCKETS       = ( MAX_VALUE_BITS - SUB_BUCKET_BITS + 1 ) << SUB_BUCKET_BITS;
+
+public:
+
+    Histogram();
+
+    void add( uint64_t value );
+
+    /**
+     * @brief adds the counters of the other histogram, the caller is the single writer of this one
+     */
+    void merge( const Histogram & other );
+
+    void merge_into( HistogramSnapshot * res ) const;
+
+    static unsigned get_bucket( uint64_t value );
+    static uint64_t get_lower_bound( unsigned bucket );
+    static uint64_t get_upper_bound( unsigned bucket );     // inclusive
+
+private:
+
+    std::atomic<uint64_t>   buckets_[ NUM_BUCKETS ];
+    std::atomic<uint64_t>   count_;
+    std::atomic<uint64_t>   sum_;
+    std::atomic<uint64_t>   max_;
+};
+
+struct MetricsSnapshot
+{
+    HistogramSnapshot   operations[ NUM_OPERATIONS ];   // latency in nanoseconds
+    HistogramSnapshot   lock_wait;                      // nanoseconds
+    uint64_t            rows_scanned;
+    uint64_t            rows_returned;
+
+    MetricsSnapshot();
+};
+
+class MetricsThreadShards;
+
+/**
+ * @brief Every thread writes into its own shard, so no synchronization is needed on the hot path;
+ *        a snapshot merges all shards.
+ *
+ * When a thread exits, its shard is folded into a single shard of retired threads and freed.
+ *
+ * Defining ANYVALUE_DB__NO_METRICS turns the instrumentation macros below into no-ops.
+ */
+class Metrics
+{
+    friend class MetricsThreadShards;
+
+public:
+
+    Metrics();
+
+    void add_latency( operation_e op, uint64_t ns ) const;
+    void add_lock_wait( uint64_t ns ) const;
+    void add_rows( uint64_t scanned, uint64_t returned ) const;
+
+    MetricsSnapshot get_snapshot() const;
+
+    /**
+     * @brief memory held by the shards
+     */
+    uint64_t get_memory_size() const;
+
+private:
+
+    struct Shard
+    {
+        Histogram               operations[ NUM_OPERATIONS ];
+        Histogram               lock_wait;
+        std::atomic<uint64_t>   rows_scanned;
+        std::atomic<uint64_t>   rows_returned;
+
+        Shard();
+
+        void merge( const Shard & other );
+    };
+
+    // shared with the threads, so that a thread exiting after the metrics are destroyed doesn't touch freed memory
+
+    struct Shards
+    {
+        std::mutex                          mutex;
+        std::vector<std::unique_ptr<Shard>> active;
+        Shard                               retired;    // counters of the exited threads
+    };
+
+    Shard & get_shard() const;
+
+    static void retire( Shards * shards, Shard * shard );
+
+private:
+
+    uint64_t                    id_;        // unique for the process, identifies the shards of the instance in the threads
+
+    std::shared_ptr<Shards>     shards_;
+};
+
+class MetricsScope
+{
+public:
+
+    MetricsScope( const Metrics & metrics, operation_e op );
+    ~MetricsScope();
+
+private:
+
+    const Metrics                           & metrics_;
+    operation_e                             op_;
+    std::chrono::steady_clock::time_point   start_;
+};
+
+/**
+ * @brief locks the mutex for the scope and records the time spent waiting for it
+ */
+class MetricsScopeLock
+{
+public:
+
+    MetricsScopeLock( std::mutex & mutex, const Metrics & metrics );
+    ~MetricsScopeLock();
+
+private:
+
+    std::mutex  & mutex_;
+};
+
+} // namespace anyvalue_db
+
+#define METRICS_CAT2( _a, _b )      _a##_b
+#define METRICS_CAT( _a, _b )       METRICS_CAT2( _a, _b )
+
+#ifndef ANYVALUE_DB__NO_METRICS
+
+#define METRICS_SCOPE( _metrics, _op )                      anyvalue_db::MetricsScope METRICS_CAT( metrics_scope_, __LINE__ )( _metrics, _op )
+#define METRICS_SCOPE_LOCK( _mutex, _metrics )              anyvalue_db::MetricsScopeLock METRICS_CAT( metrics_lock_, __LINE__ )( _mutex, _metrics )
+#define METRICS_ADD_ROWS( _metrics, _scanned, _returned )   ( _metrics ).add_rows( _scanned, _returned )
+
+#else
+
+#define METRICS_SCOPE( _metrics, _op )
+#define METRICS_SCOPE_LOCK( _mutex, _metrics )              MUTEX_SCOPE_LOCK( _mutex )
+#define METRICS_ADD_ROWS( _metrics, _scanned, _returned )
+
+#endif // ANYVALUE_DB__NO_METRICS
+
+#endif // ANYVALUE_DB__METRICS_H
@@ -0,0 +1,67 @@
+/*
+
+Parallel Helper.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__PARALLEL_HELPER_H
+#define ANYVALUE_DB__PARALLEL_HELPER_H
+
+#include <thread>           // std::thread
+#include <vector>           // std::vector
+#include <algorithm>        // std::min
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief calls func( i ) for i in [0, n) using up to hardware_concurrency threads
+ */
+template<class F>
+void run_parallel( std::size_t n, F func )
+{
+    std::size_t num_threads = std::min<std::size_t>( n, std::max( 1U, std::thread::hardware_concurrency() ) );
+
+    if( num_threads <= 1 )
+    {
+        for( std::size_t i = 0; i < n; ++i )
+            func( i );
+
+        return;
+    }
+
+    std::vector<std::thread> threads;
+
+    for( std::size_t t = 0; t < num_threads; ++t )
+    {
+        threads.push_back( std::thread( [&func, t, n, num_threads]()
+                {
+                    for( std::size_t i = t; i < n; i += num_threads )
+                        func( i );
+                } ) );
+    }
+
+    for( auto & th : threads )
+        th.join();
+}
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__PARALLEL_HELPER_H
@@ -0,0 +1,125 @@
+/*
+
+Query log. Slow queries and statistics per query shape.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "query_log.h"      // self
+
+#include "utils/mutex_helper.h"     // MUTEX_SCOPE_LOCK
+
+namespace anyvalue_db
+{
+
+QueryLog::QueryLog():
+        is_enabled_( false ),
+        threshold_us_( 0 ),
+        max_entries_( 0 )
+{
+}
+
+void QueryLog::enable( uint32_t threshold_us, std::size_t max_entries )
+{
+    MUTEX_SCOPE_LOCK( mutex_ );
+
+    threshold_us_   = threshold_us;
+    max_entries_    = max_entries;
+
+    while( slow_queries_.size() > max_entries_ )
+        slow_queries_.pop_front();
+
+    is_enabled_     = true;
+}
+
+void QueryLog::disable()
+{
+    MUTEX_SCOPE_LOCK( mutex_ );
+
+    is_enabled_     = false;
+
+    slow_queries_.clear();
+    map_shape_to_stats_.clear();
+}
+
+bool QueryLog::is_enabled() const
+{
+    return is_enabled_.load( std::memory_order_relaxed );
+}
+
+bool QueryLog::add( QueryInfo && info )
+{
+    MUTEX_SCOPE_LOCK( mutex_ );
+
+    auto is_slow = info.elapsed_us >= threshold_us_;
+
+    auto it = map_shape_to_stats_.find( info.shape );
+
+    if( it == map_shape_to_stats_.end() )
+    {
+        QueryShapeStats stats = { info.shape, info.access_path, 0, 0, 0, 0, 0, 0 };
+
+        it = map_shape_to_stats_.insert( std::make_pair( info.shape, stats ) ).first;
+    }
+
+    auto & stats = it->second;
+
+    stats.access_path   = info.access_path;
+    stats.count         += 1;
+    stats.num_slow      += is_slow ? 1 : 0;
+    stats.rows_scanned  += info.rows_scanned;
+    stats.rows_matched  += info.rows_matched;
+    stats.total_us      += info.elapsed_us;
+
+    if( info.elapsed_us > stats.max_us )
+        stats.max_us    = info.elapsed_us;
+
+    if( is_slow && max_entries_ > 0 )
+    {
+        if( slow_queries_.size() == max_entries_ )
+            slow_queries_.pop_front();
+
+        slow_queries_.push_back( std::move( info ) );
+    }
+
+    return is_slow;
+}
+
+std::vector<QueryInfo> QueryLog::get_slow_queries() const
+{
+    MUTEX_SCOPE_LOCK( mutex_ );
+
+    return std::vector<QueryInfo>( slow_queries_.begin(), slow_queries_.end() );
+}
+
+std::vector<QueryShapeStats> QueryLog::get_shape_stats() const
+{
+    MUTEX_SCOPE_LOCK( mutex_ );
+
+    std::vector<QueryShapeStats> res;
+
+    res.reserve( map_shape_to_stats_.size() );
+
+    for( auto & e : map_shape_to_stats_ )
+        res.push_back( e.second );
+
+    return res;
+}
+
+} // namespace anyvalue_db
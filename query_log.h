@@ -0,0 +1,105 @@
+/*
+
+Query log. Slow queries and statistics per query shape.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__QUERY_LOG_H
+#define ANYVALUE_DB__QUERY_LOG_H
+
+#include <cstdint>          // uint64_t
+#include <string>           // std::string
+#include <vector>           // std::vector
+#include <deque>            // std::deque
+#include <map>              // std::map
+#include <mutex>            // std::mutex
+#include <atomic>           // std::atomic
+#include <chrono>           // std::chrono
+
+#include "query_plan.h"     // access_path_e
+
+namespace anyvalue_db
+{
+
+struct QueryInfo
+{
+    std::string     shape;          // conditions without values, e.g. "4 EQ ? AND 10 LT ?"
+    std::string     description;    // conditions with values
+    access_path_e   access_path;
+    uint64_t        rows_scanned;
+    uint64_t        rows_matched;
+    uint64_t        elapsed_us;
+    std::chrono::system_clock::time_point   time;
+};
+
+struct QueryShapeStats
+{
+    std::string     shape;
+    access_path_e   access_path;    // of the last query
+    uint64_t        count;
+    uint64_t        num_slow;
+    uint64_t        rows_scanned;
+    uint64_t        rows_matched;
+    uint64_t        total_us;
+    uint64_t        max_us;
+};
+
+/**
+ * @brief Keeps the last slow queries and aggregates all queries by shape. Off by default.
+ */
+class QueryLog
+{
+public:
+
+    QueryLog();
+
+    /**
+     * @param threshold_us  queries taking at least that long are kept, 0 keeps all
+     * @param max_entries   number of kept slow queries, older ones are dropped
+     */
+    void enable( uint32_t threshold_us, std::size_t max_entries );
+    void disable();
+
+    bool is_enabled() const;
+
+    /**
+     * @brief returns true, if the query was slow
+     */
+    bool add( QueryInfo && info );
+
+    std::vector<QueryInfo> get_slow_queries() const;
+    std::vector<QueryShapeStats> get_shape_stats() const;
+
+private:
+
+    std::atomic<bool>           is_enabled_;
+
+    mutable std::mutex          mutex_;
+
+    uint32_t                    threshold_us_;
+    std::size_t                 max_entries_;
+
+    std::deque<QueryInfo>       slow_queries_;
+    std::map<std::string,QueryShapeStats>   map_shape_to_stats_;
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__QUERY_LOG_H
@@ -0,0 +1,140 @@
+/*
+
+Query plan.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "query_plan.h"     // self
+
+#include <sstream>          // std::ostringstream
+
+#include "anyvalue/op_less.h"       // operator<
+#include "anyvalue/str_helper.h"    // anyvalue::StrHelper
+
+namespace anyvalue_db
+{
+
+const char* to_string( access_path_e path )
+{
+    switch( path )
+    {
+    case access_path_e::SCAN:       return "scan";
+    case access_path_e::INDEX:      return "index";
+    case access_path_e::COLUMNAR:   return "columnar";
+    }
+
+    return "unknown";
+}
+
+const char* to_string( anyvalue::comparison_type_e op )
+{
+    switch( op )
+    {
+    case anyvalue::comparison_type_e::EQ:   return "EQ";
+    case anyvalue::comparison_type_e::NEQ:  return "NEQ";
+    case anyvalue::comparison_type_e::LT:   return "LT";
+    case anyvalue::comparison_type_e::LE:   return "LE";
+    case anyvalue::comparison_type_e::GT:   return "GT";
+    case anyvalue::comparison_type_e::GE:   return "GE";
+    }
+
+    return "?";
+}
+
+QueryPlan::QueryPlan():
+        is_or( false ),
+        access_path( access_path_e::SCAN ),
+        index_field_id( 0 ),
+        lower_bound( { false, false, Value() } ),
+        upper_bound( { false, false, Value() } ),
+        is_index_order( false ),
+        is_top_k( false ),
+        cost( 0 ),
+        estimated_rows_scanned( 0 ),
+        estimated_rows_matched( 0 ),
+        rows_scanned( 0 ),
+        rows_matched( 0 )
+{
+}
+
+bool QueryPlan::is_empty_range() const
+{
+    if( lower_bound.is_set == false || upper_bound.is_set == false )
+        return false;
+
+    if( upper_bound.value < lower_bound.value )
+        return true;
+
+    if( lower_bound.value < upper_bound.value )
+        return false;
+
+    return lower_bound.is_inclusive == false || upper_bound.is_inclusive == false;
+}
+
+std::string to_string( const QueryPlan & plan )
+{
+    std::ostringstream os;
+
+    os << to_string( plan.access_path );
+
+    if( plan.access_path == access_path_e::INDEX )
+    {
+        os << " on " << plan.index_field_id << " ";
+
+        if( plan.lower_bound.is_set )
+            os << ( plan.lower_bound.is_inclusive ? "[" : "(" ) << anyvalue::StrHelper::to_string( plan.lower_bound.value );
+        else
+            os << "(-inf";
+
+        os << ", ";
+
+        if( plan.upper_bound.is_set )
+            os << anyvalue::StrHelper::to_string( plan.upper_bound.value ) << ( plan.upper_bound.is_inclusive ? "]" : ")" );
+        else
+            os << "+inf)";
+    }
+
+    if( plan.is_index_order )
+        os << ", index order";
+
+    if( plan.is_top_k )
+        os << ", top-k";
+
+    os << ", cost " << plan.cost
+            << ", estimated " << plan.estimated_rows_scanned << " scanned " << plan.estimated_rows_matched << " matched"
+            << ", actual " << plan.rows_scanned << " scanned " << plan.rows_matched << " matched"
+            << ", conditions:";
+
+    bool is_first = true;
+
+    for( auto & e : plan.conditions )
+    {
+        if( is_first == false )
+            os << ( plan.is_or ? " OR" : " AND" );
+
+        is_first = false;
+
+        os << " " << e.field_id << " " << to_string( e.op ) << " " << anyvalue::StrHelper::to_string( e.value ) << " (" << e.selectivity << ")";
+    }
+
+    return os.str();
+}
+
+} // namespace anyvalue_db
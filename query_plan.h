@@ -0,0 +1,95 @@
+/*
+
+Query plan.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__QUERY_PLAN_H
+#define ANYVALUE_DB__QUERY_PLAN_H
+
+#include <cstdint>          // uint64_t
+#include <vector>           // std::vector
+#include <string>           // std::string
+
+#include "types.h"          // field_id_t
+#include "value.h"          // Value
+
+#include "anyvalue/operations.h"    // anyvalue::comparison_type_e
+
+namespace anyvalue_db
+{
+
+enum class access_path_e
+{
+    SCAN,
+    INDEX,
+    COLUMNAR,
+};
+
+const char* to_string( access_path_e path );
+const char* to_string( anyvalue::comparison_type_e op );
+
+/**
+ * @brief Access path chosen for a select, the estimations it was chosen by and the actual outcome.
+ */
+struct QueryPlan
+{
+    struct Condition
+    {
+        field_id_t                  field_id;
+        anyvalue::comparison_type_e op;
+        Value                       value;
+        double                      selectivity;    // estimated share of records matching the condition
+    };
+
+    struct Bound
+    {
+        bool        is_set;
+        bool        is_inclusive;
+        Value       value;
+    };
+
+    bool                    is_or;
+    access_path_e           access_path;
+    field_id_t              index_field_id;         // for INDEX only
+    Bound                   lower_bound;            // for INDEX only
+    Bound                   upper_bound;            // for INDEX only
+    bool                    is_index_order;         // records come in the order of the index, so they are not sorted
+    bool                    is_top_k;               // only the first offset + limit records are kept while sorting
+    double                  cost;
+    double                  estimated_rows_scanned;
+    double                  estimated_rows_matched;
+    uint64_t                rows_scanned;           // actual, filled in by Table::explain()
+    uint64_t                rows_matched;           // actual, filled in by Table::explain()
+    std::vector<Condition>  conditions;             // in the order they are evaluated for each candidate record
+
+    QueryPlan();
+
+    /**
+     * @brief true, if the index key range is known to be empty
+     */
+    bool is_empty_range() const;
+};
+
+std::string to_string( const QueryPlan & plan );
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__QUERY_PLAN_H
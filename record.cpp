@@ -24,20 +24,61 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 #include "record.h"     // self
 
 #include <cassert>
+#include <algorithm>        // std::lower_bound
 
 namespace anyvalue_db
 {
 
+namespace
+{
+
+struct LessFieldId
+{
+    bool operator()( const Record::Field & lhs, field_id_t rhs ) const
+    {
+        return lhs.first < rhs;
+    }
+};
+
+} // namespace
+
 Record::Record():
-        parent_( nullptr )
+        parent_( nullptr ),
+        dictionaries_( nullptr ),
+        slot_( RecordHandle::INVALID_SLOT ),
+        is_spilled_( false )
 {
 }
 
 Record::Record( ITable * parent ):
-        parent_( parent )
+        parent_( parent ),
+        dictionaries_( nullptr ),
+        slot_( RecordHandle::INVALID_SLOT ),
+        is_spilled_( false )
 {
 }
 
+Record::Record( ITable * parent, Arena * arena ):
+        fields_( Allocator( arena ) ),
+        parent_( parent ),
+        dictionaries_( nullptr ),
+        slot_( RecordHandle::INVALID_SLOT ),
+        is_spilled_( false )
+{
+}
+
+Record::Record( std::initializer_list<Field> fields ):
+        parent_( nullptr ),
+        dictionaries_( nullptr ),
+        slot_( RecordHandle::INVALID_SLOT ),
+        is_spilled_( false )
+{
+    fields_.reserve( fields.size() );
+
+    for( auto & e : fields )
+        emplace_field( e.first, Value( e.second ) );
+}
+
 Record::~Record()
 {
 }
@@ -50,19 +91,122 @@ void Record::set_parent( ITable * parent )
     parent_ = parent;
 }
 
+void Record::set_dictionaries( MapFieldIdToDictionary * dictionaries )
+{
+    assert( dictionaries_ == nullptr );
+
+    dictionaries_   = dictionaries;
+
+    encode_fields();
+}
+
+void Record::encode_fields()
+{
+    if( dictionaries_ == nullptr || dictionaries_->empty() )
+        return;
+
+    for( auto & e : fields_ )
+    {
+        auto dict = find_dictionary( e.first );
+
+        if( dict )
+            e.second = Value( dict->encode( e.second ) );
+    }
+}
+
+Dictionary* Record::find_dictionary( field_id_t field_id ) const
+{
+    if( dictionaries_ == nullptr || dictionaries_->empty() )
+        return nullptr;
+
+    auto it = dictionaries_->find( field_id );
+
+    if( it == dictionaries_->end() )
+        return nullptr;
+
+    return & it->second;
+}
+
+const Value & Record::decode( field_id_t field_id, const Value & stored ) const
+{
+    auto dict = find_dictionary( field_id );
+
+    if( dict == nullptr )
+        return stored;
+
+    return dict->decode( stored.get_int() );
+}
+
+void Record::load_if_spilled() const
+{
+    if( is_spilled_ )
+        parent_->on_load_spilled( const_cast<Record*>( this ) );
+}
+
+Record::VectorField::iterator Record::lower_bound( field_id_t field_id )
+{
+    return std::lower_bound( fields_.begin(), fields_.end(), field_id, LessFieldId() );
+}
+
+Record::VectorField::const_iterator Record::find_field( field_id_t field_id ) const
+{
+    auto it = std::lower_bound( fields_.begin(), fields_.end(), field_id, LessFieldId() );
+
+    if( it == fields_.end() || it->first != field_id )
+        return fields_.end();
+
+    return it;
+}
+
+bool Record::emplace_field( field_id_t field_id, Value && value )
+{
+    // fields mostly come in order, so they are just appended
+
+    if( fields_.empty() || fields_.back().first < field_id )
+    {
+        fields_.emplace_back( field_id, std::move( value ) );
+        return true;
+    }
+
+    auto it = lower_bound( field_id );
+
+    if( it->first == field_id )
+        return false;
+
+    fields_.emplace( it, field_id, std::move( value ) );
+
+    return true;
+}
+
+const Value * Record::get_stored_field( field_id_t field_id ) const
+{
+    load_if_spilled();
+
+    auto it = find_field( field_id );
+
+    if( it == fields_.end() )
+        return nullptr;
+
+    return & it->second;
+}
+
 bool Record::has_field( field_id_t field_id ) const
 {
-    return map_id_to_value_.count( field_id ) > 0;
+    load_if_spilled();
+
+    return find_field( field_id ) != fields_.end();
 }
 
 bool Record::get_field( field_id_t field_id, Value * res ) const
 {
-    auto it = map_id_to_value_.find( field_id );
+    load_if_spilled();
+
+    auto it = find_field( field_id );
 
-    if( it == map_id_to_value_.end() )
+    if( it == fields_.end() )
         return false;
 
-    * res = it->second;
+    * res = decode( field_id, it->second );
 
     return true;
 }
@@ -71,17 +215,28 @@ const Value & Record::get_field( field_id_t field_id ) const
 {
     static const Value empty( 0 );
 
-    auto it = map_id_to_value_.find( field_id );
+    load_if_spilled();
+
+    auto it = find_field( field_id );
 
-    if( it == map_id_to_value_.end() )
+    if( it == fields_.end() )
         return empty;
 
-    return it->second;
+    return decode( field_id, it->second );
 }
 
 bool Record::add_field( field_id_t field_id, const Value & value )
 {
-    if( map_id_to_value_.count( field_id ) > 0 )
+    return add_field( field_id, Value( value ) );
+}
+
+bool Record::add_field( field_id_t field_id, Value && value )
+{
+    load_if_spilled();
+
+    auto it = lower_bound( field_id );
+
+    if( it != fields_.end() && it->first == field_id )
         return false;       // field already exists, cannot insert again
 
     if( parent_ )
@@ -90,43 +245,63 @@ bool Record::add_field( field_id_t field_id, const Value & value )
             return false;
     }
 
-    auto b = map_id_to_value_.insert( std::make_pair( field_id, value ) ).second;
+    auto dict = find_dictionary( field_id );
 
-    assert( b );
+    if( dict )
+        value = Value( dict->encode( value ) );
+
+    fields_.emplace( it, field_id, std::move( value ) );
 
     return true;
 }
 
 bool Record::update_field( field_id_t field_id, const Value & value )
 {
-    auto it = map_id_to_value_.find( field_id );
+    return update_field( field_id, Value( value ) );
+}
+
+bool Record::update_field( field_id_t field_id, Value && value )
+{
+    load_if_spilled();
+
+    auto it = lower_bound( field_id );
 
-    if( it == map_id_to_value_.end() )
+    if( it == fields_.end() || it->first != field_id )
         return false;       // field doesn't exist, cannot update non-existing field
 
     if( parent_ )
     {
-        if( parent_->on_update_field( field_id, it->second, value, this ) == false )   // key already exists
+        if( parent_->on_update_field( field_id, decode( field_id, it->second ), value, this ) == false )   // key already exists
             return false;
     }
 
-    it->second  = value;
+    auto dict = find_dictionary( field_id );
+
+    if( dict )
+        value = Value( dict->encode( value ) );
+
+    it->second  = std::move( value );
 
     return true;
 }
 
 bool Record::delete_field( field_id_t field_id )
 {
-    auto it = map_id_to_value_.find( field_id );
+    load_if_spilled();
+
+    auto it = lower_bound( field_id );
 
-    if( it == map_id_to_value_.end() )
+    if( it == fields_.end() || it->first != field_id )
         return false;       // field doesn't exist, cannot delete non-existing field
 
     if( parent_ )
     {
-        parent_->on_delete_field( field_id, it->second );
+        if( parent_->on_delete_field( field_id, decode( field_id, it->second ), this ) == false )    // field is mandatory
+            return false;
     }
 
+    fields_.erase( it );
+
     return true;
 }
 
@@ -24,8 +24,12 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 #ifndef ANYVALUE_DB__RECORD_H
 #define ANYVALUE_DB__RECORD_H
 
-#include <map>              // std::map
+#include <vector>           // std::vector
+#include <initializer_list> // std::initializer_list
 #include "i_table.h"        // ITable
+#include "arena.h"          // ArenaAllocator
+#include "dictionary.h"     // MapFieldIdToDictionary
+#include "typed_value.h"    // TypeTraits
 
 namespace anyvalue_db
 {
@@ -36,9 +40,19 @@ struct Record
 {
     friend class StrHelper;
     friend class Serializer;
+    friend class Table;
+    friend class Schema;
 
     Record(); // for serializer
     Record( ITable * parent );
+    Record( ITable * parent, Arena * arena );    // field storage is allocated from the arena
+
+    typedef std::pair<field_id_t,Value>     Field;
+
+    /**
+     * @brief record with the given fields, if a field id is repeated, the first one is taken
+     */
+    Record( std::initializer_list<Field> fields );
 
     ~Record();
 
@@ -46,20 +60,77 @@ struct Record
 
     bool has_field( field_id_t field_id ) const;
     bool get_field( field_id_t field_id, Value * res ) const;
+
+    /**
+     * @brief the reference is valid until the next modification of the record; if the table has a memory budget,
+     *        only until the next find, select or create on the table, which may spill the record, use the copying
+     *        get_field() to keep the value longer
+     */
     const Value & get_field( field_id_t field_id ) const;
     bool add_field( field_id_t field_id, const Value & value );
+    bool add_field( field_id_t field_id, Value && value );
     bool update_field( field_id_t field_id, const Value & value );
+    bool update_field( field_id_t field_id, Value && value );
     bool delete_field( field_id_t field_id );
 
+    /**
+     * @brief returns false, if the field is missing or has a different type
+     */
+    template<class T>
+    bool get_field_as( field_id_t field_id, T * res ) const
+    {
+        auto v = get_stored_field( field_id );
+
+        if( v == nullptr )
+            return false;
+
+        auto & d = decode( field_id, * v );
+
+        if( d.get_type() != TypeTraits<T>::TYPE )
+            return false;
+
+        * res = TypeTraits<T>::get( d );
+
+        return true;
+    }
+
 private:
 
-    typedef std::map<field_id_t,Value> MapIdToValue;
+    // fields having a dictionary hold the code of the value instead of the value itself
+
+    void set_dictionaries( MapFieldIdToDictionary * dictionaries );
+    Dictionary* find_dictionary( field_id_t field_id ) const;
+    const Value & decode( field_id_t field_id, const Value & stored ) const;
+    const Value * get_stored_field( field_id_t field_id ) const;
+    void encode_fields();
+
+    bool emplace_field( field_id_t field_id, Value && value );
+
+    // a spilled record has no fields in memory, any access loads them back
+
+    void load_if_spilled() const;
+
+private:
+
+    // fields are kept sorted by id in a single buffer, short strings and scalars are stored inline by Value itself
+
+    typedef ArenaAllocator<Field>               Allocator;
+    typedef std::vector<Field,Allocator>        VectorField;
+
+    VectorField::iterator lower_bound( field_id_t field_id );
+    VectorField::const_iterator find_field( field_id_t field_id ) const;
 
 private:
 
-    MapIdToValue    map_id_to_value_;
+    VectorField     fields_;
 
     ITable          * parent_;
+
+    MapFieldIdToDictionary  * dictionaries_;    // dictionaries of the parent table, nullptr if not in a table
+
+    uint32_t        slot_;      // position in the table, RecordHandle::INVALID_SLOT if not in a table
+
+    bool            is_spilled_;
 };
 
 } // namespace anyvalue_db
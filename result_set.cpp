@@ -0,0 +1,115 @@
+/*
+
+Result set.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "result_set.h"     // self
+
+#include <cassert>          // assert
+
+#include "record.h"         // Record
+
+namespace anyvalue_db
+{
+
+ResultSet::ResultSet():
+        num_rows_( 0 )
+{
+}
+
+ResultSet::ResultSet( const std::vector<field_id_t> & field_ids ):
+        field_ids_( field_ids ),
+        num_rows_( 0 )
+{
+}
+
+void ResultSet::reserve( std::size_t num_rows )
+{
+    values_.reserve( num_rows * field_ids_.size() );
+}
+
+void ResultSet::add_row( const Record & record )
+{
+    for( auto field_id : field_ids_ )
+    {
+        values_.emplace_back();
+
+        record.get_field( field_id, & values_.back() );
+    }
+
+    ++num_rows_;
+}
+
+void ResultSet::add_row( const Record & left, std::size_t num_left_columns, const Record & right )
+{
+    assert( num_left_columns <= field_ids_.size() );
+
+    for( std::size_t i = 0; i < field_ids_.size(); ++i )
+    {
+        values_.emplace_back();
+
+        ( i < num_left_columns ? left : right ).get_field( field_ids_[ i ], & values_.back() );
+    }
+
+    ++num_rows_;
+}
+
+std::size_t ResultSet::get_num_rows() const
+{
+    return num_rows_;
+}
+
+std::size_t ResultSet::get_num_columns() const
+{
+    return field_ids_.size();
+}
+
+const std::vector<field_id_t> & ResultSet::get_field_ids() const
+{
+    return field_ids_;
+}
+
+std::size_t ResultSet::find_column( field_id_t field_id ) const
+{
+    for( std::size_t i = 0; i < field_ids_.size(); ++i )
+    {
+        if( field_ids_[ i ] == field_id )
+            return i;
+    }
+
+    return NOT_FOUND;
+}
+
+const Value & ResultSet::get( std::size_t row, std::size_t column ) const
+{
+    assert( row < get_num_rows() && column < field_ids_.size() );
+
+    return values_[ row * field_ids_.size() + column ];
+}
+
+const Value * ResultSet::get_row( std::size_t row ) const
+{
+    assert( row < get_num_rows() );
+
+    return values_.data() + row * field_ids_.size();
+}
+
+} // namespace anyvalue_db
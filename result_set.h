@@ -0,0 +1,89 @@
+/*
+
+Result set.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__RESULT_SET_H
+#define ANYVALUE_DB__RESULT_SET_H
+
+#include <vector>           // std::vector
+
+#include "types.h"          // field_id_t
+#include "value.h"          // Value
+
+namespace anyvalue_db
+{
+
+class Record;
+
+/**
+ * @brief Copies of selected fields of records, rows x columns in one buffer. Doesn't refer to the table.
+ */
+class ResultSet
+{
+public:
+
+    static const std::size_t NOT_FOUND = static_cast<std::size_t>( -1 );
+
+public:
+
+    ResultSet();
+    ResultSet( const std::vector<field_id_t> & field_ids );
+
+    void reserve( std::size_t num_rows );
+
+    /**
+     * @brief copies the fields of the record, missing fields are UNDEF
+     */
+    void add_row( const Record & record );
+
+    /**
+     * @brief the first num_left_columns columns are copied from the left record, the others from the right one
+     */
+    void add_row( const Record & left, std::size_t num_left_columns, const Record & right );
+
+    std::size_t get_num_rows() const;
+    std::size_t get_num_columns() const;
+
+    const std::vector<field_id_t> & get_field_ids() const;
+
+    /**
+     * @brief returns the column of the field or NOT_FOUND
+     */
+    std::size_t find_column( field_id_t field_id ) const;
+
+    const Value & get( std::size_t row, std::size_t column ) const;
+
+    /**
+     * @brief values of the row, get_num_columns() of them
+     */
+    const Value * get_row( std::size_t row ) const;
+
+private:
+
+    std::vector<field_id_t> field_ids_;
+    std::size_t             num_rows_;
+    std::vector<Value>      values_;        // row-major
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__RESULT_SET_H
@@ -0,0 +1,146 @@
+/*
+
+Schema. Types and constraints of table fields.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "schema.h"         // self
+
+#include "record.h"         // Record
+
+namespace anyvalue_db
+{
+
+namespace
+{
+
+const char* to_string( anyvalue::type_e type )
+{
+    switch( type )
+    {
+    case anyvalue::type_e::BOOL:
+        return "bool";
+    case anyvalue::type_e::INT:
+        return "int";
+    case anyvalue::type_e::DOUBLE:
+        return "double";
+    case anyvalue::type_e::STRING:
+        return "string";
+    default:
+        return "undef";
+    }
+}
+
+} // namespace
+
+bool Schema::add_field( field_id_t field_id, anyvalue::type_e type, bool is_nullable, bool is_indexed )
+{
+    Field f = { field_id, type, is_nullable, is_indexed };
+
+    return map_id_to_field_.insert( std::make_pair( field_id, f ) ).second;
+}
+
+bool Schema::is_empty() const
+{
+    return map_id_to_field_.empty();
+}
+
+const Schema::Field* Schema::find( field_id_t field_id ) const
+{
+    auto it = map_id_to_field_.find( field_id );
+
+    if( it == map_id_to_field_.end() )
+        return nullptr;
+
+    return & it->second;
+}
+
+std::vector<field_id_t> Schema::get_indexed_field_ids() const
+{
+    std::vector<field_id_t> res;
+
+    for( auto & e : map_id_to_field_ )
+    {
+        if( e.second.is_indexed )
+            res.push_back( e.first );
+    }
+
+    return res;
+}
+
+bool Schema::validate_value( field_id_t field_id, const Value & value, std::string * error_msg ) const
+{
+    if( is_empty() )
+        return true;
+
+    auto f = find( field_id );
+
+    if( f == nullptr )
+    {
+        * error_msg = "field id " + std::to_string( field_id ) + " is not in schema";
+        return false;
+    }
+
+    if( value.get_type() != f->type )
+    {
+        * error_msg = "field id " + std::to_string( field_id ) + " must be of type " + to_string( f->type ) + ", got " + to_string( value.get_type() );
+        return false;
+    }
+
+    return true;
+}
+
+bool Schema::validate_deletion( field_id_t field_id, std::string * error_msg ) const
+{
+    auto f = find( field_id );
+
+    if( f && f->is_nullable == false )
+    {
+        * error_msg = "field id " + std::to_string( field_id ) + " is not nullable";
+        return false;
+    }
+
+    return true;
+}
+
+bool Schema::validate_record( const Record & record, std::string * error_msg ) const
+{
+    if( is_empty() )
+        return true;
+
+    for( auto & e : map_id_to_field_ )
+    {
+        if( e.second.is_nullable == false && record.has_field( e.first ) == false )
+        {
+            * error_msg = "field id " + std::to_string( e.first ) + " is not nullable, but missing";
+            return false;
+        }
+    }
+
+    for( auto & e : record.fields_ )
+    {
+        if( validate_value( e.first, record.decode( e.first, e.second ), error_msg ) == false )
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace anyvalue_db
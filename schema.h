@@ -0,0 +1,75 @@
+/*
+
+Schema. Types and constraints of table fields.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__SCHEMA_H
+#define ANYVALUE_DB__SCHEMA_H
+
+#include <map>              // std::map
+#include <vector>           // std::vector
+#include <string>           // std::string
+
+#include "types.h"          // field_id_t
+#include "value.h"          // Value
+
+namespace anyvalue_db
+{
+
+struct Record;
+
+/**
+ * @brief Declared fields of a table. A table without schema accepts any field of any type.
+ */
+class Schema
+{
+public:
+
+    struct Field
+    {
+        field_id_t          field_id;
+        anyvalue::type_e    type;
+        bool                is_nullable;
+        bool                is_indexed;     // unique key
+    };
+
+public:
+
+    bool add_field( field_id_t field_id, anyvalue::type_e type, bool is_nullable, bool is_indexed );
+
+    bool is_empty() const;
+
+    const Field* find( field_id_t field_id ) const;
+
+    std::vector<field_id_t> get_indexed_field_ids() const;
+
+    bool validate_value( field_id_t field_id, const Value & value, std::string * error_msg ) const;
+    bool validate_deletion( field_id_t field_id, std::string * error_msg ) const;
+    bool validate_record( const Record & record, std::string * error_msg ) const;
+
+private:
+
+    std::map<field_id_t,Field>  map_id_to_field_;
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__SCHEMA_H
@@ -43,7 +43,7 @@ anyvalue_db::Record* load( std::istream & is, anyvalue_db::Record* e )
 
     if( res == nullptr )
     {
-        delete el;
+        anyvalue_db::Serializer::destroy_Record( el );
         return nullptr;
     }
 
@@ -105,16 +105,61 @@ bool save( std::ostream & os, const anyvalue_db::Table * e )
 {
     return anyvalue_db::Serializer::save( os, * e );
 }
+
+anyvalue_db::FieldStats* load( std::istream & is, anyvalue_db::FieldStats* e )
+{
+    return anyvalue_db::Serializer::load( is, e );
+}
+
+bool save( std::ostream & os, const anyvalue_db::FieldStats & e )
+{
+    return anyvalue_db::Serializer::save( os, e );
+}
 }
 
 namespace anyvalue_db
 {
 
+namespace
+{
+
+thread_local Arena * arena_for_records = nullptr;   // arena of the table being loaded
+
+struct ArenaScope
+{
+    ArenaScope( Arena * arena )
+    {
+        arena_for_records   = arena;
+    }
+
+    ~ArenaScope()
+    {
+        arena_for_records   = nullptr;
+    }
+};
+
+} // namespace
+
 Record* Serializer::create_Record()
 {
+    if( arena_for_records )
+        return new( arena_for_records->allocate( sizeof( Record ) ) ) Record( nullptr, arena_for_records );
+
     return new Record();
 }
 
+void Serializer::destroy_Record( Record * e )
+{
+    if( arena_for_records && arena_for_records->owns( e ) )
+    {
+        e->~Record();
+        arena_for_records->deallocate( e, sizeof( Record ) );
+        return;
+    }
+
+    delete e;
+}
+
 Table* Serializer::create_Table()
 {
     return new Table();
@@ -125,27 +170,86 @@ Record* Serializer::load_1( std::istream & is, Record* res )
     if( res == nullptr )
         throw std::invalid_argument( "Serializer::load: res must not be null" );
 
-    if( serializer::load( is, & res->map_id_to_value_ ) == nullptr )
+    std::map<field_id_t,Value> fields;
+
+    if( serializer::load( is, & fields ) == nullptr )
         return nullptr;
 
+    res->fields_.reserve( fields.size() );
+
+    for( auto & e : fields )
+    {
+        res->emplace_field( e.first, std::move( e.second ) );
+    }
+
+    return res;
+}
+
+Record* Serializer::load_2( std::istream & is, Record* res )
+{
+    if( res == nullptr )
+        throw std::invalid_argument( "Serializer::load: res must not be null" );
+
+    uint32_t size;
+
+    if( serializer::load( is, & size ) == nullptr )
+        return nullptr;
+
+    res->fields_.reserve( size );
+
+    for( uint32_t i = 0; i < size; ++i )
+    {
+        field_id_t  field_id;
+        Value       value;
+
+        if( serializer::load( is, & field_id ) == nullptr )
+            return nullptr;
+        if( serializer::load( is, & value ) == nullptr )
+            return nullptr;
+
+        res->emplace_field( field_id, std::move( value ) );
+    }
+
     return res;
 }
 
 Record* Serializer::load( std::istream & is, Record* e )
 {
-    return load_t_1( is, e );
+    return load_t_1_2( is, e );
 }
 
 bool Serializer::save( std::ostream & os, const Record & e )
 {
-    static const unsigned int VERSION = 1;
+    if( e.is_spilled_ )
+    {
+        // the table keeps the record in exactly this format, so the data are copied as they are
+
+        std::string data;
+
+        if( e.parent_->get_spilled_data( & e, & data ) == false )
+            return false;
+
+        os.write( data.data(), data.size() );
+
+        return os.good();
+    }
+
+    static const unsigned int VERSION = 2;
 
     auto b = serializer::save( os, VERSION );
 
     if( b == false )
         return false;
 
-    b &= serializer::save( os, e.map_id_to_value_ );
+    // fields are written one by one, so that the format does not depend on the container type
+
+    b &= serializer::save( os, static_cast<uint32_t>( e.fields_.size() ) );
+
+    for( auto & f : e.fields_ )
+    {
+        b &= serializer::save( os, f.first );
+        b &= serializer::save( os, e.decode( f.first, f.second ) );     // codes are local to the table, values are stored
+    }
 
     return b;
 }
@@ -199,14 +303,49 @@ Status* Serializer::load_1( std::istream & is, Status* res )
     return res;
 }
 
+Status* Serializer::load_2( std::istream & is, Status* res )
+{
+    if( load_1( is, res ) == nullptr )
+        return nullptr;
+
+    if( serializer::load( is, & res->is_index_valid ) == nullptr )
+        return nullptr;
+    if( serializer::load( is, & res->indices ) == nullptr )
+        return nullptr;
+
+    return res;
+}
+
+Status* Serializer::load_3( std::istream & is, Status* res )
+{
+    if( load_2( is, res ) == nullptr )
+        return nullptr;
+
+    if( serializer::load( is, & res->dictionary_field_ids ) == nullptr )
+        return nullptr;
+
+    return res;
+}
+
+Status* Serializer::load_4( std::istream & is, Status* res )
+{
+    if( load_3( is, res ) == nullptr )
+        return nullptr;
+
+    if( serializer::load( is, & res->field_stats ) == nullptr )
+        return nullptr;
+
+    return res;
+}
+
 Status* Serializer::load( std::istream & is, Status* e )
 {
-    return load_t_1( is, e );
+    return load_t_1_2_3_4( is, e );
 }
 
 bool Serializer::save( std::ostream & os, const Status & e )
 {
-    static const unsigned int VERSION = 1;
+    static const unsigned int VERSION = 4;
 
     auto b = serializer::save( os, VERSION );
 
@@ -219,6 +358,85 @@ bool Serializer::save( std::ostream & os, const Status & e )
 
     b &= serializer::save<true>( os, e.metakeys );
 
+    b &= serializer::save( os, e.is_index_valid );
+
+    b &= serializer::save( os, e.indices );
+
+    b &= serializer::save( os, e.dictionary_field_ids );
+
+    b &= serializer::save( os, e.field_stats );
+
+    return b;
+}
+
+FieldStats* Serializer::load_1( std::istream & is, FieldStats* res )
+{
+    if( res == nullptr )
+        throw std::invalid_argument( "Serializer::load: res must not be null" );
+
+    uint32_t type;
+
+    if( serializer::load( is, & res->num_values_ ) == nullptr )
+        return nullptr;
+    if( serializer::load( is, & res->registers_ ) == nullptr )
+        return nullptr;
+    if( serializer::load( is, & type ) == nullptr )
+        return nullptr;
+    if( serializer::load( is, & res->is_mixed_ ) == nullptr )
+        return nullptr;
+    if( serializer::load( is, & res->has_min_max_ ) == nullptr )
+        return nullptr;
+
+    res->type_ = static_cast<anyvalue::type_e>( type );
+
+    if( res->has_min_max_ )
+    {
+        if( serializer::load( is, & res->min_ ) == nullptr )
+            return nullptr;
+        if( serializer::load( is, & res->max_ ) == nullptr )
+            return nullptr;
+    }
+
+    if( serializer::load( is, & res->bounds_ ) == nullptr )
+        return nullptr;
+    if( serializer::load( is, & res->counts_ ) == nullptr )
+        return nullptr;
+
+    if( res->bounds_.size() != res->counts_.size() )
+        return nullptr;
+
+    return res;
+}
+
+FieldStats* Serializer::load( std::istream & is, FieldStats* e )
+{
+    return load_t_1( is, e );
+}
+
+bool Serializer::save( std::ostream & os, const FieldStats & e )
+{
+    static const unsigned int VERSION = 1;
+
+    auto b = serializer::save( os, VERSION );
+
+    if( b == false )
+        return false;
+
+    b &= serializer::save( os, e.num_values_ );
+    b &= serializer::save( os, e.registers_ );
+    b &= serializer::save( os, static_cast<uint32_t>( e.type_ ) );
+    b &= serializer::save( os, e.is_mixed_ );
+    b &= serializer::save( os, e.has_min_max_ );
+
+    if( e.has_min_max_ )
+    {
+        b &= serializer::save( os, e.min_ );
+        b &= serializer::save( os, e.max_ );
+    }
+
+    b &= serializer::save( os, e.bounds_ );
+    b &= serializer::save( os, e.counts_ );
+
     return b;
 }
 
@@ -229,8 +447,12 @@ Table* Serializer::load_1( std::istream & is, Table* res )
 
     Status status;
 
-    if( load( is, & status ) == nullptr )
-        return nullptr;
+    {
+        ArenaScope scope( & res->arena_ );
+
+        if( load( is, & status ) == nullptr )
+            return nullptr;
+    }
 
     std::string error_msg;
 
@@ -242,6 +464,8 @@ Table* Serializer::load_1( std::istream & is, Table* res )
         return nullptr;
     }
 
+    res->is_inited_ = true;
+
     return res;
 }
 
@@ -40,6 +40,9 @@ bool save( std::ostream & os, const anyvalue_db::Record * e );
 
 anyvalue_db::Table** load( std::istream & is, anyvalue_db::Table** e );
 bool save( std::ostream & os, const anyvalue_db::Table * e );
+
+anyvalue_db::FieldStats* load( std::istream & is, anyvalue_db::FieldStats* e );
+bool save( std::ostream & os, const anyvalue_db::FieldStats & e );
 }
 
 namespace anyvalue_db
@@ -51,6 +54,7 @@ class Serializer: public serializer::VersionableLoaderT<Serializer>
 
 public:
     static Record* create_Record();
+    static void destroy_Record( Record * e );
     static Table* create_Table();
 
     static Record* load( std::istream & is, Record* e );
@@ -62,6 +66,9 @@ public:
 //    static metakey_id_t* load( std::istream & is, metakey_id_t* e );
 //    static bool save( std::ostream & os, const metakey_id_t & e );
 
+    static FieldStats* load( std::istream & is, FieldStats* e );
+    static bool save( std::ostream & os, const FieldStats & e );
+
     static Status* load( std::istream & is, Status* e );
     static bool save( std::ostream & os, const Status & e );
 
@@ -74,8 +81,13 @@ public:
 private:
 
     static Record* load_1( std::istream & is, Record* e );
+    static Record* load_2( std::istream & is, Record* e );
 
     static Status* load_1( std::istream & is, Status* e );
+    static Status* load_2( std::istream & is, Status* e );
+    static Status* load_3( std::istream & is, Status* e );
+    static Status* load_4( std::istream & is, Status* e );
+    static FieldStats* load_1( std::istream & is, FieldStats* e );
     static Table* load_1( std::istream & is, Table* e );
     static DBStatus* load_1( std::istream & is, DBStatus* e );
 };
@@ -0,0 +1,148 @@
+/*
+
+Spill file. Scratch storage for records evicted from memory.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "spill_file.h"     // self
+
+#include <cerrno>           // errno
+
+#include <fcntl.h>          // open
+#include <unistd.h>         // pread, pwrite, close, unlink
+
+namespace anyvalue_db
+{
+
+SpillFile::SpillFile():
+        fd_( -1 ),
+        size_( 0 )
+{
+}
+
+SpillFile::~SpillFile()
+{
+    close();
+}
+
+bool SpillFile::open( std::string * error_msg, const std::string & filename )
+{
+    close();
+
+    fd_ = ::open( filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600 );
+
+    if( fd_ < 0 )
+    {
+        * error_msg =  "cannot open file " + filename;
+        return false;
+    }
+
+    filename_   = filename;
+    size_       = 0;
+
+    return true;
+}
+
+void SpillFile::close()
+{
+    if( fd_ < 0 )
+        return;
+
+    ::close( fd_ );
+    ::unlink( filename_.c_str() );
+
+    fd_     = -1;
+    size_   = 0;
+    filename_.clear();
+}
+
+bool SpillFile::is_open() const
+{
+    return fd_ >= 0;
+}
+
+bool SpillFile::write( uint64_t offset, const std::string & data )
+{
+    auto p      = data.data();
+    auto size   = data.size();
+
+    while( size > 0 )
+    {
+        auto res = ::pwrite( fd_, p, size, offset );
+
+        if( res < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            return false;
+        }
+
+        p       += res;
+        size    -= res;
+        offset  += res;
+    }
+
+    if( offset > size_ )
+        size_ = offset;
+
+    return true;
+}
+
+bool SpillFile::append( const std::string & data, uint64_t * offset )
+{
+    * offset = size_;
+
+    return write( size_, data );
+}
+
+bool SpillFile::read( uint64_t offset, uint32_t size, std::string * data ) const
+{
+    data->resize( size );
+
+    std::size_t pos = 0;
+
+    while( pos < size )
+    {
+        auto res = ::pread( fd_, & ( * data )[ pos ], size - pos, offset + pos );
+
+        if( res < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            return false;
+        }
+
+        if( res == 0 )
+            return false;   // unexpected end of file
+
+        pos += res;
+    }
+
+    return true;
+}
+
+uint64_t SpillFile::get_size() const
+{
+    return size_;
+}
+
+} // namespace anyvalue_db
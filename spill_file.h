@@ -0,0 +1,71 @@
+/*
+
+Spill file. Scratch storage for records evicted from memory.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__SPILL_FILE_H
+#define ANYVALUE_DB__SPILL_FILE_H
+
+#include <string>           // std::string
+#include <cstdint>          // uint64_t
+#include <atomic>           // std::atomic
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief Unstructured file, data are addressed by offset and size kept by the owner.
+ *
+ * The file is truncated on open and removed on close, its content doesn't survive the process.
+ */
+class SpillFile
+{
+public:
+
+    SpillFile();
+    ~SpillFile();
+
+    bool open( std::string * error_msg, const std::string & filename );
+    void close();
+
+    bool is_open() const;
+
+    bool write( uint64_t offset, const std::string & data );
+    bool append( const std::string & data, uint64_t * offset );
+    bool read( uint64_t offset, uint32_t size, std::string * data ) const;
+
+    uint64_t get_size() const;
+
+private:
+
+    SpillFile( const SpillFile & )              = delete;
+    SpillFile & operator=( const SpillFile & )  = delete;
+
+private:
+
+    int                     fd_;
+    std::atomic<uint64_t>   size_;      // readable without lock
+    std::string             filename_;
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__SPILL_FILE_H
@@ -28,15 +28,27 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 #include <map>              // std::pair
 
 #include "record.h"         // Record
+#include "field_stats.h"    // FieldStats
 
 namespace anyvalue_db
 {
 
 struct Status
 {
+    typedef std::vector<uint32_t>   VectorOrdinal;  // ordinals of records in the order of the index keys
+
     std::vector<field_id_t> index_field_ids;
     std::vector<Record*>    records;
     std::vector<std::pair<metakey_id_t,Value>>  metakeys;
+    bool                    is_index_valid;     // true, if indices can be restored without rebuilding
+    std::vector<std::pair<field_id_t,VectorOrdinal>>    indices;
+    std::vector<field_id_t> dictionary_field_ids;
+    std::vector<std::pair<field_id_t,FieldStats>>   field_stats;    // empty, if statistics have to be rebuilt
+
+    Status():
+        is_index_valid( false )
+    {
+    }
 };
 
 } // namespace anyvalue_db
@@ -34,9 +34,11 @@ namespace anyvalue_db
 
 std::ostream & StrHelper::write( std::ostream & os, const Record & l )
 {
-    for( auto e : l.map_id_to_value_ )
+    l.load_if_spilled();
+
+    for( auto e : l.fields_ )
     {
-        os << "key_" << e.first << " = " << anyvalue::StrHelper::to_string( e.second ) << " ";
+        os << "key_" << e.first << " = " << anyvalue::StrHelper::to_string( l.decode( e.first, e.second ) ) << " ";
     }
 
     return os;
@@ -54,9 +56,12 @@ std::ostream & StrHelper::write( std::ostream & os, const Table & l )
 
     os << "records:" << "\n";
 
-    for( auto e : l.records_ )
+    for( auto & e : l.slots_ )
     {
-        write( os, * e );
+        if( e.record == nullptr )
+            continue;
+
+        write( os, * e.record );
 
         os << "\n";
     }
@@ -85,7 +90,10 @@ std::ostream & StrHelper::write( std::ostream & os, const DB & l )
                 << "table '" << e.first << "'\n"
                 << "\n";
 
-        write( os, * e.second );
+        if( e.second )
+            write( os, * e.second );
+        else
+            os << "not loaded\n";
 
         os << "\n";
     }
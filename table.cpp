@@ -23,48 +23,206 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include "table.h"                      // self
 
-#include <fstream>                      // std::ifstream
+#include <sstream>                      // std::istringstream
+#include <algorithm>                    // std::sort
+#include <cinttypes>                    // PRIu64
+#include <cmath>                        // std::log2
 
 #include "utils/mutex_helper.h"         // MUTEX_SCOPE_LOCK
-#include "utils/dummy_logger.h"         // dummy_log
 #include "utils/utils_assert.h"         // ASSERT
 #include "utils/rename_and_backup.h"    // utils::rename_and_backup
 #include "anyvalue/value_operations.h"  // anyvalue::compare_values
+#include "typed_value.h"                // compare_typed_values
 #include "anyvalue/str_helper.h"        // anyvalue::StrHelper
 
 #include "str_helper.h"                 // StrHelper
 #include "serializer.h"                 // serializer::load
+#include "block_file.h"                 // BlockFile
+#include "parallel_helper.h"            // run_parallel
+#include "log_helper.h"                 // AVDB_LOG_DEBUG
 
 #define MODULENAME      "Table"
 
 namespace anyvalue_db
 {
 
+namespace
+{
+
+bool compare_any( anyvalue::comparison_type_e op, const Value & lhs, const Value & rhs )
+{
+    return anyvalue::compare_values( op, lhs, rhs );
+}
+
+// selectivities of conditions and costs of visiting a record, used by the planner in absence of statistics
+
+const double SELECTIVITY_EQ     = 0.1;
+const double SELECTIVITY_NEQ    = 0.9;
+const double SELECTIVITY_RANGE  = 1.0 / 3;
+
+const double COST_SCAN          = 1.0;
+const double COST_COLUMNAR      = 0.25;
+const double COST_INDEX         = 2.0;
+const double COST_SORT          = 0.1;      // per record and comparison
+
+void tighten_lower_bound( QueryPlan::Bound * bound, const Value & value, bool is_inclusive )
+{
+    if( bound->is_set == false || bound->value < value )
+    {
+        * bound = { true, is_inclusive, value };
+    }
+    else if( ( value < bound->value ) == false )
+    {
+        bound->is_inclusive = bound->is_inclusive && is_inclusive;
+    }
+}
+
+void tighten_upper_bound( QueryPlan::Bound * bound, const Value & value, bool is_inclusive )
+{
+    if( bound->is_set == false || value < bound->value )
+    {
+        * bound = { true, is_inclusive, value };
+    }
+    else if( ( bound->value < value ) == false )
+    {
+        bound->is_inclusive = bound->is_inclusive && is_inclusive;
+    }
+}
+
+} // namespace
+
 Table::Table():
-        is_inited_( false )
+        is_inited_( false ),
+        change_count_( 0 ),
+        is_index_persisted_( false ),
+        num_records_( 0 ),
+        mem_records_( 0 ),
+        mem_fields_( 0 ),
+        mem_payload_( 0 ),
+        mem_metakeys_( 0 ),
+        mem_columns_( 0 ),
+        memory_budget_( 0 ),
+        num_spilled_( 0 )
 {
 }
 
 Table::~Table()
 {
-    for( auto e: records_ )
+    for( auto & e: slots_ )
+    {
+        if( e.record )
+            destroy_record( e.record );
+    }
+}
+
+void Table::destroy_record( Record * record )
+{
+    if( arena_.owns( record ) )
+    {
+        record->~Record();
+        arena_.deallocate( record, sizeof( Record ) );
+        return;
+    }
+
+    delete record;
+}
+
+bool Table::has_record( const Record * record ) const
+{
+    return record->slot_ < slots_.size() && slots_[ record->slot_ ].record == record;
+}
+
+bool Table::insert_record( Record * record )
+{
+    if( has_record( record ) )
+        return false;
+
+    uint32_t slot;
+
+    if( free_slots_.empty() == false )
+    {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>( slots_.size() );
+        slots_.push_back( Slot { nullptr, 0 } );
+
+        for( auto & e : map_field_id_to_column_ )
+        {
+            e.second.resize( slots_.size() );
+
+            mem_columns_ += Column::SLOT_SIZE;
+        }
+    }
+
+    slots_[ slot ].record   = record;
+    record->slot_           = slot;
+
+    if( memory_budget_ )
+    {
+        if( spill_slots_.size() < slots_.size() )
+            spill_slots_.resize( slots_.size() );
+
+        auto & s = spill_slots_[ slot ];
+
+        s.is_clean  = false;
+        s.is_in_lru = true;
+
+        lru_.push_front( slot );
+        s.lru_pos   = lru_.begin();
+    }
+
+    ++num_records_;
+
+    return true;
+}
+
+void Table::erase_record( Record * record )
+{
+    assert( has_record( record ) );
+
+    auto & slot = slots_[ record->slot_ ];
+
+    slot.record = nullptr;
+    ++slot.generation;      // invalidates all handles to the slot
+
+    free_slots_.push_back( record->slot_ );
+
+    for( auto & e : map_field_id_to_column_ )
+        clear_column( e.second, record->slot_ );
+
+    if( memory_budget_ )
     {
-        delete e;
+        auto & s = spill_slots_[ record->slot_ ];
+
+        if( s.is_in_lru )
+            lru_.erase( s.lru_pos );
+
+        s.is_in_lru = false;
+        s.is_clean  = false;
     }
+
+    record->slot_ = RecordHandle::INVALID_SLOT;
+
+    --num_records_;
 }
 
 void Table::init(
         const std::string   & filename )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
     assert( is_inited_ == false );
 
-    auto b = load_intern( filename );
+    std::string error_msg;
+
+    auto b = load_intern( & error_msg, filename );
 
     if( ! b )
     {
-        throw std::runtime_error( "Table::init: cannot load " + filename );
+        throw std::runtime_error( "Table::init: cannot load " + filename + ": " + error_msg );
     }
 
     is_inited_  = true;
@@ -73,7 +231,14 @@ void Table::init(
 void Table::init(
         const std::vector<field_id_t> & keys )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    init( keys, std::vector<field_id_t>() );
+}
+
+void Table::init(
+        const std::vector<field_id_t> & keys,
+        const std::vector<field_id_t> & dictionary_field_ids )
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
     assert( is_inited_ == false );
 
@@ -84,62 +249,122 @@ void Table::init(
         throw std::runtime_error( "Table::init: cannot init index keys" );
     }
 
+    init_dictionaries( dictionary_field_ids );
+
     is_inited_  = true;
 }
 
-std::size_t Table::get_size() const
+void Table::init(
+        const Schema & schema )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    init( schema.get_indexed_field_ids() );
+
+    std::string error_msg;
 
-    return records_.size();
+    auto b = set_schema( schema, & error_msg );
+
+    if( !b )
+    {
+        throw std::runtime_error( "Table::init: cannot set schema: " + error_msg );
+    }
 }
 
-bool Table::add_record(
-        Record              * record,
+bool Table::set_schema(
+        const Schema        & schema,
         std::string         * error_msg )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
-    return add_record__unlocked( record, error_msg );
+    // unique keys are enforced by indices, which can only be created by init()
+
+    if( schema.is_empty() == false )
+    {
+        std::vector<field_id_t> keys;
+
+        for( auto & e : map_field_id_to_index_ )
+            keys.push_back( e.first );
+
+        if( schema.get_indexed_field_ids() != keys )
+        {
+            * error_msg = "indexed fields of the schema differ from the keys of the table";
+
+            AVDB_LOG_ERROR( MODULENAME, "set_schema: %s", error_msg->c_str() );
+
+            return false;
+        }
+    }
+
+    for( auto & e : slots_ )
+    {
+        if( e.record == nullptr )
+            continue;
+
+        Record tmp;
+
+        if( schema.validate_record( get_view( e.record, & tmp ), error_msg ) == false )
+        {
+            AVDB_LOG_ERROR( MODULENAME, "set_schema: record %p violates schema: %s", e.record, error_msg->c_str() );
+
+            return false;
+        }
+    }
+
+    schema_ = schema;
+
+    return true;
 }
 
-bool Table::add_record__unlocked(
-        Record              * record,
-        std::string         * error_msg )
+std::size_t Table::get_size() const
 {
-    return add_record__unlocked__intern( record, error_msg, false );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    return num_records_;
 }
 
-bool Table::add_loaded_record__unlocked(
+bool Table::add_record(
         Record              * record,
         std::string         * error_msg )
 {
-    return add_record__unlocked__intern( record, error_msg, true );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    return add_record__unlocked( record, error_msg );
 }
 
-bool Table::add_record__unlocked__intern(
+bool Table::add_record__unlocked(
         Record              * record,
-        std::string         * error_msg,
-        bool                is_loaded )
+        std::string         * error_msg )
 {
-    assert( ( is_inited_ && is_loaded == false ) || ( is_inited_ == false && is_loaded ) );
+    assert( is_inited_ );
+
+    METRICS_SCOPE( metrics_, operation_e::ADD_RECORD );
+
+    enforce_memory_budget();
 
     std::string error_msg_2;
 
+    if( schema_.validate_record( * record, & error_msg_2 ) == false )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "add_record__unlocked: schema validation failure %s", error_msg_2.c_str() );
+
+        * error_msg = "schema validation failure " + error_msg_2;
+
+        return false;
+    }
+
     if( validate_keys_of_new_record( * record, & error_msg_2 ) == false )
     {
-        dummy_log_error( MODULENAME, "add_record__unlocked: key validation failure %s", error_msg_2.c_str() );
+        AVDB_LOG_ERROR( MODULENAME, "add_record__unlocked: key validation failure %s", error_msg_2.c_str() );
 
         * error_msg = "key validation failure " + error_msg_2;
 
         return false;
     }
 
-    auto b = records_.insert( record ).second;
+    auto b = insert_record( record );
 
     if( b == false )
     {
-        dummy_log_error( MODULENAME, "add_record__unlocked: record %p already exists", record );
+        AVDB_LOG_ERROR( MODULENAME, "add_record__unlocked: record %p already exists", record );
 
         * error_msg = "record already exists";
 
@@ -149,6 +374,15 @@ bool Table::add_record__unlocked__intern(
     add_index_for_record( record );
 
     record->set_parent( this );
+    record->set_dictionaries( & map_field_id_to_dictionary_ );
+
+    add_columns_for_record( record );
+
+    account_record( * record, 1 );
+
+    update_stats( * record, 1 );
+
+    ++change_count_;
 
     return true;
 }
@@ -158,13 +392,23 @@ Record* Table::create_record__unlocked(
 {
     assert( is_inited_ );
 
-    auto res = new Record( this );
+    METRICS_SCOPE( metrics_, operation_e::ADD_RECORD );
+
+    enforce_memory_budget();
+
+    auto res = new( arena_.allocate( sizeof( Record ) ) ) Record( this, & arena_ );
 
-    auto b = records_.insert( res ).second;
+    res->set_dictionaries( & map_field_id_to_dictionary_ );
+
+    auto b = insert_record( res );
 
     assert( b );    // should never happen
 
-    dummy_log_info( MODULENAME, "create_record__unlocked: created new record %p", res );
+    account_record( * res, 1 );
+
+    ++change_count_;
+
+    AVDB_LOG_INFO( MODULENAME, "create_record__unlocked: created new record %p", res );
 
     return res;
 }
@@ -175,21 +419,30 @@ bool Table::delete_record__unlocked(
 {
     assert( is_inited_ );
 
-    auto it = records_.find( record );
-    if( it == records_.end() )
+    METRICS_SCOPE( metrics_, operation_e::DELETE_RECORD );
+
+    if( record == nullptr || has_record( record ) == false )
     {
         * error_msg   = "record " + std::to_string( reinterpret_cast<std::uintptr_t>( record ) ) + " not found";
-        dummy_log_error( MODULENAME, "delete_record__unlocked: record %p not found", record );
+        AVDB_LOG_ERROR( MODULENAME, "delete_record__unlocked: record %p not found", record );
         return false;
     }
 
-    records_.erase( it );
+    fault_in( record );     // index cleanup needs the fields
+
+    account_record( * record, -1 );
+
+    update_stats( * record, -1 );
+
+    erase_record( record );
 
     cleanup_index_for_record( record );
 
-    delete record;
+    ++change_count_;
 
-    dummy_log_info( MODULENAME, "delete_record__unlocked: record %p deleted", record );
+    destroy_record( record );
+
+    AVDB_LOG_INFO( MODULENAME, "delete_record__unlocked: record %p deleted", record );
 
     return true;
 }
@@ -205,7 +458,7 @@ bool Table::delete_record__unlocked(
 
     if( rec == nullptr )
     {
-        dummy_log_debug( MODULENAME, "delete_record__unlocked: field id %u w/ value %s not found", field_id, anyvalue::StrHelper::to_string( value ).c_str() );
+        AVDB_LOG_DEBUG( MODULENAME, "delete_record__unlocked: field id %u w/ value %s not found", field_id, anyvalue::StrHelper::to_string( value ).c_str() );
 
         * error_msg = "field id " + std::to_string( field_id ) + " w/ value " + anyvalue::StrHelper::to_string( value ) + " not found";
 
@@ -216,37 +469,106 @@ bool Table::delete_record__unlocked(
 
     if( b )
     {
-        dummy_log_info( MODULENAME, "delete_record__unlocked: delete - field id %u w/ value %s", field_id, anyvalue::StrHelper::to_string( value ).c_str() );
+        AVDB_LOG_INFO( MODULENAME, "delete_record__unlocked: delete - field id %u w/ value %s", field_id, anyvalue::StrHelper::to_string( value ).c_str() );
     }
     else
     {
-        dummy_log_info( MODULENAME, "delete_record__unlocked: cannot delete record - field id %u w/ value %s", field_id, anyvalue::StrHelper::to_string( value ).c_str() );
+        AVDB_LOG_INFO( MODULENAME, "delete_record__unlocked: cannot delete record - field id %u w/ value %s", field_id, anyvalue::StrHelper::to_string( value ).c_str() );
     }
 
     return b;
 }
 
+bool Table::delete_record__unlocked(
+        const RecordHandle  & handle,
+        std::string         * error_msg )
+{
+    assert( is_inited_ );
+
+    auto rec = get_record__unlocked( handle );
+
+    if( rec == nullptr )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "delete_record__unlocked: handle %u:%u is stale", handle.slot, handle.generation );
+
+        * error_msg = "handle " + std::to_string( handle.slot ) + ":" + std::to_string( handle.generation ) + " is stale";
+
+        return false;
+    }
+
+    return delete_record__unlocked( rec, error_msg );
+}
+
+RecordHandle Table::get_handle__unlocked( const Record * record ) const
+{
+    if( record == nullptr || has_record( record ) == false )
+        return RecordHandle { RecordHandle::INVALID_SLOT, 0 };
+
+    return RecordHandle { record->slot_, slots_[ record->slot_ ].generation };
+}
+
+Record* Table::get_record__unlocked( const RecordHandle & handle ) const
+{
+    if( handle.slot >= slots_.size() )
+        return nullptr;
+
+    auto & slot = slots_[ handle.slot ];
+
+    if( slot.generation != handle.generation )
+        return nullptr;
+
+    enforce_memory_budget();
+
+    fault_in( slot.record );
+
+    return slot.record;
+}
+
 void Table::set_meta_key(
         metakey_id_t        metakey_id,
         const Value         & value )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
     set_meta_key__unlocked( metakey_id, value );
 }
 
+void Table::set_meta_key(
+        metakey_id_t        metakey_id,
+        Value               && value )
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    set_meta_key__unlocked( metakey_id, std::move( value ) );
+}
+
 void Table::set_meta_key__unlocked(
         metakey_id_t        metakey_id,
         const Value         & value )
 {
-    map_metakey_id_to_value_[ metakey_id ]    = value;
+    set_meta_key__unlocked( metakey_id, Value( value ) );
+}
+
+void Table::set_meta_key__unlocked(
+        metakey_id_t        metakey_id,
+        Value               && value )
+{
+    auto & v = map_metakey_id_to_value_[ metakey_id ];
+
+    mem_metakeys_ -= MemorySize::get_metakey( v );
+
+    v = std::move( value );
+
+    mem_metakeys_ += MemorySize::get_metakey( v );
+
+    ++change_count_;
 }
 
 bool Table::get_meta_key(
         metakey_id_t        metakey_id,
         Value               * value )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
     return get_meta_key__unlocked( metakey_id, value );
 }
@@ -268,7 +590,7 @@ bool Table::get_meta_key__unlocked(
 bool Table::delete_meta_key(
         metakey_id_t        metakey_id )
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
     return delete_meta_key__unlocked( metakey_id );
 }
@@ -281,298 +603,1908 @@ bool Table::delete_meta_key__unlocked(
     if( it == map_metakey_id_to_value_.end() )
         return false;
 
+    mem_metakeys_ -= MemorySize::get_metakey( it->second );
+
     map_metakey_id_to_value_.erase( it );
 
+    ++change_count_;
+
     return true;
 }
 
 bool Table::on_add_field( field_id_t field_id, const Value & value, Record * record )
 {
+    std::string error_msg;
+
+    if( schema_.validate_value( field_id, value, & error_msg ) == false )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "on_add_field: %s", error_msg.c_str() );
+        return false;
+    }
+
+    ++change_count_;
+
+    mark_dirty( record );
+
     auto it = map_field_id_to_index_.find( field_id );
 
-    if( it == map_field_id_to_index_.end() )
-        return true;
+    if( it != map_field_id_to_index_.end() )
+    {
+        auto & map = it->second;
 
-    auto & map = it->second;
+        auto it_2 = map.lower_bound( value );
+
+        if( it_2 != map.end() && map.key_comp()( value, it_2->first ) == false )
+            return false;       // value already exists, not possible to insert it again as it will destroy index
+
+        // the key is copied once, directly into the node
 
-    auto it_2 = map.find( value );
+        auto it_3 = map.emplace_hint( it_2, value, record );
 
-    if( it_2 != map.end() )
-        return false;       // value already exists, not possible to insert it again as it will destroy index
+        account_index_entry( field_id, it_3->first, 1 );
+    }
 
-    auto b = map.insert( std::make_pair( value, record ) ).second;
+    if( has_record( record ) )
+    {
+        account_field( field_id, value, 1 );
+        update_stats( field_id, value, 1 );
+    }
 
-    assert( b );
+    set_column_value( field_id, value, record );
 
     return true;
 }
 
 bool Table::on_update_field( field_id_t field_id, const Value & old_value, const Value & new_value, Record * record )
 {
-    auto it = map_field_id_to_index_.find( field_id );
+    std::string error_msg;
 
-    if( it == map_field_id_to_index_.end() )
-        return true;
+    if( schema_.validate_value( field_id, new_value, & error_msg ) == false )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "on_update_field: %s", error_msg.c_str() );
+        return false;
+    }
 
-    auto & map = it->second;
+    ++change_count_;
 
-    auto it_2 = map.find( old_value );
+    mark_dirty( record );
+
+    auto it = map_field_id_to_index_.find( field_id );
 
-    assert( it_2 != map.end() );    // old value must exist
+    if( it != map_field_id_to_index_.end() )
+    {
+        auto & map = it->second;
 
-    auto it_3 = map.find( new_value );
+        auto it_2 = map.find( old_value );
 
-    if( it_3 != map.end() )
-        return false;       // new value already exists, not possible to insert it again as it will destroy index
+        assert( it_2 != map.end() );    // old value must exist
 
-    map.erase( it_2 );
+        auto it_3 = map.lower_bound( new_value );
 
-    auto b = map.insert( std::make_pair( new_value, record ) ).second;
+        if( it_3 != map.end() && map.key_comp()( new_value, it_3->first ) == false )
+            return false;       // new value already exists, not possible to insert it again as it will destroy index
 
-    assert( b );
+        if( it_3 == it_2 )
+            ++it_3;             // new value goes right before the old one, keep the hint valid after erase
 
-    return true;
-}
+        account_index_entry( field_id, it_2->first, -1 );
 
-void Table::on_delete_field( field_id_t field_id, const Value & value )
-{
-    auto it = map_field_id_to_index_.find( field_id );
+        map.erase( it_2 );
 
-    if( it == map_field_id_to_index_.end() )
-        return;
+        auto it_4 = map.emplace_hint( it_3, new_value, record );
 
-    auto & map = it->second;
+        account_index_entry( field_id, it_4->first, 1 );
+    }
 
-    auto it_2 = map.find( value );
+    if( has_record( record ) )
+    {
+        account_field( field_id, old_value, -1 );
+        account_field( field_id, new_value, 1 );
+        update_stats( field_id, old_value, -1 );
+        update_stats( field_id, new_value, 1 );
+    }
 
-    assert( it_2 != map.end() );    // value must exist
+    set_column_value( field_id, new_value, record );
 
-    map.erase( it_2 );
+    return true;
 }
 
-
-void Table::cleanup_index_for_record( Record * record )
+bool Table::on_delete_field( field_id_t field_id, const Value & value, Record * record )
 {
-    for( auto & e : map_field_id_to_index_ )
+    std::string error_msg;
+
+    if( schema_.validate_deletion( field_id, & error_msg ) == false )
     {
-        cleanup_index_for_record_field( record, e.first, e.second );
+        AVDB_LOG_ERROR( MODULENAME, "on_delete_field: %s", error_msg.c_str() );
+        return false;
     }
-}
 
-void Table::cleanup_index_for_record_field( Record * record, field_id_t field_id, MapValueIdToRecord & map )
-{
-    Value v;
+    ++change_count_;
 
-    if( record->get_field( field_id, & v ) == false )
-        return;
+    mark_dirty( record );
 
-    auto it = map.find( v );
+    auto it = map_field_id_to_index_.find( field_id );
 
-    if( it == map.end() )
+    if( it != map_field_id_to_index_.end() )
     {
-        dummy_log_error( MODULENAME, "cleanup_index_for_record_field: record %p, field_id %u, cannot find value %s", record, field_id, anyvalue::StrHelper::to_string( v ).c_str() );
-        return;
-    }
+        auto & map = it->second;
 
-    map.erase( it );
+        auto it_2 = map.find( value );
 
-    dummy_log_debug( MODULENAME, "cleanup_index_for_record_field: record %p, field_id %u, value %s - OK", record, field_id, anyvalue::StrHelper::to_string( v ).c_str() );
-}
+        assert( it_2 != map.end() );    // value must exist
 
-void Table::add_index_for_record( Record * record )
-{
-    for( auto & e : map_field_id_to_index_ )
+        account_index_entry( field_id, it_2->first, -1 );
+
+        map.erase( it_2 );
+    }
+
+    if( has_record( record ) )
     {
-        add_index_for_record_field( record, e.first, e.second );
+        account_field( field_id, value, -1 );
+        update_stats( field_id, value, -1 );
     }
-}
 
-void Table::add_index_for_record_field( Record * record, field_id_t field_id, MapValueIdToRecord & map )
+    auto it_c = map_field_id_to_column_.find( field_id );
+
+    if( it_c != map_field_id_to_column_.end() && has_record( record ) )
+        clear_column( it_c->second, record->slot_ );
+
+    return true;
+}
+
+void Table::on_load_spilled( Record * record )
+{
+    fault_in( record );
+}
+
+bool Table::get_spilled_data( const Record * record, std::string * data ) const
+{
+    assert( has_record( record ) && record->is_spilled_ );
+
+    auto & s = spill_slots_[ record->slot_ ];
+
+    return spill_file_.read( s.offset, s.size, data );
+}
+
+void Table::set_column_value( field_id_t field_id, const Value & value, Record * record )
+{
+    auto it = map_field_id_to_column_.find( field_id );
+
+    if( it == map_field_id_to_column_.end() || has_record( record ) == false )
+        return;
+
+    // the column keeps the same representation as the record, i.e. codes for dictionary fields
+
+    auto it_d = map_field_id_to_dictionary_.find( field_id );
+
+    if( it_d != map_field_id_to_dictionary_.end() )
+        set_column( it->second, record->slot_, Value( it_d->second.encode( value ) ) );
+    else
+        set_column( it->second, record->slot_, value );
+}
+
+void Table::add_columns_for_record( Record * record )
+{
+    for( auto & e : map_field_id_to_column_ )
+    {
+        auto v = record->get_stored_field( e.first );
+
+        if( v )
+            set_column( e.second, record->slot_, * v );
+    }
+}
+
+void Table::set_column( Column & column, uint32_t slot, const Value & value )
+{
+    if( column.is_null( slot ) == false )
+        mem_columns_ -= MemorySize::get_payload( column.get( slot ) );
+
+    column.set( slot, value );
+
+    mem_columns_ += MemorySize::get_payload( column.get( slot ) );
+}
+
+void Table::clear_column( Column & column, uint32_t slot )
+{
+    if( column.is_null( slot ) == false )
+        mem_columns_ -= MemorySize::get_payload( column.get( slot ) );
+
+    column.clear( slot );
+}
+
+void Table::account_record( const Record & record, int sign )
+{
+    mem_records_ += sign * sizeof( Record );
+
+    for( auto & e : record.fields_ )
+    {
+        mem_fields_     += sign * MemorySize::get_field( Value() );
+        mem_payload_    += sign * MemorySize::get_payload( e.second );
+    }
+}
+
+void Table::account_field( field_id_t field_id, const Value & value, int sign ) const
+{
+    // fields with a dictionary store codes, which have no payload
+
+    mem_fields_ += sign * MemorySize::get_field( Value() );
+
+    if( map_field_id_to_dictionary_.count( field_id ) == 0 )
+        mem_payload_ += sign * MemorySize::get_payload( value );
+}
+
+void Table::update_stats( const Record & record, int sign )
+{
+    for( auto & e : record.fields_ )
+    {
+        update_stats( e.first, record.decode( e.first, e.second ), sign );
+    }
+}
+
+void Table::update_stats( field_id_t field_id, const Value & value, int sign )
+{
+    auto & stats = map_field_id_to_stats_[ field_id ];
+
+    if( sign > 0 )
+        stats.add( value );
+    else
+        stats.remove( value );
+}
+
+void Table::account_index_entry( field_id_t field_id, const Value & key, int sign )
+{
+    auto & mem = map_field_id_to_index_memory_.at( field_id );
+
+    mem.num_entries += sign;
+    mem.size        += sign * MemorySize::get_index_entry( key );
+}
+
+MemoryStats Table::get_memory_stats() const
+{
+    MemoryStats res;
+
+    res.num_records = num_records_;
+    res.records     = mem_records_;
+    res.fields      = mem_fields_;
+    res.payload     = mem_payload_;
+    res.metakeys    = mem_metakeys_;
+    res.columns     = mem_columns_;
+
+    for( auto & e : map_field_id_to_index_memory_ )
+    {
+        MemoryStats::Index index = { e.first, e.second.num_entries, e.second.size };
+
+        res.indices.push_back( index );
+    }
+
+    for( auto & e : map_field_id_to_dictionary_ )
+    {
+        res.dictionaries += e.second.get_memory_size();
+    }
+
+    res.allocator_overhead  = arena_.get_reserved_size() - arena_.get_requested_size();
+
+    res.metrics             = metrics_.get_memory_size();
+
+    res.num_spilled_records = num_spilled_;
+    res.spilled             = spill_file_.get_size();
+
+    return res;
+}
+
+bool Table::get_field_stats( field_id_t field_id, FieldStats * res ) const
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    auto it = map_field_id_to_stats_.find( field_id );
+
+    if( it == map_field_id_to_stats_.end() || it->second.get_num_values() == 0 )
+        return false;
+
+    * res = it->second;
+
+    return true;
+}
+
+void Table::analyze()
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    analyze__unlocked();
+}
+
+void Table::analyze__unlocked()
+{
+    std::map<field_id_t,std::vector<Value>> map_field_id_to_values;
+
+    for( auto & e : slots_ )
+    {
+        if( e.record == nullptr )
+            continue;
+
+        Record tmp;
+
+        auto & r = get_view( e.record, & tmp );
+
+        for( auto & f : r.fields_ )
+        {
+            map_field_id_to_values[ f.first ].push_back( r.decode( f.first, f.second ) );
+        }
+    }
+
+    map_field_id_to_stats_.clear();
+
+    for( auto & e : map_field_id_to_values )
+    {
+        map_field_id_to_stats_[ e.first ].rebuild( & e.second );
+    }
+
+    AVDB_LOG_INFO( MODULENAME, "analyze__unlocked: %zu fields", map_field_id_to_stats_.size() );
+}
+
+bool Table::set_memory_budget(
+        uint64_t            budget,
+        const std::string   & spill_filename,
+        std::string         * error_msg )
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    // all records are loaded back, the spill file is started from scratch
+
+    for( auto & e : slots_ )
+    {
+        if( e.record && e.record->is_spilled_ )
+            fault_in( e.record );
+    }
+
+    memory_budget_  = 0;
+
+    lru_.clear();
+    spill_slots_.clear();
+    spill_file_.close();
+
+    if( budget == 0 )
+        return true;
+
+    if( spill_file_.open( error_msg, spill_filename ) == false )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "set_memory_budget: %s", error_msg->c_str() );
+
+        return false;
+    }
+
+    memory_budget_  = budget;
+
+    spill_slots_.resize( slots_.size() );
+
+    for( uint32_t i = 0; i < slots_.size(); ++i )
+    {
+        if( slots_[ i ].record == nullptr )
+            continue;
+
+        auto & s = spill_slots_[ i ];
+
+        s.is_in_lru = true;
+
+        lru_.push_front( i );
+        s.lru_pos   = lru_.begin();
+    }
+
+    enforce_memory_budget();
+
+    AVDB_LOG_INFO( MODULENAME, "set_memory_budget: budget %" PRIu64 ", spill file %s, spilled %zu records", budget, spill_filename.c_str(), num_spilled_.load() );
+
+    return true;
+}
+
+void Table::enforce_memory_budget() const
+{
+    if( memory_budget_ == 0 )
+        return;
+
+    while( mem_fields_ + mem_payload_ > memory_budget_ && lru_.empty() == false )
+    {
+        if( spill_record( lru_.back() ) == false )
+            break;
+    }
+}
+
+bool Table::spill_record( uint32_t slot ) const
+{
+    auto record = slots_[ slot ].record;
+
+    auto & s = spill_slots_[ slot ];
+
+    // a record, which hasn't changed since it was loaded, is still in the file
+
+    if( s.is_clean == false )
+    {
+        std::ostringstream os;
+
+        if( Serializer::save( os, * record ) == false )
+        {
+            AVDB_LOG_ERROR( MODULENAME, "spill_record: cannot serialize record %p", record );
+            return false;
+        }
+
+        auto data = os.str();
+
+        auto b = true;
+
+        if( data.size() <= s.capacity )
+        {
+            b = spill_file_.write( s.offset, data );
+        }
+        else
+        {
+            uint64_t offset;
+
+            b = spill_file_.append( data, & offset );
+
+            if( b )
+            {
+                s.offset    = offset;
+                s.capacity  = static_cast<uint32_t>( data.size() );
+            }
+        }
+
+        if( b == false )
+        {
+            AVDB_LOG_ERROR( MODULENAME, "spill_record: cannot write record %p", record );
+            return false;
+        }
+
+        s.size      = static_cast<uint32_t>( data.size() );
+        s.is_clean  = true;
+    }
+
+    for( auto & e : record->fields_ )
+        account_field( e.first, e.second, -1 );
+
+    Record::VectorField( record->fields_.get_allocator() ).swap( record->fields_ );     // releases the buffer
+    record->is_spilled_ = true;
+
+    lru_.erase( s.lru_pos );
+    s.is_in_lru = false;
+
+    ++num_spilled_;
+
+    return true;
+}
+
+void Table::fault_in( Record * record ) const
+{
+    if( memory_budget_ == 0 )
+        return;
+
+    auto & s = spill_slots_[ record->slot_ ];
+
+    if( record->is_spilled_ == false )
+    {
+        lru_.splice( lru_.begin(), lru_, s.lru_pos );
+        return;
+    }
+
+    std::string data;
+
+    if( spill_file_.read( s.offset, s.size, & data ) == false )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "fault_in: cannot read record %p", record );
+
+        throw std::runtime_error( "Table::fault_in: cannot read spilled record" );
+    }
+
+    std::istringstream is( data );
+
+    record->is_spilled_ = false;
+
+    if( Serializer::load( is, record ) == nullptr )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "fault_in: cannot parse record %p", record );
+
+        throw std::runtime_error( "Table::fault_in: cannot parse spilled record" );
+    }
+
+    record->encode_fields();
+
+    for( auto & e : record->fields_ )
+        account_field( e.first, e.second, 1 );
+
+    lru_.push_front( record->slot_ );
+    s.lru_pos   = lru_.begin();
+    s.is_in_lru = true;
+
+    --num_spilled_;
+}
+
+void Table::fault_in( const std::vector<Record*> & records ) const
+{
+    for( auto & e : records )
+        fault_in( e );
+}
+
+void Table::mark_dirty( const Record * record )
+{
+    if( memory_budget_ && has_record( record ) )
+        spill_slots_[ record->slot_ ].is_clean = false;
+}
+
+const Record & Table::get_view( const Record * record, Record * tmp ) const
+{
+    if( record->is_spilled_ == false )
+        return * record;
+
+    // the copy holds plain values, it has no dictionaries to decode them
+
+    if( load_spilled( record, tmp ) == false )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "get_view: cannot load record %p", record );
+
+        throw std::runtime_error( "Table::get_view: cannot load spilled record" );
+    }
+
+    return * tmp;
+}
+
+bool Table::load_spilled( const Record * record, Record * res ) const
+{
+    std::string data;
+
+    if( get_spilled_data( record, & data ) == false )
+        return false;
+
+    std::istringstream is( data );
+
+    return Serializer::load( is, res ) != nullptr;
+}
+
+
+void Table::cleanup_index_for_record( Record * record )
+{
+    for( auto & e : map_field_id_to_index_ )
+    {
+        cleanup_index_for_record_field( record, e.first, e.second );
+    }
+}
+
+void Table::cleanup_index_for_record_field( Record * record, field_id_t field_id, MapValueIdToRecord & map )
+{
+    Value v;
+
+    if( record->get_field( field_id, & v ) == false )
+        return;
+
+    auto it = map.find( v );
+
+    if( it == map.end() )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "cleanup_index_for_record_field: record %p, field_id %u, cannot find value %s", record, field_id, anyvalue::StrHelper::to_string( v ).c_str() );
+        return;
+    }
+
+    account_index_entry( field_id, it->first, -1 );
+
+    map.erase( it );
+
+    AVDB_LOG_DEBUG( MODULENAME, "cleanup_index_for_record_field: record %p, field_id %u, value %s - OK", record, field_id, anyvalue::StrHelper::to_string( v ).c_str() );
+}
+
+void Table::add_index_for_record( Record * record )
+{
+    for( auto & e : map_field_id_to_index_ )
+    {
+        add_index_for_record_field( record, e.first, e.second );
+    }
+}
+
+void Table::add_index_for_record_field( Record * record, field_id_t field_id, MapValueIdToRecord & map )
+{
+    Value v;
+
+    if( record->get_field( field_id, & v ) == false )
+        return;
+
+    auto it = map.insert( std::make_pair( v, record ) );
+
+    if( it.second == false )
+    {
+        AVDB_LOG_ERROR( MODULENAME, "add_index_for_record_field: record %p, field_id %u, duplicate value %s", record, field_id, anyvalue::StrHelper::to_string( v ).c_str() );
+        return;
+    }
+
+    account_index_entry( field_id, it.first->first, 1 );
+
+    AVDB_LOG_DEBUG( MODULENAME, "add_index_for_record_field: record %p, field_id %u, value %s - OK", record, field_id, anyvalue::StrHelper::to_string( v ).c_str() );
+}
+
+bool Table::build_indices( const Status & status, std::string * error_msg )
+{
+    std::vector<std::pair<field_id_t,MapValueIdToRecord*>> indices;
+
+    for( auto & e : map_field_id_to_index_ )
+    {
+        indices.push_back( std::make_pair( e.first, & e.second ) );
+    }
+
+    std::map<field_id_t,const Status::VectorOrdinal*> persisted;
+
+    if( status.is_index_valid )
+    {
+        for( auto & e : status.indices )
+            persisted[ e.first ] = & e.second;
+    }
+
+    std::vector<std::string> error_msgs( indices.size() );
+
+    auto build = [&]( std::size_t i )
+            {
+                auto field_id   = indices[ i ].first;
+                auto map        = indices[ i ].second;
+
+                auto it = persisted.find( field_id );
+
+                if( it != persisted.end() )
+                {
+                    if( restore_index_for_field( field_id, status.records, * it->second, map ) )
+                        return;
+
+                    map->clear();   // persisted index is broken, rebuild it
+                }
+
+                build_index_for_field( field_id, map, & error_msgs[ i ] );
+            };
+
+    // indices are independent, so each of them is built in its own thread, unless the table is too small to pay off
+
+    static const std::size_t MIN_RECORDS_FOR_PARALLEL_BUILD = 10000;
+
+    if( num_records_ < MIN_RECORDS_FOR_PARALLEL_BUILD )
+    {
+        for( std::size_t i = 0; i < indices.size(); ++i )
+            build( i );
+    }
+    else
+    {
+        run_parallel( indices.size(), build );
+    }
+
+    for( auto & e : error_msgs )
+    {
+        if( e.empty() == false )
+        {
+            * error_msg = e;
+            return false;
+        }
+    }
+
+    for( auto & e : indices )
+    {
+        for( auto & k : * e.second )
+            account_index_entry( e.first, k.first, 1 );
+    }
+
+    return true;
+}
+
+bool Table::build_index_for_field( field_id_t field_id, MapValueIdToRecord * map, std::string * error_msg ) const
+{
+    typedef std::pair<Value,Record*> ValueRecord;
+
+    std::vector<ValueRecord> values;
+
+    values.reserve( num_records_ );
+
+    for( auto & e : slots_ )
+    {
+        Value v;
+
+        if( e.record && e.record->get_field( field_id, & v ) )
+            values.push_back( ValueRecord( std::move( v ), e.record ) );
+    }
+
+    std::less<Value> less;
+
+    std::sort( values.begin(), values.end(), [&less]( const ValueRecord & a, const ValueRecord & b ) { return less( a.first, b.first ); } );
+
+    // duplicates are neighbours in the sorted run
+
+    for( std::size_t i = 1; i < values.size(); ++i )
+    {
+        if( less( values[ i - 1 ].first, values[ i ].first ) == false )
+        {
+            * error_msg = "field id " + std::to_string( field_id ) + ", value " + anyvalue::StrHelper::to_string( values[ i ].first ) + " already exists";
+
+            return false;
+        }
+    }
+
+    // input is sorted, so every insertion goes to the end in amortized constant time
+
+    for( auto & e : values )
+    {
+        map->emplace_hint( map->end(), std::move( e.first ), e.second );
+    }
+
+    return true;
+}
+
+bool Table::restore_index_for_field( field_id_t field_id, const std::vector<Record*> & records, const Status::VectorOrdinal & ordinals, MapValueIdToRecord * map ) const
+{
+    // a stale or truncated index would silently leave records out
+
+    auto num_with_field = std::count_if( records.begin(), records.end(), [field_id]( const Record * r ) { return r->has_field( field_id ); } );
+
+    if( std::size_t( num_with_field ) != ordinals.size() )
+    {
+        AVDB_LOG_WARN( MODULENAME, "restore_index_for_field: field id %u, persisted index has %zu entries, %zu records have the field, rebuilding",
+                unsigned( field_id ), ordinals.size(), std::size_t( num_with_field ) );
+
+        return false;
+    }
+
+    std::vector<bool> is_used( records.size(), false );
+
+    for( auto ord : ordinals )
+    {
+        if( ord >= records.size() || is_used[ ord ] )
+            return false;
+
+        is_used[ ord ] = true;
+
+        auto r = records[ ord ];
+
+        Value v;
+
+        if( r->get_field( field_id, & v ) == false )
+            return false;
+
+        // keys come in sorted order, so the hint is always right
+        map->emplace_hint( map->end(), std::move( v ), r );
+    }
+
+    return map->size() == ordinals.size();
+}
+
+bool Table::validate_keys_of_new_record( const Record & record, std::string * error_msg ) const
+{
+    for( auto & e : map_field_id_to_index_ )
+    {
+        if( validate_keys_of_new_record_field( record, e.first, e.second, error_msg ) == false )
+            return false;
+    }
+
+    return true;
+}
+
+bool Table::validate_keys_of_new_record_field( const Record & record, field_id_t field_id, const MapValueIdToRecord & map, std::string * error_msg ) const
+{
+    Value v;
+
+    if( record.get_field( field_id, & v ) == false )
+        return true;
+
+    auto it = map.find( v );
+
+    if( it != map.end() )
+    {
+        * error_msg = "field id " + std::to_string( field_id ) + ", value " + anyvalue::StrHelper::to_string( v ) + " already exists";
+
+        return false;
+    }
+
+    return true;
+}
+
+Record* Table::find__unlocked( field_id_t field_id, const Value & value )
+{
+    assert( is_inited_ );
+
+    METRICS_SCOPE( metrics_, operation_e::FIND );
+
+    enforce_memory_budget();
+
+    auto it = map_field_id_to_index_.find( field_id );
+
+    if( it == map_field_id_to_index_.end() )
+    {
+        return nullptr;
+    }
+
+    auto & map = it->second;
+
+    auto it2 = map.find( value );
+
+    if( it2 == map.end() )
+    {
+        return nullptr;
+    }
+
+    fault_in( it2->second );
+
+    return it2->second;
+}
+
+const Record* Table::find__unlocked( field_id_t field_id, const Value & value ) const
+{
+    assert( is_inited_ );
+
+    METRICS_SCOPE( metrics_, operation_e::FIND );
+
+    enforce_memory_budget();
+
+    auto it = map_field_id_to_index_.find( field_id );
+
+    if( it == map_field_id_to_index_.end() )
+    {
+        return nullptr;
+    }
+
+    auto & map = it->second;
+
+    auto it2 = map.find( value );
+
+    if( it2 == map.end() )
+    {
+        return nullptr;
+    }
+
+    fault_in( it2->second );
+
+    return it2->second;
+}
+
+Table::ResolvedCondition Table::resolve_condition( const SelectCondition & condition ) const
+{
+    ResolvedCondition res = { & condition, false, Value(), & compare_any };
+
+    auto field = schema_.find( condition.field_id );
+
+    if( field && field->type == condition.value.get_type() )
+    {
+        // values of the field are known to have the same type, no need to check it per record
+
+        switch( field->type )
+        {
+        case anyvalue::type_e::BOOL:
+            res.compare = & compare_typed_values<bool>;
+            break;
+        case anyvalue::type_e::INT:
+            res.compare = & compare_typed_values<int64_t>;
+            break;
+        case anyvalue::type_e::DOUBLE:
+            res.compare = & compare_typed_values<double>;
+            break;
+        case anyvalue::type_e::STRING:
+            res.compare = & compare_typed_values<std::string>;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if( condition.op != anyvalue::comparison_type_e::EQ && condition.op != anyvalue::comparison_type_e::NEQ )
+        return res;
+
+    auto it = map_field_id_to_dictionary_.find( condition.field_id );
+
+    if( it == map_field_id_to_dictionary_.end() )
+        return res;
+
+    // a value missing in the dictionary gets INVALID_CODE, which is not equal to any stored code
+
+    res.is_encoded  = true;
+    res.code        = Value( it->second.find_code( condition.value ) );
+
+    return res;
+}
+
+std::vector<Table::ResolvedCondition> Table::resolve_conditions( const std::vector<SelectCondition> & conditions ) const
+{
+    std::vector<ResolvedCondition> res;
+
+    res.reserve( conditions.size() );
+
+    for( auto & c : conditions )
+    {
+        res.push_back( resolve_condition( c ) );
+    }
+
+    return res;
+}
+
+bool Table::is_matching( const Record & r, const ResolvedCondition & condition )
+{
+    if( condition.is_encoded )
+    {
+        auto v = r.get_stored_field( condition.condition->field_id );
+
+        return v && anyvalue::compare_values( condition.condition->op, * v, condition.code );
+    }
+
+    auto field_id = condition.condition->field_id;
+
+    auto v = r.get_stored_field( field_id );
+
+    if( v )
+    {
+        if( condition.compare( condition.condition->op, r.decode( field_id, * v ), condition.condition->value ) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Table::is_matching( const Record & r, bool is_or, const std::vector<ResolvedCondition> & conditions )
+{
+    bool has_found_one = false;
+
+    for( auto & c : conditions )
+    {
+        if( r.has_field( c.condition->field_id ) == false )
+        {
+            if( is_or )
+                continue;
+            else
+                return false;
+        }
+
+        if( is_matching( r, c ) == false )
+        {
+            if( is_or )
+            {
+                continue;
+            }
+            else
+                return false;
+        }
+        else
+        {
+            if( is_or )
+                return true;
+
+            has_found_one   = true;
+        }
+    }
+
+    return has_found_one;
+}
+
+bool Table::is_matching_any( const Record * r, bool is_or, const std::vector<ResolvedCondition> & conditions, const std::vector<ResolvedCondition> & plain_conditions ) const
+{
+    if( r->is_spilled_ == false )
+        return is_matching( * r, is_or, conditions );
+
+    // spilled records are checked on a temporary copy, only matching ones are loaded
+
+    Record tmp;
+
+    return is_matching( get_view( r, & tmp ), is_or, plain_conditions );
+}
+
+std::vector<Table::ResolvedCondition> Table::get_plain_conditions( const std::vector<ResolvedCondition> & conditions )
+{
+    auto res = conditions;
+
+    for( auto & e : res )
+        e.is_encoded = false;
+
+    return res;
+}
+
+std::vector<Record*> Table::get_records__unlocked() const
+{
+    assert( is_inited_ );
+
+    enforce_memory_budget();
+
+    std::vector<Record*> res;
+
+    res.reserve( num_records_ );
+
+    for( auto & e : slots_ )
+    {
+        if( e.record )
+            res.push_back( e.record );
+    }
+
+    fault_in( res );
+
+    return res;
+}
+
+bool Table::has_index( field_id_t field_id ) const
+{
+    return map_field_id_to_index_.count( field_id ) > 0;
+}
+
+std::vector<Record*> Table::select__unlocked( field_id_t field_id, anyvalue::comparison_type_e op, const Value & value ) const
+{
+    SelectCondition condition;
+
+    condition.field_id  = field_id;
+    condition.op        = op;
+    condition.value     = value;
+
+    return select__unlocked( condition );
+}
+
+std::vector<Record*> Table::select__unlocked( const SelectCondition & condition ) const
+{
+    return select__unlocked( false, std::vector<SelectCondition>( 1, condition ) );
+}
+
+std::vector<Record*> Table::select__unlocked( bool is_or, const std::vector<SelectCondition> & conditions ) const
+{
+    return select__unlocked( is_or, conditions, SelectOptions() );
+}
+
+std::vector<Record*> Table::select__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const SelectOptions & options ) const
+{
+    QueryPlan plan;
+
+    return select__unlocked( is_or, conditions, options, true, & plan );
+}
+
+std::vector<Record*> Table::select__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const SelectOptions & options, bool is_loaded, QueryPlan * plan ) const
+{
+    assert( is_inited_ );
+
+    METRICS_SCOPE( metrics_, operation_e::SELECT );
+
+    auto start = std::chrono::steady_clock::now();
+
+    enforce_memory_budget();
+
+    std::vector<Record*>  res;
+
+    auto resolved = resolve_conditions( conditions );
+
+    * plan = plan_select( is_or, & resolved );
+
+    plan_order( options, plan );
+
+    auto is_descending = options.order_by.empty() == false && options.order_by.front().is_descending;
+
+    // without sorting, the first matches are already the result
+
+    auto num_needed = options.limit > SelectOptions::NO_LIMIT - options.offset ? SelectOptions::NO_LIMIT : options.offset + options.limit;
+
+    auto max_matches = options.order_by.empty() || plan->is_index_order ? num_needed : SelectOptions::NO_LIMIT;
+
+    std::size_t num_scanned = 0;
+
+    execute_plan( * plan, resolved, is_descending, max_matches, & res, & num_scanned );
+
+    auto num_matched = res.size();
+
+    if( plan->is_index_order || options.order_by.empty() )
+    {
+        if( res.size() > num_needed )
+            res.resize( num_needed );
+
+        res.erase( res.begin(), res.begin() + std::min( options.offset, res.size() ) );
+    }
+    else
+    {
+        sort_records( options, & res );
+    }
+
+    if( is_loaded )
+        fault_in( res );
+
+    plan->rows_scanned  = num_scanned;
+    plan->rows_matched  = num_matched;
+
+    METRICS_ADD_ROWS( metrics_, num_scanned, res.size() );
+
+    if( query_log_.is_enabled() )
+    {
+        log_query( describe_conditions( is_or, conditions, false ), describe_conditions( is_or, conditions, true ),
+                plan->access_path, num_scanned, res.size(), start );
+    }
+
+    return res;
+}
+
+QueryPlan Table::explain( bool is_or, const std::vector<SelectCondition> & conditions ) const
+{
+    return explain( is_or, conditions, SelectOptions() );
+}
+
+QueryPlan Table::explain( bool is_or, const std::vector<SelectCondition> & conditions, const SelectOptions & options ) const
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    return explain__unlocked( is_or, conditions, options );
+}
+
+QueryPlan Table::explain__unlocked( bool is_or, const std::vector<SelectCondition> & conditions ) const
+{
+    return explain__unlocked( is_or, conditions, SelectOptions() );
+}
+
+QueryPlan Table::explain__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const SelectOptions & options ) const
+{
+    QueryPlan res;
+
+    select__unlocked( is_or, conditions, options, true, & res );
+
+    return res;
+}
+
+ResultSet Table::select_fields( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<field_id_t> & field_ids ) const
+{
+    return select_fields( is_or, conditions, field_ids, SelectOptions() );
+}
+
+ResultSet Table::select_fields( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<field_id_t> & field_ids, const SelectOptions & options ) const
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    return select_fields__unlocked( is_or, conditions, field_ids, options );
+}
+
+ResultSet Table::select_fields__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<field_id_t> & field_ids, const SelectOptions & options ) const
+{
+    QueryPlan plan;
+
+    // spilled records are copied from the spill file, they are not brought back to memory
+
+    auto records = select__unlocked( is_or, conditions, options, false, & plan );
+
+    ResultSet res( field_ids );
+
+    res.reserve( records.size() );
+
+    for( auto r : records )
+    {
+        Record tmp;
+
+        res.add_row( get_view( r, & tmp ) );
+    }
+
+    return res;
+}
+
+double Table::estimate_selectivity( const ResolvedCondition & condition ) const
+{
+    auto field_id   = condition.condition->field_id;
+    auto op         = condition.condition->op;
+    auto & value    = condition.condition->value;
+
+    if( op == anyvalue::comparison_type_e::EQ && map_field_id_to_index_.count( field_id ) && num_records_ > 0 )
+        return 1.0 / num_records_;  // keys are unique
+
+    auto it = map_field_id_to_stats_.find( field_id );
+
+    if( it == map_field_id_to_stats_.end() || num_records_ == 0 )
+    {
+        switch( op )
+        {
+        case anyvalue::comparison_type_e::EQ:   return SELECTIVITY_EQ;
+        case anyvalue::comparison_type_e::NEQ:  return SELECTIVITY_NEQ;
+        default:                                return SELECTIVITY_RANGE;
+        }
+    }
+
+    auto & stats = it->second;
+
+    // records without the field match no condition on it
+
+    auto present = 1 - stats.get_missing_share( num_records_ );
+
+    switch( op )
+    {
+    case anyvalue::comparison_type_e::EQ:
+        return present * stats.estimate_eq( value );
+
+    case anyvalue::comparison_type_e::NEQ:
+        return present * ( 1 - stats.estimate_eq( value ) );
+
+    default:
+        break;
+    }
+
+    auto is_less = op == anyvalue::comparison_type_e::LT || op == anyvalue::comparison_type_e::LE;
+
+    // GT is the complement of LE, GE is the complement of LT
+
+    auto less = stats.estimate_less( value, op == anyvalue::comparison_type_e::LE || op == anyvalue::comparison_type_e::GT );
+
+    if( less < 0 )
+        return present * SELECTIVITY_RANGE;
+
+    return present * ( is_less ? less : 1 - less );
+}
+
+double Table::estimate_range( field_id_t field_id, const QueryPlan::Bound & lower_bound, const QueryPlan::Bound & upper_bound ) const
+{
+    auto it = map_field_id_to_stats_.find( field_id );
+
+    if( it == map_field_id_to_stats_.end() || num_records_ == 0 )
+        return -1;
+
+    auto & stats = it->second;
+
+    double less_upper = 1;
+    double less_lower = 0;
+
+    if( upper_bound.is_set )
+        less_upper = stats.estimate_less( upper_bound.value, upper_bound.is_inclusive );
+
+    if( lower_bound.is_set )
+        less_lower = stats.estimate_less( lower_bound.value, lower_bound.is_inclusive == false );
+
+    if( less_upper < 0 || less_lower < 0 )
+        return -1;
+
+    return ( 1 - stats.get_missing_share( num_records_ ) ) * std::max( 0.0, less_upper - less_lower );
+}
+
+QueryPlan Table::plan_select( bool is_or, std::vector<ResolvedCondition> * resolved ) const
+{
+    QueryPlan res;
+
+    res.is_or   = is_or;
+
+    std::vector<double> selectivities;
+
+    for( auto & c : * resolved )
+        selectivities.push_back( estimate_selectivity( c ) );
+
+    // conditions, which decide the outcome most likely, are evaluated first
+
+    std::vector<std::size_t> order( resolved->size() );
+
+    for( std::size_t i = 0; i < order.size(); ++i )
+        order[ i ] = i;
+
+    std::stable_sort( order.begin(), order.end(),
+            [&]( std::size_t a, std::size_t b )
+            {
+                return is_or ? selectivities[ a ] > selectivities[ b ] : selectivities[ a ] < selectivities[ b ];
+            } );
+
+    std::vector<ResolvedCondition> sorted;
+
+    double share = 1;
+
+    for( auto i : order )
+    {
+        auto & c = ( * resolved )[ i ];
+
+        sorted.push_back( c );
+
+        res.conditions.push_back( { c.condition->field_id, c.condition->op, c.condition->value, selectivities[ i ] } );
+
+        share *= is_or ? 1 - selectivities[ i ] : selectivities[ i ];
+    }
+
+    resolved->swap( sorted );
+
+    double n = num_records_;
+
+    // no conditions select all records
+
+    res.estimated_rows_matched  = resolved->empty() ? n : is_or ? n * ( 1 - share ) : n * share;
+
+    res.access_path             = access_path_e::SCAN;
+    res.cost                    = n * COST_SCAN;
+    res.estimated_rows_scanned  = n;
+
+    auto is_all_columnar = resolved->empty() == false && std::all_of( resolved->begin(), resolved->end(),
+            [this]( const ResolvedCondition & c ) { return is_columnar( c ); } );
+
+    if( is_all_columnar && n * COST_COLUMNAR < res.cost )
+    {
+        res.access_path = access_path_e::COLUMNAR;
+        res.cost        = n * COST_COLUMNAR;
+    }
+
+    // if all conditions must hold, conditions on a key narrow the records down to a range of its index
+
+    if( is_or && resolved->size() > 1 )
+        return res;
+
+    for( auto & e : map_field_id_to_index_ )
+    {
+        QueryPlan::Bound lower_bound = { false, false, Value() };
+        QueryPlan::Bound upper_bound = { false, false, Value() };
+
+        bool is_eq = false;
+
+        double range_share = 1;
+
+        for( auto & c : * resolved )
+        {
+            if( c.condition->field_id != e.first )
+                continue;
+
+            auto & value = c.condition->value;
+
+            // ranges are only taken, if all keys have the type of the value, otherwise they are not contiguous in the index
+
+            auto is_typed = c.compare != & compare_any;
+
+            switch( c.condition->op )
+            {
+            case anyvalue::comparison_type_e::EQ:
+                tighten_lower_bound( & lower_bound, value, true );
+                tighten_upper_bound( & upper_bound, value, true );
+                is_eq = true;
+                break;
+
+            case anyvalue::comparison_type_e::GT:
+            case anyvalue::comparison_type_e::GE:
+                if( is_typed == false )
+                    continue;
+                tighten_lower_bound( & lower_bound, value, c.condition->op == anyvalue::comparison_type_e::GE );
+                range_share *= SELECTIVITY_RANGE;
+                break;
+
+            case anyvalue::comparison_type_e::LT:
+            case anyvalue::comparison_type_e::LE:
+                if( is_typed == false )
+                    continue;
+                tighten_upper_bound( & upper_bound, value, c.condition->op == anyvalue::comparison_type_e::LE );
+                range_share *= SELECTIVITY_RANGE;
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if( lower_bound.is_set == false && upper_bound.is_set == false )
+            continue;
+
+        auto share = is_eq ? -1 : estimate_range( e.first, lower_bound, upper_bound );
+
+        if( share >= 0 )
+            range_share = share;
+
+        auto rows = is_eq ? std::min( n, 1.0 ) : n * range_share;
+
+        if( rows * COST_INDEX >= res.cost )
+            continue;
+
+        res.access_path             = access_path_e::INDEX;
+        res.index_field_id          = e.first;
+        res.lower_bound             = lower_bound;
+        res.upper_bound             = upper_bound;
+        res.cost                    = rows * COST_INDEX;
+        res.estimated_rows_scanned  = rows;
+    }
+
+    return res;
+}
+
+void Table::plan_order( const SelectOptions & options, QueryPlan * plan ) const
+{
+    if( options.order_by.empty() )
+        return;
+
+    auto field_id = options.order_by.front().field_id;
+
+    // keys are unique, so the order of the index is the full order, further sort keys don't matter
+
+    if( plan->access_path == access_path_e::INDEX && plan->index_field_id == field_id )
+    {
+        plan->is_index_order = true;
+        return;
+    }
+
+    auto has_limit = options.limit != SelectOptions::NO_LIMIT;
+
+    auto it_s = map_field_id_to_stats_.find( field_id );
+
+    // records missing in the index would be lost, unless all records have the field
+
+    auto is_index_complete = num_records_ > 0 && it_s != map_field_id_to_stats_.end() && it_s->second.get_num_values() == num_records_;
+
+    if( has_limit && is_index_complete && map_field_id_to_index_.count( field_id ) )
+    {
+        double n        = num_records_;
+        double needed   = static_cast<double>( options.offset ) + options.limit;
+        double share    = plan->estimated_rows_matched / n;
+
+        // matches are expected evenly spread over the index
+
+        auto rows       = share > 0 ? std::min( n, needed / share ) : n;
+        auto sort_cost  = plan->estimated_rows_matched * std::log2( std::max( 2.0, std::min( needed, plan->estimated_rows_matched ) ) ) * COST_SORT;
+
+        if( rows * COST_INDEX < plan->cost + sort_cost )
+        {
+            plan->access_path               = access_path_e::INDEX;
+            plan->index_field_id            = field_id;
+            plan->lower_bound               = { false, false, Value() };
+            plan->upper_bound               = { false, false, Value() };
+            plan->cost                      = rows * COST_INDEX;
+            plan->estimated_rows_scanned    = rows;
+            plan->is_index_order            = true;
+            return;
+        }
+    }
+
+    plan->is_top_k = has_limit;
+}
+
+void Table::execute_plan( const QueryPlan & plan, const std::vector<ResolvedCondition> & resolved, bool is_descending, std::size_t max_matches, std::vector<Record*> * res, std::size_t * num_scanned ) const
+{
+    auto plain = get_plain_conditions( resolved );
+
+    auto visit = [&]( Record * record )
+            {
+                ++( * num_scanned );
+
+                if( resolved.empty() || is_matching_any( record, plan.is_or, resolved, plain ) )
+                    res->push_back( record );
+
+                return res->size() < max_matches;
+            };
+
+    * num_scanned = 0;
+
+    if( max_matches == 0 )
+        return;
+
+    switch( plan.access_path )
+    {
+    case access_path_e::INDEX:
+    {
+        if( plan.is_empty_range() )
+            return;
+
+        auto & map = map_field_id_to_index_.at( plan.index_field_id );
+
+        auto it = map.begin();
+        auto end = map.end();
+
+        if( plan.lower_bound.is_set )
+            it = plan.lower_bound.is_inclusive ? map.lower_bound( plan.lower_bound.value ) : map.upper_bound( plan.lower_bound.value );
+
+        if( plan.upper_bound.is_set )
+            end = plan.upper_bound.is_inclusive ? map.upper_bound( plan.upper_bound.value ) : map.lower_bound( plan.upper_bound.value );
+
+        if( plan.is_index_order && is_descending )
+        {
+            for( auto r = MapValueIdToRecord::const_reverse_iterator( end ); r != MapValueIdToRecord::const_reverse_iterator( it ); ++r )
+            {
+                if( visit( r->second ) == false )
+                    break;
+            }
+        }
+        else
+        {
+            for( ; it != end; ++it )
+            {
+                if( visit( it->second ) == false )
+                    break;
+            }
+        }
+
+        break;
+    }
+
+    case access_path_e::COLUMNAR:
+        * num_scanned = num_records_;
+
+        select_columnar( plan.is_or, resolved, res );
+        break;
+
+    case access_path_e::SCAN:
+        for( auto & e : slots_ )
+        {
+            if( e.record && visit( e.record ) == false )
+                break;
+        }
+        break;
+    }
+}
+
+void Table::sort_records( const SelectOptions & options, std::vector<Record*> * records ) const
+{
+    struct Item
+    {
+        Record                  * record;
+        std::vector<Value>      keys;
+        std::vector<bool>       is_missing;
+    };
+
+    auto & order_by = options.order_by;
+
+    auto is_before = [&order_by]( const Item & a, const Item & b )
+            {
+                for( std::size_t i = 0; i < order_by.size(); ++i )
+                {
+                    if( a.is_missing[ i ] != b.is_missing[ i ] )
+                        return b.is_missing[ i ];
+
+                    if( a.is_missing[ i ] )
+                        continue;
+
+                    if( a.keys[ i ] < b.keys[ i ] )
+                        return order_by[ i ].is_descending == false;
+
+                    if( b.keys[ i ] < a.keys[ i ] )
+                        return order_by[ i ].is_descending;
+                }
+
+                return a.record->slot_ < b.record->slot_;   // keeps the result stable
+            };
+
+    auto num_needed = options.limit > SelectOptions::NO_LIMIT - options.offset ? SelectOptions::NO_LIMIT : options.offset + options.limit;
+
+    // the heap keeps the first num_needed items, its top is the last of them
+
+    std::vector<Item> heap;
+
+    heap.reserve( std::min( num_needed, records->size() ) );
+
+    for( auto r : * records )
+    {
+        if( num_needed == 0 )
+            break;
+
+        Item item = { r, std::vector<Value>( order_by.size() ), std::vector<bool>( order_by.size() ) };
+
+        Record tmp;
+
+        auto & view = get_view( r, & tmp );
+
+        for( std::size_t i = 0; i < order_by.size(); ++i )
+            item.is_missing[ i ] = view.get_field( order_by[ i ].field_id, & item.keys[ i ] ) == false;
+
+        if( heap.size() < num_needed )
+        {
+            heap.push_back( std::move( item ) );
+            std::push_heap( heap.begin(), heap.end(), is_before );
+        }
+        else if( is_before( item, heap.front() ) )
+        {
+            std::pop_heap( heap.begin(), heap.end(), is_before );
+            heap.back() = std::move( item );
+            std::push_heap( heap.begin(), heap.end(), is_before );
+        }
+    }
+
+    std::sort_heap( heap.begin(), heap.end(), is_before );
+
+    records->clear();
+
+    for( std::size_t i = options.offset; i < heap.size(); ++i )
+        records->push_back( heap[ i ].record );
+}
+
+std::vector<AggregateRow> Table::aggregate( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<Aggregate> & aggregates ) const
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    return aggregate__unlocked( is_or, conditions, aggregates, false, 0 );
+}
+
+std::vector<AggregateRow> Table::aggregate( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<Aggregate> & aggregates, field_id_t group_by ) const
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    return aggregate__unlocked( is_or, conditions, aggregates, true, group_by );
+}
+
+std::vector<AggregateRow> Table::aggregate__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<Aggregate> & aggregates ) const
+{
+    return aggregate__unlocked( is_or, conditions, aggregates, false, 0 );
+}
+
+std::vector<AggregateRow> Table::aggregate__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<Aggregate> & aggregates, field_id_t group_by ) const
+{
+    return aggregate__unlocked( is_or, conditions, aggregates, true, group_by );
+}
+
+std::vector<AggregateRow> Table::aggregate__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<Aggregate> & aggregates, bool has_group_by, field_id_t group_by ) const
 {
-    Value v;
+    assert( is_inited_ );
 
-    if( record->get_field( field_id, & v ) == false )
-        return;
+    METRICS_SCOPE( metrics_, operation_e::SELECT );
 
-    auto b = map.insert( std::make_pair( v, record ) ).second;
+    enforce_memory_budget();
 
-    if( b == false )
+    auto resolved = resolve_conditions( conditions );
+
+    std::size_t num_scanned = 0;
+
+    if( has_group_by == false )
     {
-        dummy_log_error( MODULENAME, "add_index_for_record_field: record %p, field_id %u, duplicate value %s", record, field_id, anyvalue::StrHelper::to_string( v ).c_str() );
-        return;
+        AggregateRow row;
+
+        if( aggregate_by_index( is_or, resolved, aggregates, & row, & num_scanned ) )
+        {
+            METRICS_ADD_ROWS( metrics_, num_scanned, 1 );
+
+            return std::vector<AggregateRow>( 1, row );
+        }
     }
 
-    dummy_log_debug( MODULENAME, "add_index_for_record_field: record %p, field_id %u, value %s - OK", record, field_id, anyvalue::StrHelper::to_string( v ).c_str() );
-}
+    std::vector<Record*> records;
 
-bool Table::validate_keys_of_new_record( const Record & record, std::string * error_msg ) const
-{
-    for( auto & e : map_field_id_to_index_ )
+    auto plan = plan_select( is_or, & resolved );
+
+    execute_plan( plan, resolved, false, SelectOptions::NO_LIMIT, & records, & num_scanned );
+
+    Aggregator aggregator( aggregates, has_group_by );
+
+    // records are read in place, spilled ones are not brought back to memory
+
+    for( auto r : records )
     {
-        if( validate_keys_of_new_record_field( record, e.first, e.second, error_msg ) == false )
-            return false;
+        Record tmp;
+
+        auto & view = get_view( r, & tmp );
+
+        Value key;
+
+        if( has_group_by && view.get_field( group_by, & key ) )
+            aggregator.add( key, view );
+        else
+            aggregator.add( view );
     }
 
-    return true;
+    METRICS_ADD_ROWS( metrics_, num_scanned, records.size() );
+
+    return aggregator.get_result();
 }
 
-bool Table::validate_keys_of_new_record_field( const Record & record, field_id_t field_id, const MapValueIdToRecord & map, std::string * error_msg ) const
+bool Table::aggregate_by_index( bool is_or, const std::vector<ResolvedCondition> & resolved, const std::vector<Aggregate> & aggregates, AggregateRow * res, std::size_t * num_scanned ) const
 {
-    Value v;
+    for( auto & a : aggregates )
+    {
+        auto is_min_max = ( a.op == aggregate_e::MIN || a.op == aggregate_e::MAX ) && map_field_id_to_index_.count( a.field_id );
 
-    if( record.get_field( field_id, & v ) == false )
-        return true;
+        auto is_count = a.op == aggregate_e::COUNT && resolved.empty();
 
-    auto it = map.find( v );
+        if( is_min_max == false && is_count == false )
+            return false;
+    }
 
-    if( it != map.end() )
+    * res = { false, Value(), std::vector<Value>( aggregates.size() ) };
+
+    auto plain = get_plain_conditions( resolved );
+
+    // the first matching record from the respective end of the index holds the result
+
+    for( std::size_t i = 0; i < aggregates.size(); ++i )
     {
-        * error_msg = "field id " + std::to_string( field_id ) + ", value " + anyvalue::StrHelper::to_string( v ) + " already exists";
+        auto & a = aggregates[ i ];
 
-        return false;
+        if( a.op == aggregate_e::COUNT )
+        {
+            res->values[ i ] = Value( static_cast<int64_t>( num_records_ ) );
+            continue;
+        }
+
+        auto & map = map_field_id_to_index_.at( a.field_id );
+
+        auto is_found = [&]( const MapValueIdToRecord::value_type & e )
+                {
+                    ++( * num_scanned );
+
+                    if( resolved.empty() == false && is_matching_any( e.second, is_or, resolved, plain ) == false )
+                        return false;
+
+                    res->values[ i ] = e.first;
+
+                    return true;
+                };
+
+        if( a.op == aggregate_e::MIN )
+        {
+            for( auto it = map.begin(); it != map.end() && is_found( * it ) == false; ++it )
+                ;
+        }
+        else
+        {
+            for( auto it = map.rbegin(); it != map.rend() && is_found( * it ) == false; ++it )
+                ;
+        }
     }
 
     return true;
 }
 
-Record* Table::find__unlocked( field_id_t field_id, const Value & value )
+std::vector<Record*> Table::select_prefix__unlocked( field_id_t field_id, const std::string & prefix ) const
 {
     assert( is_inited_ );
 
-    auto it = map_field_id_to_index_.find( field_id );
+    METRICS_SCOPE( metrics_, operation_e::SELECT );
 
-    if( it == map_field_id_to_index_.end() )
+    auto start = std::chrono::steady_clock::now();
+
+    enforce_memory_budget();
+
+    std::vector<Record*>  res;
+
+    auto access_path = access_path_e::SCAN;
+
+    auto it = map_field_id_to_column_.find( field_id );
+
+    if( it != map_field_id_to_column_.end() && map_field_id_to_dictionary_.count( field_id ) == 0 )
     {
-        return nullptr;
+        Column::Bitmap selection;
+
+        it->second.select_prefix( prefix, & selection );
+
+        get_records( selection, & res );
+
+        access_path = access_path_e::COLUMNAR;
     }
+    else
+    {
+        for( auto & e : slots_ )
+        {
+            if( e.record == nullptr )
+                continue;
 
-    auto & map = it->second;
+            Record tmp;
 
-    auto it2 = map.find( value );
+            Value v;
 
-    if( it2 == map.end() )
+            if( get_view( e.record, & tmp ).get_field( field_id, & v ) && v.get_type() == anyvalue::type_e::STRING && v.get_string().compare( 0, prefix.size(), prefix ) == 0 )
+                res.push_back( e.record );
+        }
+    }
+
+    fault_in( res );
+
+    METRICS_ADD_ROWS( metrics_, num_records_, res.size() );
+
+    if( query_log_.is_enabled() )
     {
-        return nullptr;
+        auto shape = std::to_string( field_id ) + " PREFIX ?";
+
+        log_query( shape, std::to_string( field_id ) + " PREFIX \"" + prefix + "\"", access_path, num_records_, res.size(), start );
     }
 
-    return it2->second;
+    return res;
 }
 
-const Record* Table::find__unlocked( field_id_t field_id, const Value & value ) const
+std::string Table::describe_conditions( bool is_or, const std::vector<SelectCondition> & conditions, bool has_values )
 {
-    assert( is_inited_ );
-
-    auto it = map_field_id_to_index_.find( field_id );
+    std::string res;
 
-    if( it == map_field_id_to_index_.end() )
+    for( auto & c : conditions )
     {
-        return nullptr;
+        if( res.empty() == false )
+            res += is_or ? " OR " : " AND ";
+
+        res += std::to_string( c.field_id ) + " " + to_string( c.op ) + " ";
+
+        res += has_values ? anyvalue::StrHelper::to_string( c.value ) : std::string( "?" );
     }
 
-    auto & map = it->second;
+    return res;
+}
 
-    auto it2 = map.find( value );
+void Table::log_query( const std::string & shape, const std::string & description, access_path_e access_path, std::size_t num_scanned, std::size_t num_matched, std::chrono::steady_clock::time_point start ) const
+{
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start ).count();
 
-    if( it2 == map.end() )
+    QueryInfo info = { shape, description, access_path, num_scanned, num_matched, static_cast<uint64_t>( elapsed_us ), std::chrono::system_clock::now() };
+
+    if( query_log_.add( std::move( info ) ) )
     {
-        return nullptr;
+        AVDB_LOG_WARN( MODULENAME, "slow query: %s, %s, scanned %zu, matched %zu, %lld us", description.c_str(), to_string( access_path ), num_scanned, num_matched, static_cast<long long>( elapsed_us ) );
     }
+}
 
-    return it2->second;
+void Table::enable_query_log( uint32_t threshold_us, std::size_t max_entries )
+{
+    query_log_.enable( threshold_us, max_entries );
 }
 
-bool Table::is_matching( const Record & r, const SelectCondition & condition )
+void Table::disable_query_log()
 {
-    Value v;
+    query_log_.disable();
+}
 
-    if( r.get_field( condition.field_id, & v ) )
-    {
-        if( anyvalue::compare_values( condition.op, v, condition.value ) )
-        {
-            return true;
-        }
-    }
+std::vector<QueryInfo> Table::get_slow_queries() const
+{
+    return query_log_.get_slow_queries();
+}
 
-    return false;
+std::vector<QueryShapeStats> Table::get_query_stats() const
+{
+    return query_log_.get_shape_stats();
 }
 
-bool Table::is_matching( const Record & r, bool is_or, const std::vector<SelectCondition> & conditions )
+bool Table::is_columnar( const ResolvedCondition & condition ) const
 {
-    bool has_found_one = false;
+    auto field_id = condition.condition->field_id;
+
+    if( map_field_id_to_column_.count( field_id ) == 0 )
+        return false;
+
+    // columns of dictionary fields hold codes, so only code comparisons can be done on them
+
+    return condition.is_encoded || map_field_id_to_dictionary_.count( field_id ) == 0;
+}
+
+void Table::select_columnar( bool is_or, const std::vector<ResolvedCondition> & conditions, std::vector<Record*> * res ) const
+{
+    Column::Bitmap selection;
+    Column::Bitmap matches;
+
+    Column::init_bitmap( slots_.size(), ! is_or, & selection );
 
     for( auto & c : conditions )
     {
-        Value v;
+        auto & column = map_field_id_to_column_.at( c.condition->field_id );
 
-        if( r.get_field( c.field_id, & v ) == false )
-        {
-            if( is_or )
-                continue;
-            else
-                return false;
-        }
+        column.select( c.condition->op, c.is_encoded ? c.code : c.condition->value, & matches );
 
-        if( anyvalue::compare_values( c.op, v, c.value ) == false )
-        {
-            if( is_or )
-            {
-                continue;
-            }
-            else
-                return false;
-        }
+        if( is_or )
+            Column::or_bitmap( matches, & selection );
         else
-        {
-            if( is_or )
-                return true;
-
-            has_found_one   = true;
-        }
+            Column::and_bitmap( matches, & selection );
     }
 
-    return has_found_one;
+    get_records( selection, res );
 }
 
-std::vector<Record*> Table::select__unlocked( field_id_t field_id, anyvalue::comparison_type_e op, const Value & value ) const
+void Table::get_records( const Column::Bitmap & selection, std::vector<Record*> * res ) const
 {
-    SelectCondition condition;
+    for( std::size_t w = 0; w < selection.size(); ++w )
+    {
+        auto word = selection[ w ];
 
-    condition.field_id  = field_id;
-    condition.op        = op;
-    condition.value     = value;
+        while( word )
+        {
+            auto bit = __builtin_ctzll( word );
 
-    return select__unlocked( condition );
+            word &= word - 1;
+
+            res->push_back( slots_[ w * 64 + bit ].record );
+        }
+    }
 }
 
-std::vector<Record*> Table::select__unlocked( const SelectCondition & condition ) const
+uint64_t Table::get_change_count__unlocked() const
 {
-    assert( is_inited_ );
-
-    std::vector<Record*>  res;
+    return change_count_;
+}
 
-    for( auto & e : records_ )
-    {
-        if( is_matching( * e, condition ) )
-            res.push_back( e );
-    }
+void Table::set_persist_index( bool is_enabled )
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
-    return res;
+    is_index_persisted_ = is_enabled;
 }
 
-std::vector<Record*> Table::select__unlocked( bool is_or, const std::vector<SelectCondition> & conditions ) const
+void Table::set_columnar( const std::vector<field_id_t> & field_ids )
 {
-    assert( is_inited_ );
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
 
-    std::vector<Record*>  res;
+    map_field_id_to_column_.clear();
 
-    for( auto & e : records_ )
+    mem_columns_ = 0;
+
+    for( auto & e : field_ids )
     {
-        if( is_matching( * e, is_or, conditions ) )
-            res.push_back( e );
+        map_field_id_to_column_[ e ].resize( slots_.size() );
+
+        mem_columns_ += slots_.size() * Column::SLOT_SIZE;
     }
 
-    return res;
+    for( auto & e : slots_ )
+    {
+        if( e.record )
+            add_columns_for_record( e.record );
+    }
+}
 
+MetricsSnapshot Table::get_metrics() const
+{
+    return metrics_.get_snapshot();
 }
 
 std::mutex & Table::get_mutex() const
@@ -580,72 +2512,86 @@ std::mutex & Table::get_mutex() const
     return mutex_;
 }
 
-bool Table::load_intern( const std::string & filename )
+bool Table::load_intern( std::string * error_msg, const std::string & filename )
 {
-    std::ifstream is( filename );
+    METRICS_SCOPE( metrics_, operation_e::LOAD );
+
+    std::string data;
 
-    if( is.fail() )
+    if( BlockFile::load( error_msg, filename, & data ) == false )
     {
-        dummy_log_warn( MODULENAME, "load_intern: cannot open file %s", filename.c_str() );
+        AVDB_LOG_WARN( MODULENAME, "load_intern: cannot read file %s: %s", filename.c_str(), error_msg->c_str() );
         return false;
     }
 
+    std::istringstream is( data );
+
     auto res = Serializer::load( is, this );
 
     if( res == nullptr )
     {
-        dummy_log_error( MODULENAME, "load_intern: cannot load table" );
+        AVDB_LOG_ERROR( MODULENAME, "load_intern: cannot load table" );
+
+        * error_msg = "cannot parse data";
+
         return false;
     }
 
-    dummy_log_info( MODULENAME, "load_intern: loaded %d entries from %s, number of keys %u, number of metakeys %u", records_.size(), filename.c_str(), map_field_id_to_index_.size(), map_metakey_id_to_value_.size() );
+    AVDB_LOG_INFO( MODULENAME, "load_intern: loaded %zu entries from %s, number of keys %zu, number of metakeys %zu", num_records_.load(), filename.c_str(), map_field_id_to_index_.size(), map_metakey_id_to_value_.size() );
 
     return true;
 }
 
 bool Table::save( std::string * error_msg, const std::string & filename ) const
 {
-    MUTEX_SCOPE_LOCK( mutex_ );
+    return save( error_msg, filename, false );
+}
+
+bool Table::save( std::string * error_msg, const std::string & filename, bool is_compressed ) const
+{
+    METRICS_SCOPE_LOCK( mutex_, metrics_ );
+
+    METRICS_SCOPE( metrics_, operation_e::SAVE );
 
     assert( is_inited_ );
 
     auto temp_name  = filename + ".tmp";
 
-    auto b = save_intern( error_msg, temp_name );
+    auto b = save_intern( error_msg, temp_name, is_compressed );
 
     if( b == false )
         return false;
 
     utils::rename_and_backup( temp_name, filename );
 
-    return true;
+    return BlockFile::sync_directory( error_msg, filename );
 }
 
-bool Table::save_intern( std::string * error_msg, const std::string & filename ) const
+bool Table::save_intern( std::string * error_msg, const std::string & filename, bool is_compressed ) const
 {
-    std::ofstream os( filename );
+    std::ostringstream os;
+
+    auto res = Serializer::save( os, *this );
 
-    if( os.fail() )
+    if( res == false )
     {
-        dummy_log_error( MODULENAME, "save_intern: cannot open credentials file %s", filename.c_str() );
+        AVDB_LOG_ERROR( MODULENAME, "save_intern: cannot serialize data for file %s", filename.c_str()  );
 
-        * error_msg =  "cannot open file " + filename;
+        * error_msg =  "cannot save data into file " + filename;
 
         return false;
     }
 
-    auto res = Serializer::save( os, *this );
+    res = BlockFile::save( error_msg, filename, os.str(), is_compressed );
 
     if( res == false )
     {
-        dummy_log_error( MODULENAME, "save_intern: cannot save credentials into file %s", filename.c_str()  );
-
-        * error_msg =  "cannot save data into file " + filename;
+        AVDB_LOG_ERROR( MODULENAME, "save_intern: cannot save credentials into file %s: %s", filename.c_str(), error_msg->c_str() );
 
         return false;
     }
 
-    dummy_log_info( MODULENAME, "save: saved %d entries, %d metakeys into %s", records_.size(), map_metakey_id_to_value_.size(), filename.c_str() );
+    AVDB_LOG_INFO( MODULENAME, "save: saved %zu entries, %zu metakeys into %s", num_records_.load(), map_metakey_id_to_value_.size(), filename.c_str() );
 
     return true;
 }
@@ -657,15 +2603,82 @@ void Table::get_status( Status * res ) const
         res->index_field_ids.push_back( e.first );
     }
 
-    for( auto & e : records_ )
+    for( auto & e : map_field_id_to_dictionary_ )
+    {
+        res->dictionary_field_ids.push_back( e.first );
+    }
+
+    res->records.reserve( num_records_ );
+
+    for( auto & e : slots_ )
+    {
+        if( e.record )
+            res->records.push_back( e.record );
+    }
+
+    if( is_index_persisted_ )
     {
-        res->records.push_back( e );
+        // free slots are skipped on save, so slots don't match ordinals
+
+        std::vector<uint32_t> slot_to_ordinal( slots_.size() );
+
+        for( std::size_t i = 0; i < res->records.size(); ++i )
+        {
+            slot_to_ordinal[ res->records[ i ]->slot_ ] = static_cast<uint32_t>( i );
+        }
+
+        for( auto & e : map_field_id_to_index_ )
+        {
+            res->indices.push_back( std::make_pair( e.first, Status::VectorOrdinal() ) );
+
+            auto & ordinals = res->indices.back().second;
+
+            ordinals.reserve( e.second.size() );
+
+            for( auto & r : e.second )
+            {
+                ordinals.push_back( slot_to_ordinal[ r.second->slot_ ] );
+            }
+        }
+
+        // an index, which misses records with the field, must not be restored on load
+
+        res->is_index_valid = true;
+
+        for( auto & e : map_field_id_to_index_ )
+        {
+            std::size_t num_with_field = 0;
+
+            for( auto r : res->records )
+            {
+                Record tmp;
+
+                if( get_view( r, & tmp ).has_field( e.first ) )
+                    ++num_with_field;
+            }
+
+            if( num_with_field != e.second.size() )
+            {
+                AVDB_LOG_ERROR( MODULENAME, "get_status: index of field id %u has %zu entries, %zu records have the field", unsigned( e.first ), e.second.size(), num_with_field );
+
+                res->is_index_valid = false;
+            }
+        }
+
+        if( res->is_index_valid == false )
+            res->indices.clear();
     }
 
     for( auto & e : map_metakey_id_to_value_ )
     {
         res->metakeys.push_back( std::make_pair( e.first, e.second ) );
     }
+
+    for( auto & e : map_field_id_to_stats_ )
+    {
+        if( e.second.get_num_values() )
+            res->field_stats.push_back( e );
+    }
 }
 
 bool Table::init_index(
@@ -679,43 +2692,85 @@ bool Table::init_index(
 
         if( b == false )
         {
-            dummy_log_error( MODULENAME, "init_index: index %u already exists", e );
+            AVDB_LOG_ERROR( MODULENAME, "init_index: index %u already exists", e );
 
             return false;
         }
+
+        map_field_id_to_index_memory_[ e ];
     }
 
     return true;
 }
 
-void Table::init_metakeys_from_status( const Status & status )
+void Table::init_dictionaries( const std::vector<field_id_t> & field_ids )
+{
+    for( auto & e : field_ids )
+    {
+        map_field_id_to_dictionary_[ e ];
+    }
+}
+
+void Table::init_metakeys_from_status( Status & status )
 {
-    for( auto e : status.metakeys )
+    for( auto & e : status.metakeys )
     {
-        map_metakey_id_to_value_.insert( std::make_pair( e.first, e.second ) );
+        auto it = map_metakey_id_to_value_.insert( std::make_pair( e.first, std::move( e.second ) ) );
+
+        if( it.second )
+            mem_metakeys_ += MemorySize::get_metakey( it.first->second );
     }
 }
 
-bool Table::init_from_status( std::string * error_msg, const Status & status )
+bool Table::init_from_status( std::string * error_msg, Status & status )
 {
     init_index( status.index_field_ids );
+    init_dictionaries( status.dictionary_field_ids );
+
+    is_index_persisted_ = status.is_index_valid;
+
+    // ingest all records first, then build the indices in bulk
 
     for( auto & e : status.records )
     {
-        std::string error_msg_2;
-
-        auto b = add_loaded_record__unlocked( e, & error_msg_2 );
+        auto b = insert_record( e );
 
         if( b == false )
         {
-            * error_msg = "cannot add record " + StrHelper::to_string( * e ) + ": " + error_msg_2;
+            * error_msg = "cannot add record " + StrHelper::to_string( * e ) + ": record already exists";
 
             return false;
         }
+
+        e->set_parent( this );
+        e->set_dictionaries( & map_field_id_to_dictionary_ );
+
+        account_record( * e, 1 );
+    }
+
+    std::string error_msg_2;
+
+    if( build_indices( status, & error_msg_2 ) == false )
+    {
+        * error_msg = "key validation failure " + error_msg_2;
+
+        return false;
     }
 
     init_metakeys_from_status( status );
 
+    // tables saved by older versions have no statistics
+
+    if( status.field_stats.empty() && status.records.empty() == false )
+    {
+        analyze__unlocked();
+    }
+    else
+    {
+        for( auto & e : status.field_stats )
+            map_field_id_to_stats_[ e.first ] = std::move( e.second );
+    }
+
     return true;
 }
 
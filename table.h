@@ -35,11 +35,23 @@ inline bool operator<( anyvalue::Value const & lhs, anyvalue::Value const & rhs
 }
 
 #include <mutex>            // std::mutex
+#include <atomic>           // std::atomic
 #include <map>              // std::map
-#include <set>              // std::set
+#include <vector>           // std::vector
+#include <list>             // std::list
 
 #include "record.h"         // Record
 #include "status.h"         // Status
+#include "column.h"         // Column
+#include "schema.h"         // Schema
+#include "memory_stats.h"   // MemoryStats
+#include "spill_file.h"     // SpillFile
+#include "metrics.h"        // Metrics
+#include "query_log.h"      // QueryLog
+#include "query_plan.h"     // QueryPlan
+#include "field_stats.h"    // FieldStats
+#include "aggregate.h"      // Aggregate
+#include "result_set.h"     // ResultSet
 
 #include "i_table.h"        // ITable
 
@@ -62,6 +74,34 @@ public:
         Value       value;
     };
 
+    struct SortKey
+    {
+        field_id_t  field_id;
+        bool        is_descending;
+    };
+
+    struct SelectOptions
+    {
+        static const std::size_t NO_LIMIT = static_cast<std::size_t>( -1 );
+
+        std::vector<SortKey>    order_by;   // records without the field come last in either direction
+        std::size_t             limit;
+        std::size_t             offset;
+
+        SelectOptions():
+            limit( NO_LIMIT ),
+            offset( 0 )
+        {
+        }
+
+        SelectOptions( const std::vector<SortKey> & order_by, std::size_t limit, std::size_t offset ):
+            order_by( order_by ),
+            limit( limit ),
+            offset( offset )
+        {
+        }
+    };
+
 public:
 
     Table();
@@ -73,6 +113,27 @@ public:
     void init(
             const std::vector<field_id_t> & keys );
 
+    /**
+     * @brief values of dictionary fields are stored as integer codes, that pays off for fields with few distinct values
+     */
+    void init(
+            const std::vector<field_id_t> & keys,
+            const std::vector<field_id_t> & dictionary_field_ids );
+
+    /**
+     * @brief indexed fields of the schema become the keys of the table
+     */
+    void init(
+            const Schema & schema );
+
+    /**
+     * @brief fails, if any existing record violates the schema or if the indexed fields of the schema are not exactly
+     *        the keys of the table; an empty schema turns the checks off
+     */
+    bool set_schema(
+            const Schema        & schema,
+            std::string         * error_msg );
+
     std::size_t get_size() const;
 
     bool add_record(
@@ -95,10 +156,28 @@ public:
             const Value         & value,
             std::string         * error_msg );
 
+    bool delete_record__unlocked(
+            const RecordHandle  & handle,
+            std::string         * error_msg );
+
+    /**
+     * @brief returns handle of the record, or a handle with INVALID_SLOT if the record doesn't belong to the table
+     */
+    RecordHandle get_handle__unlocked( const Record * record ) const;
+
+    /**
+     * @brief returns the record referenced by the handle, or nullptr if the handle is stale
+     */
+    Record* get_record__unlocked( const RecordHandle & handle ) const;
+
     void set_meta_key(
             metakey_id_t        metakey_id,
             const Value         & value );
 
+    void set_meta_key(
+            metakey_id_t        metakey_id,
+            Value               && value );
+
     bool get_meta_key(
             metakey_id_t        metakey_id,
             Value               * value );
@@ -110,6 +189,10 @@ public:
             metakey_id_t        metakey_id,
             const Value         & value );
 
+    void set_meta_key__unlocked(
+            metakey_id_t        metakey_id,
+            Value               && value );
+
     bool get_meta_key__unlocked(
             metakey_id_t        metakey_id,
             Value               * value );
@@ -119,47 +202,231 @@ public:
 
     bool on_add_field( field_id_t field_id, const Value & value, Record * record ) override;
     bool on_update_field( field_id_t field_id, const Value & old_value, const Value & new_value, Record * record ) override;
-    void on_delete_field( field_id_t field_id, const Value & value ) override;
+    bool on_delete_field( field_id_t field_id, const Value & value, Record * record ) override;
+    void on_load_spilled( Record * record ) override;
+    bool get_spilled_data( const Record * record, std::string * data ) const override;
 
     Record* find__unlocked( field_id_t field_id, const Value & value );
     const Record* find__unlocked( field_id_t field_id, const Value & value ) const;
 
+    /**
+     * @brief all records of the table in storage order
+     */
+    std::vector<Record*> get_records__unlocked() const;
+
+    bool has_index( field_id_t field_id ) const;
+
     std::vector<Record*> select__unlocked( field_id_t field_id, anyvalue::comparison_type_e op, const Value & value ) const;
     std::vector<Record*> select__unlocked( const SelectCondition & condition ) const;
 
+    /**
+     * @brief conditions on a key combined with AND are looked up in its index, other selects scan the table or its columns;
+     *        no conditions select all records
+     */
     std::vector<Record*> select__unlocked( bool is_or, const std::vector<SelectCondition> & conditions ) const;
 
+    /**
+     * @brief records are sorted by the keys, then the first offset records are skipped and at most limit records are returned;
+     *        an index on the first key is walked in order, otherwise the first offset + limit records are kept in a bounded heap
+     */
+    std::vector<Record*> select__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const SelectOptions & options ) const;
+
+    /**
+     * @brief copies the fields of the selected records, so that they can be read after the table is unlocked
+     */
+    ResultSet select_fields( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<field_id_t> & field_ids ) const;
+    ResultSet select_fields( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<field_id_t> & field_ids, const SelectOptions & options ) const;
+    ResultSet select_fields__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<field_id_t> & field_ids, const SelectOptions & options ) const;
+
+    /**
+     * @brief runs the select and returns its plan along with the actual number of scanned and matched records
+     */
+    QueryPlan explain( bool is_or, const std::vector<SelectCondition> & conditions ) const;
+    QueryPlan explain( bool is_or, const std::vector<SelectCondition> & conditions, const SelectOptions & options ) const;
+    QueryPlan explain__unlocked( bool is_or, const std::vector<SelectCondition> & conditions ) const;
+    QueryPlan explain__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const SelectOptions & options ) const;
+
+    /**
+     * @brief aggregates the selected records in one pass, optionally grouped by the field; no conditions select all records
+     *        like in select; without grouping, MIN and MAX of a key are found by walking its index from the respective end
+     */
+    std::vector<AggregateRow> aggregate( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<Aggregate> & aggregates ) const;
+    std::vector<AggregateRow> aggregate( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<Aggregate> & aggregates, field_id_t group_by ) const;
+    std::vector<AggregateRow> aggregate__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<Aggregate> & aggregates ) const;
+    std::vector<AggregateRow> aggregate__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<Aggregate> & aggregates, field_id_t group_by ) const;
+
+    /**
+     * @brief selects records, which string field starts with the prefix
+     */
+    std::vector<Record*> select_prefix__unlocked( field_id_t field_id, const std::string & prefix ) const;
+
     bool save( std::string * error_msg, const std::string & filename ) const;
+    bool save( std::string * error_msg, const std::string & filename, bool is_compressed ) const;
+
+    uint64_t get_change_count__unlocked() const;
+
+    /**
+     * @brief if enabled, index contents are saved along with the records, so that loading does not need to rebuild them
+     */
+    void set_persist_index( bool is_enabled );
+
+    /**
+     * @brief keeps a columnar copy of the given fields, selects on them are evaluated column-at-a-time
+     */
+    void set_columnar( const std::vector<field_id_t> & field_ids );
+
+    /**
+     * @brief doesn't lock the table, counters are maintained on every modification
+     */
+    MemoryStats get_memory_stats() const;
+
+    /**
+     * @brief statistics of values of the field, used by the planner; false, if no record has the field
+     */
+    bool get_field_stats( field_id_t field_id, FieldStats * res ) const;
+
+    /**
+     * @brief rebuilds the statistics of all fields from the records, so that deletions are reflected in them
+     */
+    void analyze();
+    void analyze__unlocked();
+
+    /**
+     * @brief when fields of the records take more than the budget, least recently used records are moved to the spill file,
+     *        only index and column entries of them stay in memory; 0 turns the budget off and loads all records back
+     *
+     * Records returned by find, select and create stay in memory until the next call of any of them.
+     */
+    bool set_memory_budget(
+            uint64_t            budget,
+            const std::string   & spill_filename,
+            std::string         * error_msg );
+
+    /**
+     * @brief doesn't lock the table; lock wait is measured for the locking methods of the table only
+     */
+    MetricsSnapshot get_metrics() const;
+
+    /**
+     * @brief records selects taking at least threshold_us along with their conditions and access path, and aggregates all selects by query shape
+     */
+    void enable_query_log( uint32_t threshold_us, std::size_t max_entries );
+    void disable_query_log();
+
+    std::vector<QueryInfo> get_slow_queries() const;
+    std::vector<QueryShapeStats> get_query_stats() const;
 
     std::mutex & get_mutex() const;
 
 private:
 
-    typedef std::set<Record*>           SetRecord;
+    struct Slot
+    {
+        Record      * record;       // nullptr, if the slot is free
+        uint32_t    generation;     // incremented every time the slot is released
+    };
+
+    typedef std::vector<Slot>           VectorSlot;
+
+    typedef std::list<uint32_t>         ListSlot;
+
+    struct SpillSlot
+    {
+        uint64_t            offset;     // place of the record in the spill file
+        uint32_t            size;
+        uint32_t            capacity;   // reused by the next record of the slot, if it fits
+        bool                is_clean;   // spill file holds the current fields of the record
+        bool                is_in_lru;
+        ListSlot::iterator  lru_pos;
+    };
+
+    typedef std::vector<SpillSlot>      VectorSpillSlot;
+
+    typedef bool (*Comparator)( anyvalue::comparison_type_e op, const Value & lhs, const Value & rhs );
+
+    struct ResolvedCondition
+    {
+        const SelectCondition   * condition;
+        bool                    is_encoded;     // if true, codes of the field dictionary are compared
+        Value                   code;
+        Comparator              compare;        // specialized for the type of the field, if it is known from the schema
+    };
     typedef std::map<Value,Record*>     MapValueIdToRecord;
     typedef std::map<field_id_t,MapValueIdToRecord>     MapFieldIdToIndex;
 
     typedef std::map<metakey_id_t,Value>     MapMetaKeyIdToValue;
 
-private:
+    typedef std::map<field_id_t,Column>      MapFieldIdToColumn;
 
-    bool add_loaded_record__unlocked(
-            Record              * record,
-            std::string         * error_msg );
+    typedef std::map<field_id_t,FieldStats>  MapFieldIdToStats;
 
-    bool add_record__unlocked__intern(
-            Record              * record,
-            std::string         * error_msg,
-            bool                is_loaded );
+    struct IndexMemory
+    {
+        std::atomic<uint64_t>   num_entries;
+        std::atomic<uint64_t>   size;
+
+        IndexMemory():
+            num_entries( 0 ),
+            size( 0 )
+        {
+        }
+    };
 
-    bool save_intern( std::string * error_msg, const std::string & filename ) const;
-    bool load_intern( const std::string & filename );
+    typedef std::map<field_id_t,IndexMemory> MapFieldIdToIndexMemory;
+
+private:
+
+    bool save_intern( std::string * error_msg, const std::string & filename, bool is_compressed ) const;
+    bool load_intern( std::string * error_msg, const std::string & filename );
 
     void get_status( Status * res ) const;
     bool init_index(
             const std::vector<field_id_t> & keys );
-    void init_metakeys_from_status( const Status & status );
-    bool init_from_status( std::string * error_msg, const Status & status );
+    void init_dictionaries( const std::vector<field_id_t> & field_ids );
+    void init_metakeys_from_status( Status & status );
+    bool init_from_status( std::string * error_msg, Status & status );
+
+    void destroy_record( Record * record );
+
+    bool has_record( const Record * record ) const;
+    bool insert_record( Record * record );
+    void erase_record( Record * record );
+
+    void set_column_value( field_id_t field_id, const Value & value, Record * record );
+    void set_column( Column & column, uint32_t slot, const Value & value );
+    void clear_column( Column & column, uint32_t slot );
+
+    void account_record( const Record & record, int sign );
+    void update_stats( const Record & record, int sign );
+    void update_stats( field_id_t field_id, const Value & value, int sign );
+    void account_field( field_id_t field_id, const Value & value, int sign ) const;
+    void account_index_entry( field_id_t field_id, const Value & key, int sign );
+    void add_columns_for_record( Record * record );
+    bool is_columnar( const ResolvedCondition & condition ) const;
+    void select_columnar( bool is_or, const std::vector<ResolvedCondition> & conditions, std::vector<Record*> * res ) const;
+    void get_records( const Column::Bitmap & selection, std::vector<Record*> * res ) const;
+
+    std::vector<Record*> select__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const SelectOptions & options, bool is_loaded, QueryPlan * plan ) const;
+    double estimate_selectivity( const ResolvedCondition & condition ) const;
+    double estimate_range( field_id_t field_id, const QueryPlan::Bound & lower_bound, const QueryPlan::Bound & upper_bound ) const;
+    QueryPlan plan_select( bool is_or, std::vector<ResolvedCondition> * resolved ) const;
+    void plan_order( const SelectOptions & options, QueryPlan * plan ) const;
+    void execute_plan( const QueryPlan & plan, const std::vector<ResolvedCondition> & resolved, bool is_descending, std::size_t max_matches, std::vector<Record*> * res, std::size_t * num_scanned ) const;
+    void sort_records( const SelectOptions & options, std::vector<Record*> * records ) const;
+
+    std::vector<AggregateRow> aggregate__unlocked( bool is_or, const std::vector<SelectCondition> & conditions, const std::vector<Aggregate> & aggregates, bool has_group_by, field_id_t group_by ) const;
+    bool aggregate_by_index( bool is_or, const std::vector<ResolvedCondition> & resolved, const std::vector<Aggregate> & aggregates, AggregateRow * res, std::size_t * num_scanned ) const;
+
+    static std::string describe_conditions( bool is_or, const std::vector<SelectCondition> & conditions, bool has_values );
+    void log_query( const std::string & shape, const std::string & description, access_path_e access_path, std::size_t num_scanned, std::size_t num_matched, std::chrono::steady_clock::time_point start ) const;
+
+    void enforce_memory_budget() const;
+    bool spill_record( uint32_t slot ) const;
+    void fault_in( Record * record ) const;
+    void fault_in( const std::vector<Record*> & records ) const;
+    void mark_dirty( const Record * record );
+    const Record & get_view( const Record * record, Record * tmp ) const;
+    bool load_spilled( const Record * record, Record * res ) const;
 
     void cleanup_index_for_record( Record * record );
     void cleanup_index_for_record_field( Record * record, field_id_t field_id, MapValueIdToRecord & map );
@@ -170,21 +437,66 @@ private:
     void add_index_for_record( Record * record );
     void add_index_for_record_field( Record * record, field_id_t field_id, MapValueIdToRecord & map );
 
-    static bool is_matching( const Record & r, const SelectCondition & condition );
-    static bool is_matching( const Record & r, bool is_or, const std::vector<SelectCondition> & conditions );
+    bool build_indices( const Status & status, std::string * error_msg );
+    bool build_index_for_field( field_id_t field_id, MapValueIdToRecord * map, std::string * error_msg ) const;
+    bool restore_index_for_field( field_id_t field_id, const std::vector<Record*> & records, const Status::VectorOrdinal & ordinals, MapValueIdToRecord * map ) const;
+
+    ResolvedCondition resolve_condition( const SelectCondition & condition ) const;
+    std::vector<ResolvedCondition> resolve_conditions( const std::vector<SelectCondition> & conditions ) const;
+
+    static bool is_matching( const Record & r, const ResolvedCondition & condition );
+    static bool is_matching( const Record & r, bool is_or, const std::vector<ResolvedCondition> & conditions );
+    bool is_matching_any( const Record * r, bool is_or, const std::vector<ResolvedCondition> & conditions, const std::vector<ResolvedCondition> & plain_conditions ) const;
+    static std::vector<ResolvedCondition> get_plain_conditions( const std::vector<ResolvedCondition> & conditions );
 
 private:
     mutable std::mutex          mutex_;
 
     bool                        is_inited_;
 
+    uint64_t                    change_count_;  // incremented on every modification
+
+    bool                        is_index_persisted_;
+
     // Config
     std::string                 credentials_file_;
 
-    SetRecord                   records_;
+    Arena                       arena_;         // storage for records created by the table
+
+    // records are kept in slots, scans go in slot order; released slots are reused LIFO
+    VectorSlot                  slots_;
+    std::vector<uint32_t>       free_slots_;
+    std::atomic<std::size_t>    num_records_;
     MapFieldIdToIndex           map_field_id_to_index_;
 
     MapMetaKeyIdToValue         map_metakey_id_to_value_;
+
+    MapFieldIdToDictionary      map_field_id_to_dictionary_;
+
+    MapFieldIdToColumn          map_field_id_to_column_;    // columns are indexed by slot
+
+    MapFieldIdToStats           map_field_id_to_stats_;
+
+    Schema                      schema_;
+
+    // memory accounting, readable without lock; fields are loaded and spilled by const methods as well
+    std::atomic<uint64_t>       mem_records_;
+    mutable std::atomic<uint64_t>   mem_fields_;
+    mutable std::atomic<uint64_t>   mem_payload_;
+    std::atomic<uint64_t>       mem_metakeys_;
+    std::atomic<uint64_t>       mem_columns_;
+    MapFieldIdToIndexMemory     map_field_id_to_index_memory_;
+
+    // memory budget, 0 - unlimited
+    uint64_t                    memory_budget_;
+    mutable SpillFile           spill_file_;
+    mutable VectorSpillSlot     spill_slots_;   // indexed by slot
+    mutable ListSlot            lru_;           // slots of records in memory, most recently used first
+    mutable std::atomic<std::size_t>    num_spilled_;
+
+    Metrics                     metrics_;
+
+    mutable QueryLog            query_log_;
 };
 
 } // namespace anyvalue_db
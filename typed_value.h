@@ -0,0 +1,116 @@
+/*
+
+Typed value. Compile-time access to values of known type.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__TYPED_VALUE_H
+#define ANYVALUE_DB__TYPED_VALUE_H
+
+#include <cstdint>          // int64_t
+#include <string>           // std::string
+
+#include "value.h"          // Value
+#include "anyvalue/operations.h"    // anyvalue::comparison_type_e
+
+namespace anyvalue_db
+{
+
+template<class T>
+struct TypeTraits;
+
+template<>
+struct TypeTraits<bool>
+{
+    static const anyvalue::type_e TYPE = anyvalue::type_e::BOOL;
+
+    static bool get( const Value & v )
+    {
+        return v.get_bool();
+    }
+};
+
+template<>
+struct TypeTraits<int64_t>
+{
+    static const anyvalue::type_e TYPE = anyvalue::type_e::INT;
+
+    static int64_t get( const Value & v )
+    {
+        return v.get_int();
+    }
+};
+
+template<>
+struct TypeTraits<double>
+{
+    static const anyvalue::type_e TYPE = anyvalue::type_e::DOUBLE;
+
+    static double get( const Value & v )
+    {
+        return v.get_double();
+    }
+};
+
+template<>
+struct TypeTraits<std::string>
+{
+    static const anyvalue::type_e TYPE = anyvalue::type_e::STRING;
+
+    static const std::string & get( const Value & v )
+    {
+        return v.get_string();
+    }
+};
+
+template<class T>
+bool compare_typed( anyvalue::comparison_type_e op, const T & lhs, const T & rhs )
+{
+    switch( op )
+    {
+    case anyvalue::comparison_type_e::EQ:
+        return lhs == rhs;
+    case anyvalue::comparison_type_e::NEQ:
+        return lhs != rhs;
+    case anyvalue::comparison_type_e::LT:
+        return lhs < rhs;
+    case anyvalue::comparison_type_e::LE:
+        return lhs <= rhs;
+    case anyvalue::comparison_type_e::GT:
+        return lhs > rhs;
+    case anyvalue::comparison_type_e::GE:
+        return lhs >= rhs;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief compares values, which are known to be of type T, without checking their types at runtime
+ */
+template<class T>
+bool compare_typed_values( anyvalue::comparison_type_e op, const Value & lhs, const Value & rhs )
+{
+    return compare_typed( op, TypeTraits<T>::get( lhs ), TypeTraits<T>::get( rhs ) );
+}
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__TYPED_VALUE_H
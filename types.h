@@ -32,6 +32,17 @@ namespace anyvalue_db
 typedef uint32_t field_id_t;
 typedef uint32_t metakey_id_t;
 
+/**
+ * @brief stable reference to a record of a table, becomes stale when the record is deleted
+ */
+struct RecordHandle
+{
+    static const uint32_t INVALID_SLOT = 0xFFFFFFFF;
+
+    uint32_t    slot;
+    uint32_t    generation;
+};
+
 } // namespace anyvalue_db
 
 #endif // LIB_ANYVALUE_DB__TYPES_H
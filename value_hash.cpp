@@ -0,0 +1,87 @@
+/*
+
+Hashing of values.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#include "value_hash.h"     // self
+
+#include <cstring>          // memcpy
+#include <functional>       // std::hash
+#include <string>           // std::string
+
+#include "anyvalue/op_less.h"       // operator<
+
+namespace anyvalue_db
+{
+
+namespace
+{
+
+uint64_t mix( uint64_t x )
+{
+    // finalizer of splitmix64, spreads similar keys over all bits
+
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+
+    return x;
+}
+
+} // namespace
+
+uint64_t hash_value( const Value & value )
+{
+    switch( value.get_type() )
+    {
+    case anyvalue::type_e::BOOL:
+        return mix( value.get_bool() ? 1 : 2 );
+
+    case anyvalue::type_e::INT:
+        return mix( static_cast<uint64_t>( value.get_int() ) ^ 0x100000000ULL );
+
+    case anyvalue::type_e::DOUBLE:
+    {
+        auto d = value.get_double() == 0 ? 0.0 : value.get_double();   // -0.0 equals 0.0
+
+        uint64_t bits;
+
+        memcpy( & bits, & d, sizeof( bits ) );
+
+        return mix( bits ^ 0x200000000ULL );
+    }
+
+    case anyvalue::type_e::STRING:
+        return mix( std::hash<std::string>()( value.get_string() ) );
+
+    default:
+        return 0;
+    }
+}
+
+bool ValueEqual::operator()( const Value & lhs, const Value & rhs ) const
+{
+    return ( lhs < rhs ) == false && ( rhs < lhs ) == false;
+}
+
+} // namespace anyvalue_db
@@ -0,0 +1,58 @@
+/*
+
+Hashing of values.
+
+Copyright (C) 2020 Sergey Kolevatov
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// $Revision: 13915 $ $Date:: 2020-10-02 #$ $Author: serge $
+
+#ifndef ANYVALUE_DB__VALUE_HASH_H
+#define ANYVALUE_DB__VALUE_HASH_H
+
+#include <cstdint>          // uint64_t
+#include <cstddef>          // std::size_t
+
+#include "value.h"          // Value
+
+namespace anyvalue_db
+{
+
+/**
+ * @brief well mixed 64-bit hash, values of different types hash differently
+ */
+uint64_t hash_value( const Value & value );
+
+struct ValueHash
+{
+    std::size_t operator()( const Value & value ) const
+    {
+        return static_cast<std::size_t>( hash_value( value ) );
+    }
+};
+
+/**
+ * @brief equality consistent with the ordering of values, i.e. values of different types are never equal
+ */
+struct ValueEqual
+{
+    bool operator()( const Value & lhs, const Value & rhs ) const;
+};
+
+} // namespace anyvalue_db
+
+#endif // ANYVALUE_DB__VALUE_HASH_H